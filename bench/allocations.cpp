@@ -0,0 +1,68 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "3dprnet/core/allocations.hpp"
+#include "bench/allocations.hpp"
+
+using namespace std;
+
+namespace prnet {
+namespace bench {
+
+static atomic< uint64_t > counted {};
+static thread_local bool counting {};
+
+void countAllocations( bool enabled )
+{
+    counting = enabled;
+}
+
+uint64_t allocations()
+{
+    return counted.load( memory_order_relaxed );
+}
+
+} // namespace bench
+} // namespace prnet
+
+// this replacement hides the one of the library, which is why it passes the allocations on
+void* operator new( size_t size )
+{
+#if defined( PRNET_TRACK_ALLOCATIONS )
+    prnet::detail::trackAllocation( size );
+#endif
+    if ( prnet::bench::counting ) {
+        prnet::bench::counted.fetch_add( 1, memory_order_relaxed );
+    }
+    if ( void* result = malloc( size > 0 ? size : 1 ) ) {
+        return result;
+    }
+    throw bad_alloc();
+}
+
+void* operator new( size_t size, nothrow_t const& ) noexcept
+{
+#if defined( PRNET_TRACK_ALLOCATIONS )
+    prnet::detail::trackAllocation( size );
+#endif
+    if ( prnet::bench::counting ) {
+        prnet::bench::counted.fetch_add( 1, memory_order_relaxed );
+    }
+    return malloc( size > 0 ? size : 1 );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+    free( ptr );
+}
+
+void operator delete( void* ptr, nothrow_t const& ) noexcept
+{
+    free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+    free( ptr );
+}
@@ -0,0 +1,21 @@
+#ifndef LIB3DPRNET_BENCH_ALLOCATIONS_HPP
+#define LIB3DPRNET_BENCH_ALLOCATIONS_HPP
+
+#include <cstdint>
+
+namespace prnet {
+namespace bench {
+
+/**
+ * Counting of the calls to the global operator new, which bench/allocations.cpp replaces. Only allocations on threads
+ * that enabled counting are counted, so that e.g. a MockServer in the same process does not distort the numbers.
+ */
+
+void countAllocations( bool enabled );
+
+std::uint64_t allocations();
+
+} // namespace bench
+} // namespace prnet
+
+#endif // LIB3DPRNET_BENCH_ALLOCATIONS_HPP
@@ -0,0 +1,159 @@
+#ifndef LIB3DPRNET_BENCH_BENCH_HPP
+#define LIB3DPRNET_BENCH_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <time.h>
+
+#include <nlohmann/json.hpp>
+
+namespace prnet {
+namespace bench {
+
+/**
+ * Keeps the compiler from optimizing away the computation of value.
+ */
+template< typename T >
+inline void keep( T const& value )
+{
+    asm volatile( "" : : "g"( &value ) : "memory" );
+}
+
+
+/**
+ * Cpu time consumed by thread so far.
+ */
+inline std::chrono::nanoseconds cpuTime( std::thread& thread )
+{
+    clockid_t clock;
+    timespec time {};
+    if ( pthread_getcpuclockid( thread.native_handle(), &clock ) != 0 || clock_gettime( clock, &time ) != 0 ) {
+        return {};
+    }
+    return std::chrono::seconds( time.tv_sec ) + std::chrono::nanoseconds( time.tv_nsec );
+}
+
+
+/**
+ * Cpu time consumed by all threads of the process so far.
+ */
+inline std::chrono::nanoseconds processCpuTime()
+{
+    timespec time {};
+    if ( clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &time ) != 0 ) {
+        return {};
+    }
+    return std::chrono::seconds( time.tv_sec ) + std::chrono::nanoseconds( time.tv_nsec );
+}
+
+
+/**
+ * class Report
+ *
+ * Runs benchmarks and collects their results into a JSON document that can be compared between releases:
+ *
+ *     { "suite": ..., "time": ..., "compiler": ..., "results": [ { "name": ..., "params": { ... }, "iterations": ...,
+ *       "ns_per_op": { "min": ..., "median": ..., "max": ... }, "ops_per_s": ..., "bytes_per_s": ... }, ... ] }
+ *
+ * Every benchmark is run once for warming up and then repetitions times, the rates are computed from the median.
+ */
+
+class Report
+{
+    using Clock = std::chrono::steady_clock;
+
+public:
+    explicit Report( std::string suite, std::size_t repetitions = 5 )
+            : suite_( std::move( suite ) )
+            , repetitions_( repetitions ) {}
+
+    /**
+     * Measures iterations calls of func. If bytes is not zero, it is the number of bytes processed by one call.
+     */
+    template< typename Func >
+    void run( std::string name, nlohmann::json params, std::size_t iterations, std::size_t bytes, Func&& func )
+    {
+        measure( iterations, func );
+
+        std::vector< double > results;
+        for ( std::size_t i = 0 ; i < repetitions_ ; ++i ) {
+            results.push_back( measure( iterations, func ) );
+        }
+        std::sort( results.begin(), results.end() );
+        auto median = results[ results.size() / 2 ];
+
+        nlohmann::json result {
+                { "name", std::move( name ) },
+                { "params", std::move( params ) },
+                { "iterations", iterations },
+                { "ns_per_op", { { "min", results.front() }, { "median", median }, { "max", results.back() } } },
+                { "ops_per_s", 1e9 / median } };
+        if ( bytes > 0 ) {
+            result.emplace( "bytes_per_s", 1e9 * bytes / median );
+        }
+        std::cerr << result.dump() << std::endl;
+        results_.push_back( std::move( result ) );
+    }
+
+    /**
+     * Adds a result that was measured by the benchmark itself.
+     */
+    void add( nlohmann::json result )
+    {
+        std::cerr << result.dump() << std::endl;
+        results_.push_back( std::move( result ) );
+    }
+
+    nlohmann::json document() const
+    {
+        return {
+                { "suite", suite_ },
+                { "time", std::time( nullptr ) },
+                { "compiler", __VERSION__ },
+                { "results", results_ } };
+    }
+
+    /**
+     * Writes the document to path, or to standard output if path is "-".
+     */
+    void write( std::string const& path ) const
+    {
+        if ( path == "-" ) {
+            std::cout << document().dump( 2 ) << std::endl;
+        } else {
+            std::ofstream( path ) << document().dump( 2 ) << std::endl;
+        }
+    }
+
+private:
+    template< typename Func >
+    static double measure( std::size_t iterations, Func& func )
+    {
+        auto start = Clock::now();
+        for ( std::size_t i = 0 ; i < iterations ; ++i ) {
+            func();
+        }
+        auto elapsed = Clock::now() - start;
+        return static_cast< double >( std::chrono::duration_cast< std::chrono::nanoseconds >( elapsed ).count() )
+               / iterations;
+    }
+
+    std::string suite_;
+    std::size_t repetitions_;
+    nlohmann::json results_ = nlohmann::json::array();
+};
+
+} // namespace bench
+} // namespace prnet
+
+#endif // LIB3DPRNET_BENCH_BENCH_HPP
@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/client.hpp"
+#include "bench/bench.hpp"
+#include "repetier/event_table.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+// the types a busy server sends, the last ones are not subscribed to
+static vector< string > const eventTypes {
+        "temp", "jobStarted", "jobFinished", "jobKilled", "printerListChanged", "printqueueChanged",
+        "modelGroupListChanged", "newPrinter", "config", "move", "layerChanged", "state", "log", "timer30",
+        "timer60", "dispatcherCount" };
+
+static size_t const subscribedTypes = 12;
+
+json makeFrame( size_t events )
+{
+    json data = json::array();
+    for ( size_t i = 0 ; i < events ; ++i ) {
+        data.push_back( {
+                { "event", eventTypes[ i % eventTypes.size() ] },
+                { "printer", "printer_" + std::to_string( i % 4 ) },
+                { "data", { { "id", i }, { "T", 205.3 }, { "O", 0 } } } } );
+    }
+    return { { "callback_id", -1 }, { "eventList", true }, { "data", move( data ) } };
+}
+
+/**
+ * Measures the routing of events to their handlers, for subscribedTypes types out of eventTypes. "lookup" compares
+ * matching the type of an event against the subscriptions: "map" copies the type out of the event and looks it up in
+ * an unordered_map as the client used to, "table" looks it up in place in an EventTable. "replay" passes a frame of
+ * events through a Client with the given number of handlers per subscribed type.
+ *
+ * Arguments: [<output.json> [<events per frame>]]
+ */
+int main( int argc, char const* const argv[] )
+{
+    string output = argc > 1 ? argv[ 1 ] : "-";
+    size_t events = max< size_t >( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 64, 1 );
+
+    Logger::threshold( Logger::Level::error );
+
+    auto frame = makeFrame( events );
+    auto message = frame.dump();
+    auto const& data = frame.at( "data" );
+
+    bench::Report report( "dispatch" );
+
+    unordered_map< string, size_t > map;
+    rep::detail::EventTable table;
+    for ( size_t i = 0 ; i < subscribedTypes ; ++i ) {
+        map.emplace( eventTypes[ i ], i );
+        table.intern( eventTypes[ i ] );
+    }
+    auto params = [events]( json params ) {
+        params.update( { { "events", events }, { "types", eventTypes.size() }, { "subscribed", subscribedTypes } } );
+        return params;
+    };
+
+    report.run( "lookup", params( { { "impl", "map" } } ), 10000, 0, [&] {
+        for ( auto const& event : data ) {
+            string type = event.at( "event" );
+            bench::keep( map.find( type ) );
+        }
+    } );
+    report.run( "lookup", params( { { "impl", "table" } } ), 10000, 0, [&] {
+        for ( auto const& event : data ) {
+            bench::keep( table.find( event.at( "event" ).get_ref< string const& >() ) );
+        }
+    } );
+
+    for ( size_t handlers : { 1, 2 } ) {
+        asio::io_context context;
+        rep::Client client( context, []( auto ) {} );
+        size_t invoked {};
+        for ( size_t i = 0 ; i < subscribedTypes ; ++i ) {
+            for ( size_t j = 0 ; j < handlers ; ++j ) {
+                client.subscribe( eventTypes[ i ], [&invoked]( auto const&, auto const& ) { ++invoked; } );
+            }
+        }
+        report.run( "replay", params( { { "handlers", handlers } } ), 10000, message.size(),
+                    [&] { client.replay( message ); } );
+        bench::keep( invoked );
+    }
+
+    report.write( output );
+}
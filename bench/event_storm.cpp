@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/allocations.hpp"
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/core/metrics.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "3dprnet/repetier/service_pool.hpp"
+#include "bench/allocations.hpp"
+#include "bench/bench.hpp"
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+struct Options
+{
+    size_t connections;
+    size_t printers;
+    double rate;
+    chrono::seconds duration;
+    size_t threads;
+    size_t shards;
+};
+
+/**
+ * The services under test: either all on one io_context run by several threads, or spread over the shards of a
+ * ServicePool. The pool needs a server per service, since it identifies them by host and port.
+ */
+class Clients
+{
+public:
+    Clients( Options const& options, vector< rep::Endpoint > const& endpoints, atomic< uint64_t >& received )
+    {
+        auto counted = [&received]( auto, auto ) { received.fetch_add( 1, memory_order_relaxed ); };
+        if ( options.shards > 0 ) {
+            auto poolOptions = rep::ServicePool::defaultOptions();
+            poolOptions.shards = options.shards;
+            poolOptions.rebalanceInterval = chrono::seconds( 0 );
+            pool_ = make_unique< rep::ServicePool >( poolOptions );
+            pool_->on_temperature( [counted]( auto, auto slug, auto temp ) { counted( slug, temp ); } );
+            for ( auto const& endpoint : endpoints ) {
+                servers_.push_back( pool_->add( endpoint ) );
+            }
+            // runs on the shard thread of the service
+            each( []( rep::Service& service ) {
+                bench::countAllocations( true );
+                service.tracing( { true, 0, {} } );
+            } );
+            return;
+        }
+
+        work_ = make_unique< Work >( asio::make_work_guard( context_ ) );
+        for ( size_t i = 0 ; i < options.threads ; ++i ) {
+            runners_.emplace_back( [this] {
+                bench::countAllocations( true );
+                context_.run();
+            } );
+        }
+        for ( size_t i = 0 ; i < options.connections ; ++i ) {
+            services_.push_back( make_unique< rep::Service >( context_, endpoints[ i % endpoints.size() ] ) );
+            services_.back()->tracing( { true, 0, {} } );
+            services_.back()->on_temperature( counted );
+        }
+    }
+
+    ~Clients()
+    {
+        pool_ = nullptr;
+        services_.clear();
+        work_ = nullptr;
+        for ( auto& runner : runners_ ) {
+            runner.join();
+        }
+    }
+
+    /**
+     * Invokes handler with every service and waits until it returned.
+     */
+    void each( function< void ( rep::Service& service ) > const& handler )
+    {
+        for ( auto const& server : servers_ ) {
+            promise< void > done;
+            pool_->dispatch( server, [&]( rep::Service& service ) {
+                handler( service );
+                done.set_value();
+            } );
+            done.get_future().wait();
+        }
+        for ( auto const& service : services_ ) {
+            handler( *service );
+        }
+    }
+
+    /**
+     * Cpu time of the client threads, which are those of the pool or the process less the server threads.
+     */
+    chrono::nanoseconds cpuTime( vector< thread >& serverRunners )
+    {
+        chrono::nanoseconds result {};
+        if ( pool_ ) {
+            result = bench::processCpuTime();
+            for ( auto& runner : serverRunners ) {
+                result -= bench::cpuTime( runner );
+            }
+        }
+        for ( auto& runner : runners_ ) {
+            result += bench::cpuTime( runner );
+        }
+        return result;
+    }
+
+private:
+    using Work = asio::executor_work_guard< asio::io_context::executor_type >;
+
+    unique_ptr< rep::ServicePool > pool_;
+    vector< string > servers_;
+    asio::io_context context_;
+    unique_ptr< Work > work_;
+    vector< thread > runners_;
+    vector< unique_ptr< rep::Service > > services_;
+};
+
+// the part of later that was recorded after earlier
+HistogramSnapshot difference( HistogramSnapshot const& later, HistogramSnapshot const& earlier )
+{
+    map< uint64_t, uint64_t > buckets( later.buckets.begin(), later.buckets.end() );
+    for ( auto const& bucket : earlier.buckets ) {
+        buckets[ bucket.first ] -= min( buckets[ bucket.first ], bucket.second );
+    }
+
+    HistogramSnapshot result { later.count - earlier.count, later.sum - earlier.sum, later.min, later.max, {} };
+    for ( auto const& bucket : buckets ) {
+        if ( bucket.second > 0 ) {
+            result.buckets.push_back( bucket );
+        }
+    }
+    return result;
+}
+
+void merge( HistogramSnapshot& into, HistogramSnapshot const& from )
+{
+    map< uint64_t, uint64_t > buckets( into.buckets.begin(), into.buckets.end() );
+    for ( auto const& bucket : from.buckets ) {
+        buckets[ bucket.first ] += bucket.second;
+    }
+    into.count += from.count;
+    into.sum += from.sum;
+    into.max = max( into.max, from.max );
+    into.buckets.assign( buckets.begin(), buckets.end() );
+}
+
+json percentiles( HistogramSnapshot const& snapshot )
+{
+    return {
+            { "count", snapshot.count },
+            { "p50", snapshot.percentile( 50.0 ) },
+            { "p99", snapshot.percentile( 99.0 ) },
+            { "p999", snapshot.percentile( 99.9 ) },
+            { "max", snapshot.max } };
+}
+
+uint64_t eventAllocations( rep::Metrics::Snapshot const& snapshot )
+{
+    auto event = find_if( snapshot.eventAllocations.begin(), snapshot.eventAllocations.end(),
+                          []( auto const& event ) { return event.first == "temp"; } );
+    return event != snapshot.eventAllocations.end() ? event->second : 0;
+}
+
+HistogramSnapshot traceTotal( rep::Metrics::Snapshot const& snapshot )
+{
+    auto trace = find_if( snapshot.traces.begin(), snapshot.traces.end(),
+                          []( auto const& trace ) { return trace.type == "temp"; } );
+    return trace != snapshot.traces.end() ? trace->total : HistogramSnapshot {};
+}
+
+json run( Options const& options )
+{
+    // the server runs on its own threads, so that its work is neither counted nor competes with the client threads
+    asio::io_context serverContext;
+    auto serverWork = asio::make_work_guard( serverContext );
+    auto mockOptions = rep::MockServer::defaultOptions();
+    mockOptions.printers = max< size_t >( options.printers / options.connections, 1 );
+    mockOptions.eventRate = options.rate / options.connections;
+    mockOptions.eventBatch = max< size_t >( static_cast< size_t >( mockOptions.eventRate / 1000.0 ), 1 );
+    vector< unique_ptr< rep::MockServer > > mocks;
+    vector< rep::Endpoint > endpoints;
+    for ( size_t i = 0 ; i < ( options.shards > 0 ? options.connections : 1 ) ; ++i ) {
+        mocks.push_back( make_unique< rep::MockServer >( serverContext, mockOptions ) );
+        endpoints.push_back( mocks.back()->endpoint() );
+    }
+    auto sent = [&mocks] {
+        uint64_t result = 0;
+        for ( auto const& mock : mocks ) {
+            result += mock->stats().events;
+        }
+        return result;
+    };
+    vector< thread > serverRunners;
+    for ( size_t i = 0 ; i < 2 ; ++i ) {
+        serverRunners.emplace_back( [&serverContext] { serverContext.run(); } );
+    }
+
+    atomic< uint64_t > received {};
+    auto clients = make_unique< Clients >( options, endpoints, received );
+
+    auto deadline = chrono::steady_clock::now() + chrono::seconds( 10 );
+    auto connected = [&clients] {
+        bool result = true;
+        clients->each( [&result]( rep::Service& service ) { result = result && service.connected(); } );
+        return result;
+    };
+    while ( !connected() && chrono::steady_clock::now() < deadline ) {
+        this_thread::sleep_for( chrono::milliseconds( 10 ) );
+    }
+    this_thread::sleep_for( chrono::milliseconds( 500 ) );
+
+    auto snapshot = [&] {
+        struct
+        {
+            chrono::steady_clock::time_point time;
+            uint64_t sent;
+            uint64_t received;
+            uint64_t allocations;
+            chrono::nanoseconds cpu;
+            vector< rep::Metrics::Snapshot > metrics;
+            vector< AllocationStats > tags;
+        } result { chrono::steady_clock::now(), sent(), received.load( memory_order_relaxed ),
+                   bench::allocations(), clients->cpuTime( serverRunners ), {}, allocationStats() };
+        clients->each( [&result]( rep::Service& service ) { result.metrics.push_back( service.metrics() ); } );
+        return result;
+    };
+
+    auto before = snapshot();
+    this_thread::sleep_for( options.duration );
+    auto after = snapshot();
+
+    HistogramSnapshot dispatch {};
+    HistogramSnapshot total {};
+    uint64_t clientAllocations {};
+    for ( size_t i = 0 ; i < after.metrics.size() ; ++i ) {
+        merge( dispatch, difference( after.metrics[ i ].dispatch, before.metrics[ i ].dispatch ) );
+        merge( total, difference( traceTotal( after.metrics[ i ] ), traceTotal( before.metrics[ i ] ) ) );
+        clientAllocations += eventAllocations( after.metrics[ i ] ) - eventAllocations( before.metrics[ i ] );
+    }
+
+    clients = nullptr;
+    serverWork.reset();
+    serverContext.stop();
+    for ( auto& runner : serverRunners ) {
+        runner.join();
+    }
+
+    auto seconds = chrono::duration< double >( after.time - before.time ).count();
+    auto events = static_cast< double >( max< uint64_t >( after.received - before.received, 1 ) );
+    json result {
+            { "name", "event_storm" },
+            { "params", {
+                    { "connections", options.connections },
+                    { "printers", options.printers },
+                    { "rate", options.rate },
+                    { "threads", options.threads },
+                    { "shards", options.shards } } },
+            { "seconds", seconds },
+            { "sent", after.sent - before.sent },
+            { "received", after.received - before.received },
+            { "events_per_s", ( after.received - before.received ) / seconds },
+            { "cpu_ns_per_event", static_cast< double >( ( after.cpu - before.cpu ).count() ) / events },
+            { "allocations_per_event", static_cast< double >( after.allocations - before.allocations ) / events },
+            { "dispatch_ns", percentiles( dispatch ) },
+            { "event_ns", percentiles( total ) } };
+
+    // with PRNET_TRACK_ALLOCATIONS, where the allocations come from
+    if ( allocationTracking ) {
+        result.emplace( "library_allocations_per_event", static_cast< double >( clientAllocations ) / events );
+        json tags;
+        for ( size_t i = 0 ; i < after.tags.size() ; ++i ) {
+            tags[ allocationTagName( after.tags[ i ].tag ) ] = {
+                    { "allocations_per_event", static_cast< double >(
+                            after.tags[ i ].allocations - before.tags[ i ].allocations ) / events },
+                    { "bytes_per_event", static_cast< double >( after.tags[ i ].bytes - before.tags[ i ].bytes ) / events } };
+        }
+        result.emplace( "allocations_by_tag", move( tags ) );
+    }
+    return result;
+}
+
+/**
+ * Drives temp events from a MockServer through Client and Service into a slot at increasing rates and reports the
+ * sustained events/s, the cpu time and allocations of the client threads per event, and the latency percentiles of
+ * dispatching a frame (Metrics::dispatch) and of an event from the websocket read to the return of its slots (the
+ * "temp" trace). Where the received rate falls behind the sent rate, the client is saturated.
+ *
+ * With shards greater than zero, the connections go to as many MockServers and run in a ServicePool of that many
+ * shards instead of on threads sharing one io_context, comparing the saturation points for 1, 2, 4, ... shards shows
+ * how the pool scales with the cores.
+ *
+ * Arguments: [<output.json> [<seconds> [<connections> [<printers> [<threads> [<shards> [<rate>...]]]]]]], rate is
+ * the total number of events per second across all connections.
+ */
+int main( int argc, char const* const argv[] )
+{
+    string output = argc > 1 ? argv[ 1 ] : "-";
+    Options options {};
+    options.duration = chrono::seconds( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 3 );
+    options.connections = max< size_t >( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : 10, 1 );
+    options.printers = argc > 4 ? strtoul( argv[ 4 ], nullptr, 10 ) : 1000;
+    options.threads = max< size_t >( argc > 5 ? strtoul( argv[ 5 ], nullptr, 10 ) : 1, 1 );
+    options.shards = argc > 6 ? strtoul( argv[ 6 ], nullptr, 10 ) : 0;
+    vector< double > rates;
+    for ( int i = 7 ; i < argc ; ++i ) {
+        rates.push_back( strtod( argv[ i ], nullptr ) );
+    }
+    if ( rates.empty() ) {
+        rates = { 1000, 10000, 50000, 100000, 200000 };
+    }
+
+    Logger::threshold( Logger::Level::error );
+
+    bench::Report report( "event_storm" );
+    for ( auto rate : rates ) {
+        options.rate = rate;
+        report.add( run( options ) );
+    }
+    report.write( output );
+}
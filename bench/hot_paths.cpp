@@ -0,0 +1,217 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/http/message.hpp>
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/encoding.hpp"
+#include "3dprnet/core/filesystem.hpp"
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/types.hpp"
+#include "bench/bench.hpp"
+#include "repetier/request.hpp"
+#include "repetier/upload_body.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+namespace http = boost::beast::http;
+
+static Logger logger( "bench::HotPaths" );
+
+json makeModels( size_t count )
+{
+    json result = json::array();
+    for ( size_t i = 0 ; i < count ; ++i ) {
+        result.push_back( {
+                { "id", i + 1 },
+                { "name", "calibration_cube_" + to_string( i ) + "_0.2mm_PLA" },
+                { "group", "Customer Project " + to_string( i % 20 ) },
+                { "created", 1514764800000 + i * 1000 },
+                { "length", 1024 * ( i + 1 ) },
+                { "layer", 100 + i % 50 },
+                { "lines", 20000 + i },
+                { "printTime", 3600.5 + i }
+        } );
+    }
+    return result;
+}
+
+json makePrinters( size_t count )
+{
+    json result = json::array();
+    for ( size_t i = 0 ; i < count ; ++i ) {
+        result.push_back( {
+                { "active", true },
+                { "name", "Printer " + to_string( i ) },
+                { "slug", "Printer_" + to_string( i ) },
+                { "online", 1 },
+                { "job", i % 2 == 0 ? "none" : "calibration_cube.gcode" }
+        } );
+    }
+    return result;
+}
+
+json makeTemperatures( size_t count )
+{
+    json result = json::array();
+    for ( size_t i = 0 ; i < count ; ++i ) {
+        result.push_back( { { "id", i % 3 == 2 ? -1 : static_cast< int >( i % 3 ) }, { "S", 210.0 }, { "T", 209.5 + i % 10 * 0.1 } } );
+    }
+    return result;
+}
+
+json makePrinterConfig( size_t extruders )
+{
+    json result {
+            { "general", {
+                    { "active", true },
+                    { "slug", "Printer_0" },
+                    { "name", "Printer 0" },
+                    { "firmwareName", "Repetier-Firmware" },
+                    { "heatedBed", true } } },
+            { "extruders", json::array() },
+            { "heatedBed", { { "installed", true }, { "maxTemp", 120 } } } };
+    for ( size_t i = 0 ; i < extruders ; ++i ) {
+        result[ "extruders" ].push_back( { { "maxTemp", 270 } } );
+    }
+    return result;
+}
+
+template< typename T >
+void benchFromJson( bench::Report& report, string const& type, json const& src, size_t iterations )
+{
+    report.run( "from_json", { { "type", type }, { "count", src.size() } }, iterations, src.dump().size(), [&] {
+        bench::keep( src.get< vector< T > >() );
+    } );
+}
+
+void benchParsing( bench::Report& report, size_t scale )
+{
+    for ( size_t count : { 1, 10, 100, 1000, 10000 } ) {
+        benchFromJson< rep::Model >( report, "Model", makeModels( count ), scale * 10 / count + 1 );
+    }
+    for ( size_t count : { 1, 10, 100 } ) {
+        benchFromJson< rep::Printer >( report, "Printer", makePrinters( count ), scale * 10 / count + 1 );
+    }
+    for ( size_t count : { 1, 10, 100 } ) {
+        benchFromJson< rep::Temperature >( report, "Temperature", makeTemperatures( count ), scale * 10 / count + 1 );
+    }
+    for ( size_t count : { 1, 4 } ) {
+        auto src = makePrinterConfig( count );
+        report.run( "from_json", { { "type", "PrinterConfig" }, { "count", 1 }, { "extruders", count } }, scale,
+                    src.dump().size(), [&] { bench::keep( src.get< rep::PrinterConfig >() ); } );
+    }
+}
+
+void benchEncoding( bench::Report& report, size_t scale )
+{
+    for ( size_t length : { 16, 256, 4096 } ) {
+        for ( auto latin1 : { false, true } ) {
+            string value( length, 'x' );
+            if ( latin1 ) {
+                for ( size_t i = 0 ; i < length ; i += 4 ) {
+                    value[ i ] = '\xe4';
+                }
+            }
+            report.run( "enc::convert", { { "length", length }, { "latin1", latin1 } }, scale * 16 / length + 1,
+                        length, [&] { bench::keep( enc::convert< enc::ToUtf8 >( value ) ); } );
+        }
+    }
+}
+
+void benchRequests( bench::Report& report, size_t scale )
+{
+    report.run( "makeRequest+dump", { { "action", "listPrinter" } }, scale, 0, [&] {
+        bench::keep( rep::detail::makeRequest( "listPrinter" ).dump() );
+    } );
+    report.run( "makeRequest+dump", { { "action", "listModels" } }, scale, 0, [&] {
+        bench::keep( rep::detail::makeRequest( "listModels", "Printer_0" ).dump() );
+    } );
+    report.run( "makeRequest+dump", { { "action", "send" } }, scale, 0, [&] {
+        auto request = rep::detail::makeRequest( "send", "Printer_0" );
+        request[ "data" ].emplace( "cmd", "M104 S210" );
+        request.emplace( "callback_id", 4711 );
+        bench::keep( request.dump() );
+    } );
+}
+
+void benchLogging( bench::Report& report, size_t scale )
+{
+    Logger::synchronous();
+    Logger::output( "/dev/null" );
+
+    Logger::threshold( "bench::HotPaths", Logger::Level::debug );
+    report.run( "Logger", { { "level", "enabled" } }, scale, 0, [&] {
+        logger.debug( "received ", 42, " events for printer ", "Printer_0" );
+    } );
+
+    Logger::threshold( "bench::HotPaths", Logger::Level::error );
+    report.run( "Logger", { { "level", "disabled" } }, scale * 100, 0, [&] {
+        logger.debug( "received ", 42, " events for printer ", "Printer_0" );
+    } );
+    report.run( "Logger", { { "level", "disabled" }, { "macro", true } }, scale * 100, 0, [&] {
+        PRNET_LOG_DEBUG( logger, "received ", 42, " events for printer ", "Printer_0" );
+    } );
+}
+
+void benchUpload( bench::Report& report, size_t megabytes )
+{
+    auto path = filesystem::temp_directory_path() / "bench_hot_paths.gcode";
+    {
+        ofstream os( path.string(), ios::binary );
+        string line( "G1 X102.394 Y87.128 E2.39481\n" );
+        for ( size_t written = 0 ; written < megabytes * 1024 * 1024 ; written += line.size() ) {
+            os << line;
+        }
+    }
+    auto size = filesystem::file_size( path );
+
+    report.run( "upload_body::writer::get", { { "megabytes", megabytes } }, 1, size, [&] {
+        http::request< rep::detail::upload_body > request { http::verb::post, "/printer/model/Printer_0", 11 };
+        request.body().set( "a", "upload" );
+        request.body().set( "name", "bench_hot_paths" );
+        request.body().set( path );
+        rep::detail::upload_body::writer writer( request.base(), request.body() );
+
+        boost::beast::error_code ec;
+        writer.init( ec );
+        size_t total {};
+        for ( bool more = !ec ; more ; ) {
+            auto result = writer.get( ec );
+            if ( ec || !result ) {
+                break;
+            }
+            total += boost::asio::buffer_size( result->first );
+            more = result->second;
+        }
+        bench::keep( total );
+    } );
+
+    filesystem::remove( path );
+}
+
+/**
+ * Throughput of the hot paths of the library in isolation, written as JSON to the file given as first argument (to
+ * standard output by default). The second argument scales the number of iterations, the third is the size of the
+ * uploaded file in MB.
+ */
+int main( int argc, char const* const argv[] )
+{
+    string output = argc > 1 ? argv[ 1 ] : "-";
+    size_t scale = argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 10000;
+    size_t megabytes = argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : 64;
+
+    bench::Report report( "hot_paths" );
+    benchParsing( report, scale );
+    benchEncoding( report, scale );
+    benchRequests( report, scale );
+    benchLogging( report, scale );
+    benchUpload( report, megabytes );
+    report.write( output );
+}
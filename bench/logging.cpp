@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "3dprnet/core/logging.hpp"
+
+using namespace std;
+using namespace prnet;
+
+static Logger logger( "bench::Logging" );
+
+double measure( size_t threads, size_t calls, string const& payload )
+{
+    vector< double > results( threads );
+    vector< thread > workers;
+    for ( size_t i = 0 ; i < threads ; ++i ) {
+        workers.emplace_back( [&, i] {
+            auto start = chrono::steady_clock::now();
+            for ( size_t j = 0 ; j < calls ; ++j ) {
+                logger.warning( "<<< ", payload, " #", j );
+            }
+            auto elapsed = chrono::steady_clock::now() - start;
+            results[ i ] = static_cast< double >( chrono::duration_cast< chrono::nanoseconds >( elapsed ).count() ) / calls;
+        } );
+    }
+    for ( auto& worker : workers ) {
+        worker.join();
+    }
+
+    double sum = 0;
+    for ( auto result : results ) {
+        sum += result;
+    }
+    return sum / threads;
+}
+
+char const* overflowName( Logger::Overflow overflow )
+{
+    switch ( overflow ) {
+        case Logger::Overflow::block: return "block";
+        case Logger::Overflow::drop: return "drop";
+        default: return "count";
+    }
+}
+
+/**
+ * Caller-side latency of a log call in the synchronous mode and the asynchronous mode with each overflow policy, for
+ * the text and the binary format. The output is written to the files given as first and third argument, /dev/null by
+ * default.
+ */
+int main( int argc, char const* const argv[] )
+{
+    auto text = argc > 1 ? argv[ 1 ] : "/dev/null";
+    size_t calls = argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 100000;
+    auto binary = argc > 3 ? argv[ 3 ] : "/dev/null";
+
+    string payload( 200, 'x' );
+
+    cout << "format;mode;threads;ns/call;dropped" << endl;
+    for ( auto format : { "text", "binary" } ) {
+        for ( size_t threads : { 1, 4 } ) {
+            Logger::synchronous();
+            if ( format == string( "text" ) ) {
+                Logger::output( text );
+            } else {
+                Logger::binary( binary );
+            }
+
+            cout << format << ";sync;" << threads << ";" << measure( threads, calls, payload ) << ";0" << endl;
+
+            for ( auto overflow : { Logger::Overflow::block, Logger::Overflow::drop, Logger::Overflow::count } ) {
+                auto options = Logger::defaultAsyncOptions();
+                options.overflow = overflow;
+                Logger::async( options );
+                auto result = measure( threads, calls, payload );
+                Logger::flush();
+                cout << format << ";" << overflowName( overflow ) << ";" << threads << ";" << result << ";"
+                     << Logger::dropped() << endl;
+            }
+        }
+    }
+    Logger::synchronous();
+}
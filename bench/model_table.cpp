@@ -0,0 +1,48 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/repetier/model_table.hpp"
+#include "3dprnet/repetier/types.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+json makeModels( size_t count, size_t groups )
+{
+    json result = json::array();
+    for ( size_t i = 0 ; i < count ; ++i ) {
+        result.push_back( {
+                { "id", i + 1 },
+                { "name", "calibration_cube_" + to_string( i ) + "_0.2mm_PLA" },
+                { "group", "Customer Project " + to_string( i % groups ) },
+                { "created", 1514764800000 + i * 1000 },
+                { "length", 1024 * ( i + 1 ) },
+                { "layer", 100 + i % 50 },
+                { "lines", 20000 + i },
+                { "printTime", 3600.5 + i }
+        } );
+    }
+    return result;
+}
+
+int main( int argc, char const* const argv[] )
+{
+    size_t groups = argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : 20;
+
+    cout << "models;vector<Model> bytes/model;ModelTable bytes/model" << endl;
+    for ( size_t count : { 100, 1000, 10000, 100000 } ) {
+        auto src = makeModels( count, groups );
+
+        auto models = src.get< vector< rep::Model > >();
+        rep::ModelTable table = src;
+
+        cout << count << ";"
+             << static_cast< double >( rep::memory_usage( models ) ) / count << ";"
+             << static_cast< double >( table.memory_usage() ) / count << endl;
+    }
+}
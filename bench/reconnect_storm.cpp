@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/connect_limit.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "bench/bench.hpp"
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+using Clock = chrono::steady_clock;
+
+struct Options
+{
+    size_t services;
+    size_t threads;
+    size_t rounds;
+    size_t limit;
+    chrono::milliseconds backoff;
+};
+
+// resident set size of the process in kB
+size_t residentSize()
+{
+    size_t size {};
+    size_t resident {};
+    ifstream( "/proc/self/statm" ) >> size >> resident;
+    return resident * static_cast< size_t >( sysconf( _SC_PAGESIZE ) ) / 1024;
+}
+
+size_t openFiles()
+{
+    size_t result {};
+    if ( auto dir = opendir( "/proc/self/fd" ) ) {
+        while ( readdir( dir ) ) {
+            ++result;
+        }
+        closedir( dir );
+    }
+    return result > 3 ? result - 3 : 0; // ".", ".." and the descriptor of dir itself
+}
+
+chrono::microseconds processCpuTime()
+{
+    rusage usage {};
+    getrusage( RUSAGE_SELF, &usage );
+    return chrono::seconds( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec )
+           + chrono::microseconds( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec );
+}
+
+double milliseconds( Clock::duration duration )
+{
+    return chrono::duration< double, milli >( duration ).count();
+}
+
+vector< json > run( Options const& options )
+{
+    asio::io_context serverContext;
+    auto serverWork = asio::make_work_guard( serverContext );
+    auto mockOptions = rep::MockServer::defaultOptions();
+    mockOptions.eventRate = 0.0;
+    rep::MockServer mock( serverContext, mockOptions );
+    vector< thread > serverRunners;
+    for ( size_t i = 0 ; i < 2 ; ++i ) {
+        serverRunners.emplace_back( [&serverContext] { serverContext.run(); } );
+    }
+
+    asio::io_context context;
+    auto work = asio::make_work_guard( context );
+    vector< thread > runners;
+    for ( size_t i = 0 ; i < options.threads ; ++i ) {
+        runners.emplace_back( [&context] { context.run(); } );
+    }
+
+    auto limit = options.limit > 0 ? make_shared< rep::ConnectLimit >( options.limit ) : nullptr;
+
+    mutex mutex;
+    Clock::time_point stormStart;
+    vector< Clock::duration > reconnected;
+    atomic< size_t > loggedIn {};
+    vector< unique_ptr< rep::Service > > services;
+    for ( size_t i = 0 ; i < options.services ; ++i ) {
+        services.push_back( make_unique< rep::Service >( context, mock.endpoint() ) );
+        services.back()->reconnect( { options.backoff, rep::Service::defaultReconnect().cap, limit } );
+        services.back()->on_reconnect( [&] {
+            lock_guard< std::mutex > lock( mutex );
+            reconnected.push_back( Clock::now() - stormStart );
+            ++loggedIn;
+        } );
+    }
+
+    auto waitLoggedIn = [&]( Clock::time_point deadline, size_t& peakResident, size_t& peakFiles ) {
+        while ( loggedIn < options.services && Clock::now() < deadline ) {
+            peakResident = max( peakResident, residentSize() );
+            peakFiles = max( peakFiles, openFiles() );
+            this_thread::sleep_for( chrono::milliseconds( 1 ) );
+        }
+        return loggedIn == options.services;
+    };
+
+    size_t ignored {};
+    waitLoggedIn( Clock::now() + chrono::seconds( 60 ), ignored, ignored );
+
+    vector< json > results;
+    for ( size_t round = 0 ; round < options.rounds ; ++round ) {
+        auto baseResident = residentSize();
+        auto baseFiles = openFiles();
+        auto peakResident = baseResident;
+        auto peakFiles = baseFiles;
+        auto clientCpu = chrono::nanoseconds();
+        for ( auto& runner : runners ) {
+            clientCpu -= bench::cpuTime( runner );
+        }
+        auto processCpu = -processCpuTime();
+
+        {
+            lock_guard< std::mutex > lock( mutex );
+            reconnected.clear();
+            loggedIn = 0;
+            stormStart = Clock::now();
+        }
+        mock.disconnect_all();
+        auto complete = waitLoggedIn( stormStart + chrono::seconds( 120 ), peakResident, peakFiles );
+        auto elapsed = Clock::now() - stormStart;
+
+        for ( auto& runner : runners ) {
+            clientCpu += bench::cpuTime( runner );
+        }
+        processCpu += processCpuTime();
+
+        lock_guard< std::mutex > lock( mutex );
+        sort( reconnected.begin(), reconnected.end() );
+        auto percentile = [&]( double percentile ) {
+            return reconnected.empty() ? 0.0 : milliseconds(
+                    reconnected[ min( reconnected.size() - 1, static_cast< size_t >( percentile / 100.0 * reconnected.size() ) ) ] );
+        };
+        results.push_back( {
+                { "name", "reconnect_storm" },
+                { "params", {
+                        { "services", options.services },
+                        { "threads", options.threads },
+                        { "limit", options.limit },
+                        { "backoff_ms", options.backoff.count() } } },
+                { "round", round },
+                { "complete", complete },
+                { "logged_in", reconnected.size() },
+                { "time_to_all_ms", milliseconds( elapsed ) },
+                { "reconnect_ms", { { "p50", percentile( 50.0 ) }, { "p99", percentile( 99.0 ) }, { "max", percentile( 100.0 ) } } },
+                { "peak_resident_kb", peakResident },
+                { "resident_growth_kb", peakResident - baseResident },
+                { "peak_open_files", peakFiles },
+                { "client_cpu_ms", static_cast< double >( clientCpu.count() ) / 1e6 },
+                { "process_cpu_ms", static_cast< double >( processCpu.count() ) / 1e3 } } );
+    }
+
+    services.clear();
+    work.reset();
+    for ( auto& runner : runners ) {
+        runner.join();
+    }
+    serverWork.reset();
+    serverContext.stop();
+    for ( auto& runner : serverRunners ) {
+        runner.join();
+    }
+    return results;
+}
+
+/**
+ * Connects the given number of Service instances to a MockServer, closes all connections at once and measures how long
+ * it takes until all services are logged in again, together with the peak resident size and open files of the process
+ * and the cpu time spent. The process includes the server, so every connection counts twice in the open files. Linux
+ * only, as it reads /proc.
+ *
+ * Arguments: [<output.json> [<services> [<threads> [<rounds> [<limit>:<backoff ms>...]]]]], a limit of zero means
+ * none. The default configurations compare no limit and no backoff with a limit of 32, a backoff of 1s and both.
+ */
+int main( int argc, char const* const argv[] )
+{
+    string output = argc > 1 ? argv[ 1 ] : "-";
+    Options options {};
+    options.services = max< size_t >( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 200, 1 );
+    options.threads = max< size_t >( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : 2, 1 );
+    options.rounds = max< size_t >( argc > 4 ? strtoul( argv[ 4 ], nullptr, 10 ) : 3, 1 );
+    vector< pair< size_t, chrono::milliseconds > > configurations;
+    for ( int i = 5 ; i < argc ; ++i ) {
+        size_t limit {};
+        long backoff {};
+        if ( sscanf( argv[ i ], "%zu:%ld", &limit, &backoff ) != 2 ) {
+            cerr << "invalid configuration " << argv[ i ] << ", expected <limit>:<backoff ms>" << endl;
+            return 1;
+        }
+        configurations.emplace_back( limit, chrono::milliseconds( backoff ) );
+    }
+    if ( configurations.empty() ) {
+        configurations = { { 0, chrono::milliseconds( 0 ) }, { 32, chrono::milliseconds( 0 ) },
+                           { 0, chrono::milliseconds( 1000 ) }, { 32, chrono::milliseconds( 1000 ) } };
+    }
+
+    // every service logs its disconnect as an error
+    Logger::output( "/dev/null" );
+
+    bench::Report report( "reconnect_storm" );
+    for ( auto const& configuration : configurations ) {
+        options.limit = configuration.first;
+        options.backoff = configuration.second;
+        for ( auto&& result : run( options ) ) {
+            report.add( move( result ) );
+        }
+    }
+    report.write( output );
+}
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/filesystem.hpp"
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/capture.hpp"
+#include "3dprnet/repetier/client.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "bench/allocations.hpp"
+#include "bench/bench.hpp"
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+using Clock = chrono::steady_clock;
+
+struct Capture
+{
+    vector< rep::CaptureFrame > frames; // inbound only
+    uint64_t bytes;
+    set< string > events;
+    set< uint32_t > streams;
+};
+
+// a session of a Service with a MockServer: the printers with their configs and models, then temp events
+void record( filesystem::path const& path, chrono::seconds duration )
+{
+    asio::io_context context;
+    auto work = asio::make_work_guard( context );
+    auto mockOptions = rep::MockServer::defaultOptions();
+    mockOptions.printers = 20;
+    mockOptions.eventRate = 2000.0;
+    mockOptions.eventBatch = 10;
+    rep::MockServer mock( context, mockOptions );
+    thread runner( [&context] { context.run(); } );
+
+    {
+        auto writer = make_shared< rep::CaptureWriter >( path );
+        rep::Service service( context, mock.endpoint() );
+        service.capture( writer );
+        service.on_printers( [&service]( auto const& printers ) {
+            for ( auto const& printer : printers ) {
+                service.request_config( printer.slug() );
+                service.request_groups( printer.slug() );
+                service.request_models( printer.slug() );
+            }
+        } );
+        // without slots, the requests are not sent
+        service.on_config( []( auto, auto ) {} );
+        service.on_groups( []( auto, auto ) {} );
+        service.on_models( []( auto, auto ) {} );
+        service.request_printers();
+        this_thread::sleep_for( duration );
+        service.capture( nullptr );
+        writer->flush();
+        cerr << "recorded " << writer->frames() << " frames to " << path.string() << endl;
+    }
+
+    work.reset();
+    context.stop();
+    runner.join();
+}
+
+Capture load( filesystem::path const& path )
+{
+    ifstream in( filesystem::native_path( path ).c_str(), ios::binary );
+    if ( !in ) {
+        throw runtime_error( "unable to open capture " + path.string() );
+    }
+
+    Capture result {};
+    rep::CaptureReader reader( in );
+    rep::CaptureFrame frame;
+    while ( reader.next( frame ) ) {
+        if ( frame.direction != rep::CaptureFrame::Direction::inbound ) {
+            continue;
+        }
+        auto message = json::parse( frame.payload );
+        if ( message.value( "eventList", false ) ) {
+            for ( auto const& event : message.at( "data" ) ) {
+                result.events.insert( event.at( "event" ).get< string >() );
+            }
+        }
+        result.bytes += frame.payload.size();
+        result.streams.insert( frame.stream );
+        result.frames.push_back( move( frame ) );
+    }
+    return result;
+}
+
+double microseconds( Clock::duration duration )
+{
+    return chrono::duration< double, micro >( duration ).count();
+}
+
+/**
+ * One client per stream of the capture that is never connected, with a counting handler for every event type of the
+ * capture. Each connection recorded is replayed into a client of its own, so the sessions do not mix.
+ */
+struct Replayer
+{
+    explicit Replayer( Capture const& capture )
+            : metrics( make_shared< rep::Metrics >() )
+    {
+        for ( auto stream : capture.streams ) {
+            auto& client = *clients.emplace( stream, make_unique< rep::Client >( context, []( auto ) {} ) )
+                    .first->second;
+            client.metrics( metrics );
+            for ( auto const& type : capture.events ) {
+                client.subscribe( type, [this]( auto, auto const& ) { ++events; } );
+            }
+        }
+    }
+
+    void replay( rep::CaptureFrame const& frame )
+    {
+        clients.find( frame.stream )->second->replay( frame.payload );
+    }
+
+    asio::io_context context;
+    map< uint32_t, unique_ptr< rep::Client > > clients;
+    shared_ptr< rep::Metrics > metrics;
+    uint64_t events {};
+};
+
+json replayFast( Capture const& capture, string const& name, size_t loops )
+{
+    Replayer replayer( capture );
+
+    // warm up
+    for ( auto const& frame : capture.frames ) {
+        replayer.replay( frame );
+    }
+    replayer.events = 0;
+
+    vector< double > seconds;
+    bench::countAllocations( true );
+    auto allocations = bench::allocations();
+    for ( size_t i = 0 ; i < loops ; ++i ) {
+        auto start = Clock::now();
+        for ( auto const& frame : capture.frames ) {
+            replayer.replay( frame );
+        }
+        seconds.push_back( chrono::duration< double >( Clock::now() - start ).count() );
+    }
+    allocations = bench::allocations() - allocations;
+    bench::countAllocations( false );
+
+    sort( seconds.begin(), seconds.end() );
+    auto median = seconds[ seconds.size() / 2 ];
+    auto frames = static_cast< double >( max< size_t >( capture.frames.size(), 1 ) );
+    auto dispatch = replayer.metrics->snapshot().dispatch;
+    return {
+            { "name", "replay" },
+            { "params", { { "capture", name }, { "mode", "fast" }, { "loops", loops } } },
+            { "frames", capture.frames.size() },
+            { "streams", capture.streams.size() },
+            { "events", replayer.events / loops },
+            { "seconds", { { "min", seconds.front() }, { "median", median }, { "max", seconds.back() } } },
+            { "frames_per_s", frames / median },
+            { "events_per_s", static_cast< double >( replayer.events / loops ) / median },
+            { "bytes_per_s", static_cast< double >( capture.bytes ) / median },
+            { "allocations_per_frame", static_cast< double >( allocations ) / loops / frames },
+            { "dispatch_ns", { { "p50", dispatch.percentile( 50.0 ) }, { "p99", dispatch.percentile( 99.0 ) },
+                               { "max", dispatch.max } } } };
+}
+
+json replayRealtime( Capture const& capture, string const& name )
+{
+    Replayer replayer( capture );
+    if ( capture.frames.empty() ) {
+        return { { "name", "replay" }, { "params", { { "capture", name }, { "mode", "realtime" } } }, { "frames", 0 } };
+    }
+
+    vector< Clock::duration > lags;
+    Clock::duration busy {};
+    auto offset = capture.frames.front().time;
+    auto start = Clock::now();
+    for ( auto const& frame : capture.frames ) {
+        auto due = start + chrono::duration_cast< Clock::duration >( frame.time - offset );
+        this_thread::sleep_until( due );
+        auto begin = Clock::now();
+        replayer.replay( frame );
+        auto end = Clock::now();
+        lags.push_back( begin - due );
+        busy += end - begin;
+    }
+    auto elapsed = Clock::now() - start;
+
+    sort( lags.begin(), lags.end() );
+    auto percentile = [&]( double percentile ) {
+        return microseconds( lags[ min( lags.size() - 1, static_cast< size_t >( percentile / 100.0 * lags.size() ) ) ] );
+    };
+    return {
+            { "name", "replay" },
+            { "params", { { "capture", name }, { "mode", "realtime" } } },
+            { "frames", capture.frames.size() },
+            { "events", replayer.events },
+            { "seconds", chrono::duration< double >( elapsed ).count() },
+            { "busy_fraction", static_cast< double >( busy.count() ) / static_cast< double >( elapsed.count() ) },
+            { "lag_us", { { "p50", percentile( 50.0 ) }, { "p99", percentile( 99.0 ) }, { "max", percentile( 100.0 ) } } } };
+}
+
+/**
+ * Replays the inbound frames of a capture written by Client::capture() through the parsing and dispatch of a Client
+ * without a connection per stream, into one counting handler per event type. "fast" replays the capture loops times
+ * back to back and reports the throughput and allocations, "realtime" replays it once at the pace it was recorded and
+ * reports how late the frames were handled and the share of time spent handling them. Without a capture, one is
+ * recorded from a MockServer first.
+ *
+ * Arguments: [<output.json> [<capture> [<loops> [fast|realtime|both]]]], a capture of "-" records one.
+ */
+int main( int argc, char const* const argv[] )
+{
+    string output = argc > 1 ? argv[ 1 ] : "-";
+    string path = argc > 2 ? argv[ 2 ] : "-";
+    size_t loops = max< size_t >( argc > 3 ? strtoul( argv[ 3 ], nullptr, 10 ) : 20, 1 );
+    string mode = argc > 4 ? argv[ 4 ] : "both";
+
+    Logger::threshold( Logger::Level::error );
+
+    string name = path;
+    filesystem::path recorded;
+    if ( path == "-" ) {
+        recorded = filesystem::temp_directory_path() / "bench_replay.capture";
+        record( recorded, chrono::seconds( 3 ) );
+        name = "mock";
+        path = recorded.string();
+    }
+    auto capture = load( path );
+    if ( !recorded.empty() ) {
+        filesystem::remove( recorded );
+    }
+
+    bench::Report report( "replay" );
+    if ( mode == "fast" || mode == "both" ) {
+        report.add( replayFast( capture, name, loops ) );
+    }
+    if ( mode == "realtime" || mode == "both" ) {
+        report.add( replayRealtime( capture, name ) );
+    }
+    report.write( output );
+}
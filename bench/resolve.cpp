@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/client.hpp"
+#include "3dprnet/repetier/resolver_cache.hpp"
+#include "3dprnet/repetier/types.hpp"
+#include "bench/bench.hpp"
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+using tcp = asio::ip::tcp;
+using Clock = chrono::steady_clock;
+
+/**
+ * A listening socket whose backlog is filled up, so that further connection attempts are neither accepted nor refused
+ * but time out, like those to an address family without a route.
+ */
+struct Blackhole
+{
+    explicit Blackhole( asio::io_context& context )
+            : acceptor( context, tcp::endpoint( asio::ip::make_address( "127.0.0.1" ), 0 ), false )
+    {
+        acceptor.listen( 0 );
+        for ( int i = 0 ; i < 4 ; ++i ) {
+            fillers.emplace_back( context );
+            fillers.back().async_connect( acceptor.local_endpoint(), []( auto ) {} );
+        }
+    }
+
+    tcp::acceptor acceptor;
+    vector< tcp::socket > fillers;
+};
+
+/**
+ * Stands in for a DNS server answering after latency with the given endpoints.
+ */
+rep::ResolverCache::Resolve standIn( chrono::milliseconds latency, rep::ResolverCache::Endpoints endpoints )
+{
+    return [latency, endpoints]( asio::io_context& context, auto const&, auto const&, auto handler ) {
+        auto timer = make_shared< asio::steady_timer >( context, latency );
+        timer->async_wait( [timer, endpoints, handler]( auto ) { handler( {}, endpoints ); } );
+    };
+}
+
+double milliseconds( Clock::duration duration )
+{
+    return chrono::duration< double, milli >( duration ).count();
+}
+
+json percentiles( vector< Clock::duration > durations )
+{
+    sort( durations.begin(), durations.end() );
+    auto percentile = [&]( double percentile ) {
+        return milliseconds( durations[ min( durations.size() - 1,
+                                             static_cast< size_t >( percentile / 100.0 * durations.size() ) ) ] );
+    };
+    return { { "p50", percentile( 50.0 ) }, { "p99", percentile( 99.0 ) }, { "max", percentile( 100.0 ) } };
+}
+
+/**
+ * Connects a fresh client connections times in a row, like reconnects, and measures the time until each was
+ * established.
+ */
+json run( asio::io_context& context, rep::Endpoint const& endpoint, string name, json params,
+          shared_ptr< rep::ResolverCache > const& resolver, size_t connections )
+{
+    vector< Clock::duration > durations;
+    size_t failed {};
+    for ( size_t i = 0 ; i < connections ; ++i ) {
+        promise< bool > connected;
+        rep::Client client( context, [&connected]( auto ) { connected.set_value( false ); } );
+        client.resolver( resolver );
+        auto start = Clock::now();
+        asio::post( context, [&] { client.connect( endpoint, [&connected] { connected.set_value( true ); } ); } );
+        if ( connected.get_future().get() ) {
+            durations.push_back( Clock::now() - start );
+        } else {
+            ++failed;
+        }
+    }
+
+    return {
+            { "name", move( name ) },
+            { "params", move( params ) },
+            { "connections", connections },
+            { "failed", failed },
+            { "resolutions", resolver->misses() },
+            { "connect_ms", durations.empty() ? json() : percentiles( durations ) } };
+}
+
+/**
+ * Measures establishing client connections to a MockServer through a ResolverCache with a stand-in resolver of the
+ * given latency. "reconnect" connects repeatedly with and without caching. "dual_stack" resolves to an address that
+ * does not answer followed by the server, for several delays between the connection attempts; connecting to the
+ * addresses one after the other would wait for the connect timeout of the operating system instead.
+ *
+ * Arguments: [<output.json> [<connections> [<latency ms>]]]
+ */
+int main( int argc, char const* const argv[] )
+{
+    string output = argc > 1 ? argv[ 1 ] : "-";
+    size_t connections = max< size_t >( argc > 2 ? strtoul( argv[ 2 ], nullptr, 10 ) : 50, 1 );
+    chrono::milliseconds latency( argc > 3 ? strtol( argv[ 3 ], nullptr, 10 ) : 100 );
+
+    Logger::threshold( Logger::Level::error );
+
+    asio::io_context context;
+    auto work = asio::make_work_guard( context );
+    rep::MockServer mock( context );
+    Blackhole blackhole( context );
+    thread runner( [&context] { context.run(); } );
+
+    auto endpoint = mock.endpoint();
+    tcp::endpoint server( asio::ip::make_address( endpoint.host() ),
+                          static_cast< unsigned short >( strtoul( endpoint.port().c_str(), nullptr, 10 ) ) );
+
+    bench::Report report( "resolve" );
+    for ( auto ttl : { chrono::seconds( 0 ), chrono::seconds( 60 ) } ) {
+        auto options = rep::ResolverCache::defaultOptions();
+        options.ttl = ttl;
+        options.resolve = standIn( latency, { server } );
+        report.add( run( context, endpoint, "reconnect",
+                         { { "latency_ms", latency.count() }, { "ttl_s", ttl.count() } },
+                         make_shared< rep::ResolverCache >( options ), connections ) );
+    }
+    for ( auto delay : { chrono::milliseconds( 50 ), chrono::milliseconds( 250 ) } ) {
+        auto options = rep::ResolverCache::defaultOptions();
+        options.attemptDelay = delay;
+        options.resolve = standIn( latency, { blackhole.acceptor.local_endpoint(), server } );
+        report.add( run( context, endpoint, "dual_stack",
+                         { { "latency_ms", latency.count() }, { "attempt_delay_ms", delay.count() } },
+                         make_shared< rep::ResolverCache >( options ), max< size_t >( connections / 10, 1 ) ) );
+    }
+    report.write( output );
+
+    work.reset();
+    context.stop();
+    runner.join();
+}
@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "3dprnet/core/logging.hpp"
+
+using namespace std;
+using namespace prnet;
+
+class NullBuffer
+        : public streambuf
+{
+protected:
+    int_type overflow( int_type ch ) override { return ch; }
+    streamsize xsputn( char const*, streamsize count ) override { return count; }
+};
+
+// the formatting of the log prefix before the timestamp cache was introduced
+ostream& legacyTimestamp( ostream& os )
+{
+    auto timestamp { chrono::high_resolution_clock::now().time_since_epoch() };
+    auto seconds { chrono::duration_cast< chrono::seconds >( timestamp ) };
+    auto micros { chrono::duration_cast< chrono::microseconds >( timestamp - seconds ) };
+    time_t tt { seconds.count() };
+    tm* tm { localtime( &tt ) };
+
+    return os
+            << setw( 4 ) << setfill( '0' ) << ( tm->tm_year + 1900 ) << "/"
+            << setw( 2 ) << setfill( '0' ) << ( tm->tm_mon + 1 ) << "/"
+            << setw( 2 ) << setfill( '0' ) << tm->tm_mday << " "
+            << setw( 2 ) << setfill( '0' ) << tm->tm_hour << ":"
+            << setw( 2 ) << setfill( '0' ) << tm->tm_min << ":"
+            << setw( 2 ) << setfill( '0' ) << tm->tm_sec << "."
+            << setw( 6 ) << setfill( '0' ) << micros.count();
+}
+
+ostream& legacyPid( ostream& os )
+{
+    return os << setw( 5 ) << setfill( ' ' ) << getpid();
+}
+
+template< typename Func >
+double measure( size_t calls, Func&& func )
+{
+    auto start = chrono::steady_clock::now();
+    for ( size_t i = 0 ; i < calls ; ++i ) {
+        func();
+    }
+    auto elapsed = chrono::steady_clock::now() - start;
+    return static_cast< double >( chrono::duration_cast< chrono::nanoseconds >( elapsed ).count() ) / calls;
+}
+
+/**
+ * Cost of the timestamp and pid part of the log prefix per call, written to a stream that discards its input.
+ */
+int main( int argc, char const* const argv[] )
+{
+    size_t calls = argc > 1 ? strtoul( argv[ 1 ], nullptr, 10 ) : 1000000;
+
+    NullBuffer buffer;
+    ostream os( &buffer );
+
+    cout << "variant;ns/call" << endl;
+    cout << "legacy logTimestamp+logPid;" << measure( calls, [&] { os << legacyTimestamp << " [" << legacyPid << "] "; } ) << endl;
+    cout << "logTimestamp+logPid;" << measure( calls, [&] { os << detail::logTimestamp << " [" << detail::logPid << "] "; } ) << endl;
+    cout << "formatTimestamp;" << measure( calls, [&] {
+        char timestamp[ detail::timestampLength ];
+        os.write( timestamp, static_cast< streamsize >( detail::formatTimestamp( timestamp, chrono::system_clock::now() ) ) );
+    } ) << endl;
+}
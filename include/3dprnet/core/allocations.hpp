@@ -0,0 +1,117 @@
+#ifndef LIB3DPRNET_CORE_ALLOCATIONS_HPP
+#define LIB3DPRNET_CORE_ALLOCATIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "3dprnet/core/config.hpp"
+
+namespace prnet {
+
+/**
+ * Allocation tracking
+ *
+ * If the library is built with PRNET_TRACK_ALLOCATIONS (the CMake option of the same name), it replaces the global
+ * operator new and counts every allocation and its bytes by the tag of the innermost AllocationScope on the allocating
+ * thread. The library opens scopes at its entry points and in its handlers, so allocations of application slots are
+ * counted under the tag of the library code that invoked them. A scope must not span a coroutine yield, so allocations
+ * within the asynchronous operations of Asio and Beast count under the tag of the thread running the io_context, other
+ * unless the application opens a scope there. Replacing operator new from a shared library relies on symbol
+ * interposition, which Windows does not offer. Without PRNET_TRACK_ALLOCATIONS all of this compiles to nothing.
+ */
+
+enum class AllocationTag : std::uint8_t
+{
+    other,
+    client,
+    service,
+    frontend,
+    upload,
+    logging
+};
+
+static constexpr std::size_t allocationTagCount = 6;
+
+#if defined( PRNET_TRACK_ALLOCATIONS )
+static constexpr bool allocationTracking = true;
+#else
+static constexpr bool allocationTracking = false;
+#endif
+
+char const* PRNET_DLL allocationTagName( AllocationTag tag );
+
+struct AllocationStats
+{
+    AllocationTag tag;
+    std::uint64_t allocations;
+    std::uint64_t bytes;
+};
+
+/**
+ * Allocations since the start of the process by tag, empty without PRNET_TRACK_ALLOCATIONS.
+ */
+std::vector< AllocationStats > PRNET_DLL allocationStats();
+
+namespace detail {
+
+/**
+ * Counts one allocation, for programs that replace operator new themselves and would hide the replacement of the
+ * library otherwise.
+ */
+void PRNET_DLL trackAllocation( std::size_t size );
+
+AllocationTag& PRNET_DLL allocationTag();
+std::uint64_t PRNET_DLL allocationCount();
+
+} // namespace detail
+
+/**
+ * Allocations of the calling thread so far, for attributing them to one piece of work. Zero without
+ * PRNET_TRACK_ALLOCATIONS.
+ */
+inline std::uint64_t threadAllocations()
+{
+#if defined( PRNET_TRACK_ALLOCATIONS )
+    return detail::allocationCount();
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * class AllocationScope
+ *
+ * Counts the allocations of the calling thread under tag until it is destroyed.
+ */
+
+class AllocationScope
+{
+public:
+#if defined( PRNET_TRACK_ALLOCATIONS )
+    explicit AllocationScope( AllocationTag tag )
+            : previous_( detail::allocationTag() )
+    {
+        detail::allocationTag() = tag;
+    }
+
+    ~AllocationScope()
+    {
+        detail::allocationTag() = previous_;
+    }
+#else
+    explicit AllocationScope( AllocationTag ) {}
+#endif
+
+    AllocationScope( AllocationScope const& ) = delete;
+
+#if defined( PRNET_TRACK_ALLOCATIONS )
+private:
+    AllocationTag previous_;
+#endif
+};
+
+} // namespace prnet
+
+#endif // LIB3DPRNET_CORE_ALLOCATIONS_HPP
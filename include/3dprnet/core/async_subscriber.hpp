@@ -0,0 +1,260 @@
+#ifndef LIB3DPRNET_CORE_ASYNC_SUBSCRIBER_HPP
+#define LIB3DPRNET_CORE_ASYNC_SUBSCRIBER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/asio/executor.hpp>
+#include <boost/asio/post.hpp>
+
+#include "3dprnet/core/config.hpp"
+#include "3dprnet/core/logging.hpp"
+
+namespace prnet {
+
+namespace detail {
+
+inline Logger& subscriberLogger()
+{
+    static Logger logger( "AsyncSubscriber" );
+    return logger;
+}
+
+} // namespace detail
+
+
+/**
+ * enum class QueuePolicy
+ */
+
+enum class QueuePolicy
+{
+    /** never drops a queued event, rejects new events while full and counts them as overflows */
+    keepAll,
+    /** keeps only the most recent event per key, dropping the oldest key when full */
+    latestPerKey,
+    /** drops the oldest event when full */
+    dropOldest
+};
+
+
+/**
+ * struct SubscriberStats
+ */
+
+struct SubscriberStats
+{
+    std::size_t depth;
+    std::size_t highWater;
+    std::size_t delivered;
+    std::size_t dropped; // queued events replaced by newer ones because the queue was full
+    std::size_t coalesced;
+    std::size_t overflows; // new events rejected because the queue was full
+    std::size_t failed; // events whose handler threw, they count as delivered
+    std::chrono::microseconds lastLag;
+    std::chrono::microseconds maxLag;
+};
+
+
+/**
+ * class AsyncSubscriber
+ *
+ * Decouples a slot from the thread emitting a signal. Every subscriber owns a bounded queue which is filled by the
+ * callable returned from slot() and drained on its own executor, so a slow consumer only delays itself. The emitting
+ * thread is never blocked, a full queue loses events as its QueuePolicy says. Exceptions thrown by the handler are
+ * logged and do not stop the delivery of the following events.
+ */
+
+template< typename Signature >
+class AsyncSubscriber;
+
+template< typename ...Args >
+class AsyncSubscriber< void ( Args... ) >
+        : public std::enable_shared_from_this< AsyncSubscriber< void ( Args... ) > >
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Handler = std::function< void ( Args... ) >;
+    using KeyFunction = std::function< std::string ( std::decay_t< Args > const&... ) >;
+
+private:
+    using Lock = std::lock_guard< std::mutex >;
+    using Arguments = std::tuple< std::decay_t< Args >... >;
+
+    struct Entry
+    {
+        Arguments args;
+        Clock::time_point enqueued;
+        std::string key;
+    };
+
+    using Queue = std::list< Entry >;
+
+    struct Private {};
+
+public:
+    /**
+     * Creates a subscriber draining on executor. A key function is required for QueuePolicy::latestPerKey.
+     */
+    static std::shared_ptr< AsyncSubscriber > create( boost::asio::executor executor, QueuePolicy policy,
+                                                      std::size_t capacity, Handler handler,
+                                                      KeyFunction key = nullptr )
+    {
+        return std::make_shared< AsyncSubscriber >( Private(), std::move( executor ), policy, capacity,
+                                                    std::move( handler ), std::move( key ) );
+    }
+
+    AsyncSubscriber( Private, boost::asio::executor executor, QueuePolicy policy, std::size_t capacity,
+                     Handler handler, KeyFunction key )
+            : executor_( std::move( executor ) )
+            , policy_( policy )
+            , capacity_( std::max< std::size_t >( capacity, 1 ) )
+            , handler_( std::move( handler ) )
+            , key_( std::move( key ) )
+    {
+        if ( policy_ == QueuePolicy::latestPerKey && !key_ ) {
+            throw std::invalid_argument( "latestPerKey requires a key function" );
+        }
+    }
+
+    AsyncSubscriber( AsyncSubscriber const& ) = delete;
+
+    /**
+     * Returns a callable suitable to be connected to a signal. It only holds a weak reference, events arriving after
+     * the subscriber has been destroyed are discarded.
+     */
+    std::function< void ( Args... ) > slot()
+    {
+        std::weak_ptr< AsyncSubscriber > weak = this->shared_from_this();
+        return [weak]( Args... args ) {
+            if ( auto self = weak.lock() ) {
+                self->push( Arguments( std::forward< Args >( args )... ) );
+            }
+        };
+    }
+
+    SubscriberStats stats() const
+    {
+        Lock lock( mutex_ );
+
+        auto stats = stats_;
+        stats.depth = queue_.size();
+        return stats;
+    }
+
+private:
+    void push( Arguments&& args )
+    {
+        auto now = Clock::now();
+        std::string key = policy_ == QueuePolicy::latestPerKey ? apply( key_, args ) : std::string();
+
+        Lock lock( mutex_ );
+
+        if ( policy_ == QueuePolicy::latestPerKey ) {
+            auto it = keys_.find( key );
+            if ( it != keys_.end() ) {
+                it->second->args = std::move( args );
+                ++stats_.coalesced;
+                return;
+            }
+        }
+
+        if ( queue_.size() >= capacity_ ) {
+            if ( policy_ == QueuePolicy::keepAll ) {
+                ++stats_.overflows;
+                return;
+            }
+            keys_.erase( queue_.front().key );
+            queue_.pop_front();
+            ++stats_.dropped;
+        }
+
+        queue_.push_back( { std::move( args ), now, std::move( key ) } );
+        if ( policy_ == QueuePolicy::latestPerKey ) {
+            keys_.emplace( queue_.back().key, std::prev( queue_.end() ) );
+        }
+        stats_.highWater = std::max( stats_.highWater, queue_.size() );
+
+        if ( !scheduled_ ) {
+            scheduled_ = true;
+            boost::asio::post( executor_, [self = this->shared_from_this()] { self->drain(); } );
+        }
+    }
+
+    void drain()
+    {
+        // only one drain is scheduled at a time, so events keep their order even on a multi-threaded executor
+        while ( true ) {
+            Queue batch;
+            {
+                Lock lock( mutex_ );
+                if ( queue_.empty() ) {
+                    scheduled_ = false;
+                    return;
+                }
+                batch.swap( queue_ );
+                keys_.clear();
+            }
+
+            for ( auto& entry : batch ) {
+                auto lag = std::chrono::duration_cast< std::chrono::microseconds >( Clock::now() - entry.enqueued );
+                bool failed = false;
+                try {
+                    apply( handler_, std::move( entry.args ) );
+                } catch ( std::exception const& e ) {
+                    detail::subscriberLogger().error( "exception in subscriber: ", e.what() );
+                    failed = true;
+                } catch ( ... ) {
+                    detail::subscriberLogger().error( "unknown exception in subscriber" );
+                    failed = true;
+                }
+
+                Lock lock( mutex_ );
+                ++stats_.delivered;
+                stats_.failed += failed ? 1 : 0;
+                stats_.lastLag = lag;
+                stats_.maxLag = std::max( stats_.maxLag, lag );
+            }
+        }
+    }
+
+    template< typename Func, typename Tuple >
+    static decltype( auto ) apply( Func& func, Tuple&& args )
+    {
+        return apply( func, std::forward< Tuple >( args ), std::index_sequence_for< Args... >() );
+    }
+
+    template< typename Func, typename Tuple, std::size_t ...Is >
+    static decltype( auto ) apply( Func& func, Tuple&& args, std::index_sequence< Is... > )
+    {
+        return func( std::get< Is >( std::forward< Tuple >( args ) )... );
+    }
+
+    boost::asio::executor executor_;
+    QueuePolicy policy_;
+    std::size_t capacity_;
+    Handler handler_;
+    KeyFunction key_;
+    Queue queue_;
+    std::unordered_map< std::string, typename Queue::iterator > keys_;
+    bool scheduled_ {};
+    SubscriberStats stats_ {};
+    mutable std::mutex mutex_;
+};
+
+} // namespace prnet
+
+#endif // LIB3DPRNET_CORE_ASYNC_SUBSCRIBER_HPP
@@ -0,0 +1,277 @@
+#ifndef LIB3DPRNET_CORE_BINARY_LOG_HPP
+#define LIB3DPRNET_CORE_BINARY_LOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "3dprnet/core/config.hpp"
+
+namespace prnet {
+
+/**
+ * Binary log format
+ *
+ * A file consists of segments, one per process that appended to it. A segment starts with the magic "PRNETBL1" and
+ * the pid as varint, followed by entries that start with one type byte:
+ *
+ *   tag      varint id, varint length, text
+ *   literal  varint id, varint length, text
+ *   record   varint tag id, level byte, zigzag varint microseconds since the previous record, varint length, arguments
+ *
+ * Tags and string literals are defined once per segment before the first record that references them. Every argument
+ * starts with a type byte: literal (varint id), string (varint length, text), signed (zigzag varint), unsigned
+ * (varint) or floating (eight bytes little endian IEEE 754). Arguments of any other type are formatted to a string.
+ */
+
+namespace detail {
+
+enum class BinaryLogEntry : std::uint8_t
+{
+	tag = 1,
+	literal = 2,
+	record = 3
+};
+
+enum class BinaryLogArg : std::uint8_t
+{
+	literal = 1,
+	string = 2,
+	signedInt = 3,
+	unsignedInt = 4,
+	floating = 5
+};
+
+static constexpr char binaryLogMagic[] = "PRNETBL1";
+static constexpr std::uint32_t binaryLogNoLiteral = UINT32_MAX;
+
+/**
+ * Returns the id of a string literal, or binaryLogNoLiteral if the array is not a literal but a buffer whose content
+ * changed since it was registered.
+ */
+std::uint32_t PRNET_DLL binaryLiteral( char const* text, std::size_t length );
+
+inline void binaryVarint( std::string& out, std::uint64_t value )
+{
+	while ( value >= 0x80 ) {
+		out.push_back( static_cast< char >( value | 0x80 ) );
+		value >>= 7;
+	}
+	out.push_back( static_cast< char >( value ) );
+}
+
+inline std::uint64_t binaryZigzag( std::int64_t value )
+{
+	return ( static_cast< std::uint64_t >( value ) << 1 ) ^ static_cast< std::uint64_t >( value >> 63 );
+}
+
+inline void binaryString( std::string& out, char const* text, std::size_t length )
+{
+	out.push_back( static_cast< char >( BinaryLogArg::string ) );
+	binaryVarint( out, length );
+	out.append( text, length );
+}
+
+template< typename T >
+using BinaryLogKind = std::integral_constant< int,
+		std::is_same< T, bool >::value ? 1 :
+		std::is_same< T, char >::value || std::is_same< T, signed char >::value
+				|| std::is_same< T, unsigned char >::value ? 2 :
+		std::is_integral< T >::value && std::is_signed< T >::value ? 3 :
+		std::is_integral< T >::value ? 4 :
+		std::is_floating_point< T >::value ? 5 :
+		std::is_same< T, char const* >::value || std::is_same< T, char* >::value ? 6 :
+		std::is_same< T, std::string >::value ? 7 : 0 >;
+
+template< typename T >
+void binaryValue( std::string& out, T const& value, std::integral_constant< int, 0 > )
+{
+	std::ostringstream os;
+	os << value;
+	auto text = os.str();
+	binaryString( out, text.data(), text.size() );
+}
+
+inline void binaryValue( std::string& out, bool value, std::integral_constant< int, 1 > )
+{
+	out.push_back( static_cast< char >( BinaryLogArg::unsignedInt ) );
+	binaryVarint( out, value ? 1 : 0 );
+}
+
+template< typename T >
+void binaryValue( std::string& out, T value, std::integral_constant< int, 2 > )
+{
+	auto ch = static_cast< char >( value );
+	binaryString( out, &ch, 1 );
+}
+
+template< typename T >
+void binaryValue( std::string& out, T value, std::integral_constant< int, 3 > )
+{
+	out.push_back( static_cast< char >( BinaryLogArg::signedInt ) );
+	binaryVarint( out, binaryZigzag( value ) );
+}
+
+template< typename T >
+void binaryValue( std::string& out, T value, std::integral_constant< int, 4 > )
+{
+	out.push_back( static_cast< char >( BinaryLogArg::unsignedInt ) );
+	binaryVarint( out, value );
+}
+
+template< typename T >
+void binaryValue( std::string& out, T value, std::integral_constant< int, 5 > )
+{
+	auto converted = static_cast< double >( value );
+	std::uint64_t bits;
+	std::memcpy( &bits, &converted, sizeof( bits ) );
+	out.push_back( static_cast< char >( BinaryLogArg::floating ) );
+	for ( int i = 0 ; i < 8 ; ++i ) {
+		out.push_back( static_cast< char >( bits >> ( i * 8 ) ) );
+	}
+}
+
+inline void binaryValue( std::string& out, char const* value, std::integral_constant< int, 6 > )
+{
+	binaryString( out, value, std::strlen( value ) );
+}
+
+inline void binaryValue( std::string& out, std::string const& value, std::integral_constant< int, 7 > )
+{
+	binaryString( out, value.data(), value.size() );
+}
+
+template< typename T >
+void binaryArg( std::string& out, T const& value )
+{
+	binaryValue( out, value, BinaryLogKind< std::decay_t< T > >() );
+}
+
+template< std::size_t N >
+void binaryArg( std::string& out, char const ( &value )[ N ] )
+{
+	auto length = std::strlen( value );
+	auto id = binaryLiteral( value, length );
+	if ( id == binaryLogNoLiteral ) {
+		binaryString( out, value, length );
+	} else {
+		out.push_back( static_cast< char >( BinaryLogArg::literal ) );
+		binaryVarint( out, id );
+	}
+}
+
+inline void binaryAppend( std::string& )
+{
+}
+
+template< typename Arg0, typename ...Args >
+void binaryAppend( std::string& out, Arg0&& arg0, Args&&... args )
+{
+	binaryArg( out, arg0 );
+	binaryAppend( out, std::forward< Args >( args )... );
+}
+
+/**
+ * class BinaryLogRegistry
+ *
+ * Process wide ids of tags and string literals.
+ */
+
+class PRNET_DLL BinaryLogRegistry
+{
+public:
+	static BinaryLogRegistry& instance();
+
+	BinaryLogRegistry( BinaryLogRegistry const& ) = delete;
+	~BinaryLogRegistry();
+
+	std::uint32_t tag( std::string const& text );
+	std::uint32_t literal( char const* text, std::size_t length );
+
+	/**
+	 * The references stay valid for the lifetime of the registry.
+	 */
+	std::string const& tagText( std::uint32_t id ) const;
+	std::string const& literalText( std::uint32_t id ) const;
+
+private:
+	class Impl;
+
+	BinaryLogRegistry();
+
+	std::unique_ptr< Impl > impl_;
+};
+
+
+/**
+ * class BinaryLogWriter
+ *
+ * Appends records to a binary log file and defines their tags and literals on first use. Not thread-safe.
+ */
+
+class PRNET_DLL BinaryLogWriter
+{
+public:
+	explicit BinaryLogWriter( char const* path );
+	BinaryLogWriter( BinaryLogWriter const& ) = delete;
+
+	void append( std::uint32_t tag, unsigned level, std::int64_t time, char const* args, std::size_t length );
+	void flush();
+
+private:
+	void define( BinaryLogEntry entry, std::uint32_t id, std::vector< bool >& defined );
+
+	std::ofstream out_;
+	std::string buffer_;
+	std::vector< bool > tags_;
+	std::vector< bool > literals_;
+	std::int64_t lastTime_ {};
+};
+
+} // namespace detail
+
+
+/**
+ * class BinaryLogReader
+ *
+ * Renders a binary log in the text format of the Logger. Throws std::runtime_error on corrupt input.
+ */
+
+class PRNET_DLL BinaryLogReader
+{
+public:
+	explicit BinaryLogReader( std::istream& in );
+	BinaryLogReader( BinaryLogReader const& ) = delete;
+
+	/**
+	 * Writes the next record as one line to out, returns false at the end of the log.
+	 */
+	bool next( std::ostream& out );
+
+private:
+	void render( std::ostream& out );
+	std::uint64_t varint();
+	std::uint8_t byte();
+	std::string text();
+	void segment();
+
+	std::istream& in_;
+	std::string pid_;
+	std::vector< std::string > tags_;
+	std::vector< std::string > literals_;
+	std::int64_t lastTime_ {};
+	std::string args_;
+};
+
+} // namespace prnet
+
+#endif // LIB3DPRNET_CORE_BINARY_LOG_HPP
@@ -36,7 +36,9 @@ private:
 template< typename To >
 std::string convert( std::string const& value )
 {
-    return static_cast< std::ostringstream& >( std::ostringstream() << ToUtf8( value ) ).str();
+    std::ostringstream os;
+    os << To( value );
+    return os.str();
 }
 
 } // namespace enc
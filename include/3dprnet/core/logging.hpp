@@ -1,19 +1,55 @@
 #ifndef LIUB3DPRNET_CORE_LOGGING_HPP
 #define LIUB3DPRNET_CORE_LOGGING_HPP
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
 
+#include "3dprnet/core/allocations.hpp"
+#include "3dprnet/core/binary_log.hpp"
 #include "3dprnet/core/config.hpp"
 
+/**
+ * Least severe level that is compiled in (3 debug, 2 info, 1 warning, 0 error). Calls through the PRNET_LOG_* macros
+ * below that level are removed completely, including the evaluation of their arguments.
+ */
+#if !defined( PRNET_LOG_MIN_LEVEL )
+#   define PRNET_LOG_MIN_LEVEL 3
+#endif
+
+/**
+ * Log macros that evaluate their arguments only if the level is enabled for the logger.
+ */
+#define PRNET_LOG( logger, level, value, ... ) \
+	do { \
+		if ( PRNET_LOG_MIN_LEVEL >= value && ( logger ).enabled( ::prnet::Logger::Level::level ) ) { \
+			( logger ).level( __VA_ARGS__ ); \
+		} \
+	} while ( false )
+
+#define PRNET_LOG_DEBUG( logger, ... ) PRNET_LOG( logger, debug, 3, __VA_ARGS__ )
+#define PRNET_LOG_INFO( logger, ... ) PRNET_LOG( logger, info, 2, __VA_ARGS__ )
+#define PRNET_LOG_WARNING( logger, ... ) PRNET_LOG( logger, warning, 1, __VA_ARGS__ )
+#define PRNET_LOG_ERROR( logger, ... ) PRNET_LOG( logger, error, 0, __VA_ARGS__ )
+
 namespace prnet {
 
 namespace detail {
 
+static constexpr std::size_t timestampLength = 26;
+
+/**
+ * Writes the local time as "YYYY/MM/DD hh:mm:ss.uuuuuu" into buffer, which must hold at least timestampLength chars.
+ * The date and time part is cached per thread and only reformatted when the second changes.
+ */
+std::size_t PRNET_DLL formatTimestamp( char* buffer, std::chrono::system_clock::time_point time );
+
 std::ostream& PRNET_DLL logTimestamp( std::ostream &os );
 std::ostream& PRNET_DLL logPid( std::ostream &os );
 
@@ -29,12 +65,25 @@ void logWrite( std::ostream& os, Arg0&& arg0, Args&&... args )
     logWrite( os, std::forward<Args>( args )... );
 }
 
+inline void logAppend( std::ostream& )
+{
+}
+
+template< typename Arg0, typename ...Args >
+void logAppend( std::ostream& os, Arg0&& arg0, Args&&... args )
+{
+	os << std::forward< Arg0 >( arg0 );
+	logAppend( os, std::forward< Args >( args )... );
+}
+
 template< typename ...Args >
 void logMessage( std::ostream& os, std::string const &tag, char const *level, Args &&... args )
 {
     logWrite( os, logTimestamp, " [", logPid, "] [", tag, "] [", level, "] ", std::forward< Args >( args )... );
 }
 
+class LogWriter;
+
 } // namespace detail
 
 class PRNET_DLL Logger
@@ -51,24 +100,101 @@ public:
 		unsigned level;
 	};
 
+	/**
+	 * What a producer does when its ring buffer is full: block waits for the writer thread to make room, drop discards
+	 * the record silently and count discards it but reports the number of lost records in the log.
+	 */
+	enum class Overflow
+	{
+		block,
+		drop,
+		count
+	};
+
+	/**
+	 * bufferSize is the size of the ring buffer of every logging thread in bytes, text records larger than half of it
+	 * are truncated, binary records are written synchronously instead. interval is how long the writer thread sleeps when all buffers are empty.
+	 */
+	struct AsyncOptions
+	{
+		std::size_t bufferSize;
+		Overflow overflow;
+		std::chrono::milliseconds interval;
+	};
+
 private:
+	friend class detail::LogWriter;
+
 	using Lock = std::lock_guard< std::recursive_mutex >;
 
 	static constexpr std::size_t tagLength = 15;
 
-	static bool is( Level const& level );
+	static std::ostream& record();
+	static std::string& binaryRecord();
+	static void enqueue( std::string const& tag, Level const& level );
+	static void writeBatch( std::string const& text );
+	static void writeBinary( std::uint32_t tag, Level const& level, std::int64_t time, char const* args,
+							 std::size_t length );
 
-	static Level const* level_;
 	static std::shared_ptr< std::ostream > output_;
+	static std::unique_ptr< detail::BinaryLogWriter > binaryOutput_;
 	static std::recursive_mutex mutex_;
+	static std::atomic< bool > async_;
+	static std::atomic< bool > binary_;
 
 public:
+	/**
+	 * Sets the threshold of all loggers without a threshold of their own.
+	 */
 	static void threshold( Level const& level );
+
+	/**
+	 * Sets the threshold of the loggers with the given tag. A tag ending in '*' matches all tags with that prefix, e.g.
+	 * "rep::*", the longest match wins.
+	 */
+	static void threshold( std::string const& tag, Level const& level );
+
 	static void output( std::ostream& output );
 	static void output( char const* output );
 
+	/**
+	 * Writes all following records to path in the binary format described in binary_log.hpp instead of text, which
+	 * is much cheaper for large protocol dumps. BinaryLogReader (tools/prnet-logdecode) renders it as text. Another
+	 * call to output() switches back to text.
+	 */
+	static void binary( char const* path );
+
+	static AsyncOptions defaultAsyncOptions();
+
+	/**
+	 * Switches to asynchronous logging: log calls only format their arguments into a lock-free per-thread ring buffer,
+	 * a background thread adds the prefix and writes the records in batches. synchronous() drains all buffers and
+	 * switches back. Pending records are written when the program exits.
+	 */
+	static void async();
+	static void async( AsyncOptions const& options );
+	static void synchronous();
+
+	/**
+	 * Blocks until every record logged before the call has been written.
+	 */
+	static void flush();
+
+	/**
+	 * Number of records lost due to full ring buffers since asynchronous logging was started.
+	 */
+	static std::size_t dropped();
+
 	explicit Logger( std::string tag );
 	Logger( Logger const& ) = delete;
+	~Logger();
+
+	std::string const& name() const { return name_; }
+
+	bool enabled( Level const& level ) const
+	{
+		return threshold_.load( std::memory_order_relaxed ) >= level.level;
+	}
 
 	template< typename ...Args >
 	void debug( Args&&... args )
@@ -98,13 +224,28 @@ private:
 	template< typename ...Args >
 	void log( Level const& level, Args&&... args )
 	{
-		if ( is( level ) ) {
-            Lock lock( mutex_ );
+		if ( !enabled( level ) ) {
+			return;
+		}
+		AllocationScope scope( AllocationTag::logging );
+		if ( binary_.load( std::memory_order_acquire ) ) {
+			detail::binaryAppend( binaryRecord(), std::forward< Args >( args )... );
+			commit( level );
+		} else if ( async_.load( std::memory_order_acquire ) ) {
+			detail::logAppend( record(), std::forward< Args >( args )... );
+			enqueue( tag_, level );
+		} else {
+			Lock lock( mutex_ );
 			detail::logMessage( *output_, tag_, level.name, std::forward< Args >( args )... );
 		}
 	}
 
+	void commit( Level const& level );
+
+	std::string name_;
 	std::string tag_;
+	std::uint32_t tagId_;
+	std::atomic< unsigned > threshold_;
 };
 
 } // namespace prnet
@@ -0,0 +1,108 @@
+#ifndef LIB3DPRNET_CORE_METRICS_HPP
+#define LIB3DPRNET_CORE_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "3dprnet/core/config.hpp"
+
+namespace prnet {
+
+/**
+ * class HistogramSnapshot
+ *
+ * Copy of a Histogram at one point in time. buckets holds the highest value and the count of every non-empty bucket
+ * in ascending order.
+ */
+
+struct PRNET_DLL HistogramSnapshot
+{
+    std::uint64_t count;
+    std::uint64_t sum;
+    std::uint64_t min;
+    std::uint64_t max;
+    std::vector< std::pair< std::uint64_t, std::uint64_t > > buckets;
+
+    double mean() const;
+
+    /**
+     * Upper bound of the bucket holding the value at the given percentile (0 to 100).
+     */
+    std::uint64_t percentile( double percentile ) const;
+};
+
+
+/**
+ * class Histogram
+ *
+ * Log-linear histogram in the style of HdrHistogram: every power of two is split into 16 linear sub-buckets, which
+ * keeps the relative error below 6.25%. Values are clamped to 2^40 - 1, which is 18 minutes in nanoseconds. Recording
+ * only touches relaxed atomics and never blocks, snapshots may run concurrently but are not atomic as a whole.
+ */
+
+class PRNET_DLL Histogram
+{
+public:
+    static constexpr std::size_t subBuckets = 16;
+    static constexpr unsigned subBucketBits = 4;
+    static constexpr unsigned maxBits = 40;
+    static constexpr std::size_t bucketCount = ( maxBits - subBucketBits + 1 ) * subBuckets;
+
+    static std::size_t index( std::uint64_t value )
+    {
+        if ( value < subBuckets ) {
+            return static_cast< std::size_t >( value );
+        }
+        if ( value >= ( std::uint64_t( 1 ) << maxBits ) ) {
+            value = ( std::uint64_t( 1 ) << maxBits ) - 1;
+        }
+        auto exponent = static_cast< unsigned >( 63 - __builtin_clzll( value ) );
+        return ( exponent - subBucketBits + 1 ) * subBuckets
+               + static_cast< std::size_t >( ( value >> ( exponent - subBucketBits ) ) & ( subBuckets - 1 ) );
+    }
+
+    /**
+     * Highest value that falls into the bucket.
+     */
+    static std::uint64_t upperBound( std::size_t index );
+
+    Histogram();
+    Histogram( Histogram const& ) = delete;
+
+    void record( std::uint64_t value )
+    {
+        counts_[ index( value ) ].fetch_add( 1, std::memory_order_relaxed );
+        count_.fetch_add( 1, std::memory_order_relaxed );
+        sum_.fetch_add( value, std::memory_order_relaxed );
+
+        auto min = min_.load( std::memory_order_relaxed );
+        while ( value < min && !min_.compare_exchange_weak( min, value, std::memory_order_relaxed ) ) {}
+        auto max = max_.load( std::memory_order_relaxed );
+        while ( value > max && !max_.compare_exchange_weak( max, value, std::memory_order_relaxed ) ) {}
+    }
+
+    template< typename Rep, typename Period >
+    void record( std::chrono::duration< Rep, Period > duration )
+    {
+        auto nanos = std::chrono::duration_cast< std::chrono::nanoseconds >( duration ).count();
+        record( static_cast< std::uint64_t >( nanos > 0 ? nanos : 0 ) );
+    }
+
+    HistogramSnapshot snapshot() const;
+
+private:
+    std::array< std::atomic< std::uint64_t >, bucketCount > counts_;
+    std::atomic< std::uint64_t > count_ {};
+    std::atomic< std::uint64_t > sum_ {};
+    std::atomic< std::uint64_t > min_ { UINT64_MAX };
+    std::atomic< std::uint64_t > max_ {};
+};
+
+} // namespace prnet
+
+#endif // LIB3DPRNET_CORE_METRICS_HPP
@@ -0,0 +1,106 @@
+#ifndef LIB3DPRNET_REPETIER_CAPTURE_HPP
+#define LIB3DPRNET_REPETIER_CAPTURE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+
+#include "3dprnet/core/config.hpp"
+#include "3dprnet/core/filesystem.hpp"
+#include "3dprnet/core/string_view.hpp"
+
+namespace prnet {
+namespace rep {
+
+/**
+ * Capture format
+ *
+ * A capture starts with the magic "PRNETWS2", followed by one entry per websocket frame: direction byte (1 inbound,
+ * 2 outbound), varint stream, zigzag varint nanoseconds of the steady clock since the previous frame, varint length,
+ * payload. The time of the first frame is relative to the creation of the CaptureWriter. Frames of different streams
+ * belong to different connections and are interleaved in the order they were written.
+ */
+
+struct CaptureFrame
+{
+    enum class Direction : std::uint8_t
+    {
+        inbound = 1,
+        outbound = 2
+    };
+
+    Direction direction;
+    std::uint32_t stream; // the connection, see CaptureWriter::open()
+    std::chrono::nanoseconds time; // since the start of the capture
+    std::string payload;
+};
+
+
+/**
+ * class CaptureWriter
+ *
+ * Writes the frames recorded by Client::capture() to a file, which is truncated. Throws std::system_error if the file
+ * cannot be opened. All members may be called from any thread, so one writer can be shared by several clients: each
+ * of them writes its frames to a stream of its own, which keeps their sessions apart when replaying.
+ */
+
+class PRNET_DLL CaptureWriter
+{
+    class Impl;
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CaptureWriter( filesystem::path const& path );
+    CaptureWriter( CaptureWriter const& ) = delete;
+    ~CaptureWriter();
+
+    /**
+     * Returns the id of a new stream for the frames of one connection.
+     */
+    std::uint32_t open();
+
+    void write( std::uint32_t stream, CaptureFrame::Direction direction, Clock::time_point time,
+                string_view payload );
+    void flush();
+
+    std::size_t frames() const;
+
+private:
+    std::unique_ptr< Impl > impl_;
+};
+
+
+/**
+ * class CaptureReader
+ *
+ * Reads the frames of a capture in order. Throws std::runtime_error on corrupt input.
+ */
+
+class PRNET_DLL CaptureReader
+{
+public:
+    explicit CaptureReader( std::istream& in );
+    CaptureReader( CaptureReader const& ) = delete;
+
+    /**
+     * Reads the next frame into frame, returns false at the end of the capture.
+     */
+    bool next( CaptureFrame& frame );
+
+private:
+    std::uint64_t varint();
+    std::uint8_t byte();
+
+    std::istream& in_;
+    bool header_ {};
+    std::int64_t lastTime_ {};
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_CAPTURE_HPP
@@ -1,15 +1,20 @@
 #ifndef LIB3DPRNET_REPETIER_SOCKET_HPP
 #define LIB3DPRNET_REPETIER_SOCKET_HPP
 
+#include <chrono>
 #include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
 
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
 #include <nlohmann/json_fwd.hpp>
 
 #include "3dprnet/core/config.hpp"
 #include "3dprnet/repetier/forward.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/timeouts.hpp"
 #include "3dprnet/repetier/types.hpp"
 
 namespace prnet {
@@ -22,6 +27,8 @@ namespace rep {
 class PRNET_DLL Client
 {
 public:
+    using Strand = boost::asio::strand< boost::asio::io_context::executor_type >;
+
     using SuccessHandler = std::function< void () >;
     using ErrorHandler = std::function< void ( std::error_code ec ) >;
     using CallbackHandler = std::function< void ( nlohmann::json const& data ) >;
@@ -32,12 +39,25 @@ private:
     class Impl;
 
 public:
+    static Timeouts defaultTimeouts();
+
     /**
      * Constructs a client object without connecting. The handler will be called whenever there is an error during
      * communication. Using the client after the handler has been called results in undefined behaviour.
      */
     Client( boost::asio::io_context& context, ErrorHandler handler );
+
+    /**
+     * Constructs a client object whose handlers all run on the given strand. The client itself must only be used from
+     * within that strand.
+     */
+    Client( Strand strand, ErrorHandler handler );
     Client( Client const& ) = delete;
+
+    /**
+     * Destroys the client, closing the connection without invoking any handler. Operations still in flight complete
+     * in the background.
+     */
     ~Client();
 
     /**
@@ -57,10 +77,53 @@ public:
      */
     void close();
 
+    /**
+     * Invokes handler for every event of the given type. Several handlers may subscribe to the same type, they are
+     * invoked in the order they subscribed.
+     */
     void subscribe( std::string event, EventHandler handler );
 
+    /**
+     * Resolves and connects through resolver from the next connect() on, a cache of its own by default.
+     */
+    void resolver( std::shared_ptr< ResolverCache > resolver );
+
+    /**
+     * Records traffic, round trip and parse times and event counts into metrics from now on.
+     */
+    void metrics( std::shared_ptr< Metrics > metrics );
+
+    /**
+     * Logs a warning for every event or response handler that runs longer than threshold, together with the event
+     * type and printer slug or the action. The handler includes all slots it invokes. Zero disables the check.
+     */
+    void slow_handlers( std::chrono::nanoseconds threshold );
+
+    /**
+     * Traces events through the pipeline into the metrics set by metrics(), see Tracing.
+     */
+    void tracing( Tracing tracing );
+
+    /**
+     * Applies to the requests and pings from now on.
+     */
+    void timeouts( Timeouts timeouts );
+
+    /**
+     * Writes every frame sent and received from now on to a new stream of writer, nullptr stops. The apikey of the
+     * login request is blanked out.
+     */
+    void capture( std::shared_ptr< CaptureWriter > writer );
+
+    /**
+     * Passes message through parsing and dispatch as if it had been read from the connection, for replaying a
+     * capture without a server. Responses without a pending request are dropped silently from then on, so replay
+     * into a client that is not connected.
+     */
+    void replay( std::string const& message );
+
 private:
-    std::unique_ptr< Impl > impl_;
+    std::shared_ptr< Impl > impl_;
 };
 
 } // namespace rep
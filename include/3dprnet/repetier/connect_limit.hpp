@@ -0,0 +1,48 @@
+#ifndef LIB3DPRNET_REPETIER_CONNECT_LIMIT_HPP
+#define LIB3DPRNET_REPETIER_CONNECT_LIMIT_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "3dprnet/core/config.hpp"
+
+namespace prnet {
+namespace rep {
+
+/**
+ * class ConnectLimit
+ *
+ * Limits the number of connection attempts in flight across the services sharing it, see Service::Reconnect. Slots
+ * are handed out in the order they were requested. All members may be called from any thread.
+ */
+
+class PRNET_DLL ConnectLimit
+{
+    class Impl;
+
+public:
+    using Handler = std::function< void () >;
+
+    explicit ConnectLimit( std::size_t concurrent );
+    ConnectLimit( ConnectLimit const& ) = delete;
+    ~ConnectLimit();
+
+    /**
+     * Invokes handler as soon as a slot is free, which may be from within acquire or from within the release() of
+     * another holder. The handler must return the slot with release() eventually.
+     */
+    void acquire( Handler handler );
+    void release();
+
+    std::size_t active() const;
+    std::size_t waiting() const;
+
+private:
+    std::unique_ptr< Impl > impl_;
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_CONNECT_LIMIT_HPP
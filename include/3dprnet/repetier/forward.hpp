@@ -10,15 +10,21 @@ namespace prnet {
 namespace rep {
 
 class model_ident;
+class CaptureWriter;
 class Client;
+class ConnectLimit;
 class Endpoint;
 class ExtruderConfig;
 class Frontend;
 class HeatbedConfig;
+class Metrics;
 class Model;
 class ModelGroup;
+class ModelRef;
+class ModelTable;
 class Printer;
 class PrinterConfig;
+class ResolverCache;
 class Temperature;
 
 } // namespace rep
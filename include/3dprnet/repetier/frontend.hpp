@@ -19,6 +19,13 @@ namespace rep {
 
 /**
  * class Frontend
+ *
+ * A Service that caches the printer list and the model groups and models of each printer, and serves the request
+ * functions from the cache. While connected, a new printer list refetches the groups and models only of printers that
+ * are new or changed, the others are kept current by the change events of the server. Those events are lost while
+ * disconnected and the printer list tells nothing about groups and models, so a reconnect costs as much as the first
+ * fetch: the printer list and the groups and models of every printer. Until they arrive, the cache still serves those
+ * from before.
  */
 
 class PRNET_DLL Frontend
@@ -63,7 +70,7 @@ public:
     void on_models( ModelsEvent::slot_type const& handler );
 
 private:
-    std::unique_ptr< FrontendImpl > impl_;
+    std::shared_ptr< FrontendImpl > impl_;
 };
 
 } // namespace rep
@@ -0,0 +1,207 @@
+#ifndef LIB3DPRNET_REPETIER_METRICS_HPP
+#define LIB3DPRNET_REPETIER_METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "3dprnet/core/config.hpp"
+#include "3dprnet/core/metrics.hpp"
+
+namespace prnet {
+namespace rep {
+
+/**
+ * struct EventTrace
+ *
+ * Path of one event through the pipeline: read is the completion of the websocket read, parsed the end of parsing the
+ * frame, dispatched the start of its subscription handler and returned the point when the handler, including all
+ * signal slots it invoked, returned.
+ */
+
+struct EventTrace
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::string type;
+    std::string printer;
+    Clock::time_point read;
+    Clock::time_point parsed;
+    Clock::time_point dispatched;
+    Clock::time_point returned;
+};
+
+
+/**
+ * struct Tracing
+ *
+ * If enabled, the stages of every subscribed event are recorded into Metrics::trace(). Every sampleEvery-th of these
+ * events (zero for none) is also passed to handler, which is invoked on the strand of the connection.
+ */
+
+struct Tracing
+{
+    bool enabled;
+    std::size_t sampleEvery;
+    std::function< void ( EventTrace const& trace ) > handler;
+};
+
+
+/**
+ * class Metrics
+ *
+ * Instrumentation of one server connection, shared by Service and Client. The counters and histograms are updated
+ * with relaxed atomics on the strand of the service. Looking up the per-action and per-event entries takes a lock,
+ * which is why the strand keeps its own cache of them; snapshot() may be called from any thread.
+ *
+ * loopLag is the delay of the service watchdog behind its schedule, only recorded while it runs (see
+ * Service::Watchdog), dispatch the time spent handling one received frame including all slots it invoked, both in
+ * nanoseconds.
+ *
+ * Events of types nobody subscribed to are counted per type for the first 256 such types a Client receives, the events
+ * of any further ones together under the type "other".
+ *
+ * The allocation counters per action and event type stay zero unless the library is built with PRNET_TRACK_ALLOCATIONS,
+ * see allocations.hpp.
+ */
+
+class PRNET_DLL Metrics
+{
+public:
+    /**
+     * Histograms in nanoseconds: queueWait from Service::send until the request is taken from the queue to be sent,
+     * roundTrip from starting to write the request until the response frame was read, so it includes the write,
+     * parse for parsing the response. allocations counts those of
+     * queueing and writing the requests and of parsing and handling their responses.
+     */
+    struct Action
+    {
+        Histogram queueWait;
+        Histogram roundTrip;
+        Histogram parse;
+        std::atomic< std::uint64_t > requests {};
+        std::atomic< std::uint64_t > timeouts {};
+        std::atomic< std::uint64_t > allocations {};
+    };
+
+    struct ActionSnapshot
+    {
+        std::string name;
+        std::uint64_t requests;
+        std::uint64_t timeouts;
+        std::uint64_t allocations;
+        HistogramSnapshot queueWait;
+        HistogramSnapshot roundTrip;
+        HistogramSnapshot parse;
+    };
+
+    /**
+     * Histograms of the EventTrace stages per event type in nanoseconds: parse from read to parsed, queue from parsed to
+     * dispatched (events later in a batch wait for the earlier ones), handler from dispatched to returned and total
+     * from read to returned.
+     */
+    struct Trace
+    {
+        Histogram parse;
+        Histogram queue;
+        Histogram handler;
+        Histogram total;
+    };
+
+    struct TraceSnapshot
+    {
+        std::string type;
+        HistogramSnapshot parse;
+        HistogramSnapshot queue;
+        HistogramSnapshot handler;
+        HistogramSnapshot total;
+    };
+
+    struct Snapshot
+    {
+        bool connected;
+        std::uint64_t queueDepth;
+        std::uint64_t uploadBytes;
+        std::uint64_t bytesIn;
+        std::uint64_t bytesOut;
+        std::uint64_t framesIn;
+        std::uint64_t framesOut;
+        std::uint64_t reconnects;
+        std::uint64_t timeouts;
+        std::uint64_t slowHandlers;
+        std::uint64_t pingTimeouts;
+        std::uint64_t resumeBytes;
+        HistogramSnapshot eventParse;
+        HistogramSnapshot loopLag;
+        HistogramSnapshot dispatch;
+        HistogramSnapshot pingRoundTrip;
+        HistogramSnapshot reconnectTime;
+        HistogramSnapshot resumeTime;
+        std::vector< ActionSnapshot > actions;
+        std::vector< std::pair< std::string, std::uint64_t > > events;
+        std::vector< std::pair< std::string, std::uint64_t > > eventAllocations;
+        std::vector< TraceSnapshot > traces;
+    };
+
+    Metrics();
+    Metrics( Metrics const& ) = delete;
+    ~Metrics();
+
+    Action& action( std::string const& name );
+    std::atomic< std::uint64_t >& event( std::string const& type );
+
+    /**
+     * Allocations of handling the events of type, including their share of parsing the frame.
+     */
+    std::atomic< std::uint64_t >& eventAllocations( std::string const& type );
+    Trace& trace( std::string const& type );
+
+    Snapshot snapshot() const;
+
+    std::atomic< bool > connected {};
+    std::atomic< std::uint64_t > queueDepth {};
+    std::atomic< std::uint64_t > uploadBytes {};
+    std::atomic< std::uint64_t > bytesIn {};
+    std::atomic< std::uint64_t > bytesOut {};
+    std::atomic< std::uint64_t > framesIn {};
+    std::atomic< std::uint64_t > framesOut {};
+    std::atomic< std::uint64_t > reconnects {};
+    std::atomic< std::uint64_t > timeouts {};
+    std::atomic< std::uint64_t > slowHandlers {};
+    std::atomic< std::uint64_t > pingTimeouts {};
+
+    /**
+     * After a reconnect, the service is resuming the session until the requests of its reconnect slots have been
+     * answered. resumeBytes counts the response payload received meanwhile, reconnectTime the time from losing the
+     * connection until logged in again and resumeTime the time from there until the session is resumed.
+     */
+    std::atomic< bool > resuming {};
+    std::atomic< std::uint64_t > resumeBytes {};
+    Histogram reconnectTime;
+    Histogram resumeTime;
+
+    Histogram eventParse;
+    Histogram loopLag;
+    Histogram dispatch;
+    Histogram pingRoundTrip;
+
+private:
+    mutable std::mutex mutex_;
+    std::map< std::string, std::unique_ptr< Action > > actions_;
+    std::map< std::string, std::unique_ptr< std::atomic< std::uint64_t > > > events_;
+    std::map< std::string, std::unique_ptr< std::atomic< std::uint64_t > > > eventAllocations_;
+    std::map< std::string, std::unique_ptr< Trace > > traces_;
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_METRICS_HPP
@@ -0,0 +1,56 @@
+#ifndef LIB3DPRNET_REPETIER_METRICS_EXPORTER_HPP
+#define LIB3DPRNET_REPETIER_METRICS_EXPORTER_HPP
+
+#include <memory>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+
+#include "3dprnet/core/config.hpp"
+#include "3dprnet/repetier/forward.hpp"
+
+namespace prnet {
+namespace rep {
+
+/**
+ * class MetricsExporter
+ *
+ * Embedded HTTP server that serves the metrics of any number of servers at /metrics in the Prometheus text exposition
+ * format, labelled with the server id ("host:port"). A scrape only reads the atomics of the registered Metrics and
+ * never waits for the strand of a service. All members may be called from any thread.
+ */
+
+class PRNET_DLL MetricsExporter
+{
+    class Impl;
+
+public:
+    /**
+     * Starts listening on the io_context. A port of zero picks a free one, see port().
+     */
+    MetricsExporter( boost::asio::io_context& context, unsigned short port, std::string address = "127.0.0.1" );
+    MetricsExporter( MetricsExporter const& ) = delete;
+
+    /**
+     * Stops listening and closes the connections that scrapers keep alive, so they do not keep the io_context busy.
+     */
+    ~MetricsExporter();
+
+    unsigned short port() const;
+
+    void add( std::string server, std::shared_ptr< Metrics const > metrics );
+    void remove( std::string const& server );
+
+    /**
+     * The body of a scrape.
+     */
+    std::string render() const;
+
+private:
+    std::shared_ptr< Impl > impl_;
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_METRICS_EXPORTER_HPP
@@ -0,0 +1,139 @@
+#ifndef LIB3DPRNET_REPETIER_MODEL_TABLE_HPP
+#define LIB3DPRNET_REPETIER_MODEL_TABLE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json_fwd.hpp>
+
+#include "3dprnet/core/config.hpp"
+#include "3dprnet/core/string_view.hpp"
+#include "3dprnet/repetier/forward.hpp"
+
+namespace prnet {
+namespace rep {
+
+class ModelTable;
+
+
+/**
+ * class ModelRef
+ */
+
+class PRNET_DLL ModelRef
+{
+public:
+    ModelRef( ModelTable const& table, std::size_t index )
+            : table_( &table )
+            , index_( index ) {}
+
+    std::size_t id() const;
+    string_view name() const;
+    std::string const& modelGroup() const;
+    std::time_t created() const;
+    std::size_t length() const;
+    std::size_t layers() const;
+    std::size_t lines() const;
+    std::chrono::microseconds printTime() const;
+
+private:
+    ModelTable const* table_;
+    std::size_t index_;
+};
+
+
+/**
+ * class ModelTable
+ *
+ * Column-oriented alternative to std::vector< Model >. Numeric attributes are kept in contiguous arrays, group names
+ * are interned and model names share a single string arena, so a table of n models costs a handful of allocations
+ * instead of up to 2n.
+ */
+
+class PRNET_DLL ModelTable
+{
+    friend class ModelRef;
+    friend void PRNET_DLL from_json( nlohmann::json const& src, ModelTable& dst );
+
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ModelRef;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = ModelRef;
+
+        const_iterator( ModelTable const& table, std::size_t index )
+                : table_( &table )
+                , index_( index ) {}
+
+        ModelRef operator*() const { return { *table_, index_ }; }
+        const_iterator& operator++() { ++index_; return *this; }
+        const_iterator operator++( int ) { auto result = *this; ++index_; return result; }
+
+        bool operator==( const_iterator const& other ) const { return index_ == other.index_; }
+        bool operator!=( const_iterator const& other ) const { return index_ != other.index_; }
+
+    private:
+        ModelTable const* table_;
+        std::size_t index_;
+    };
+
+    ModelTable();
+    explicit ModelTable( std::vector< Model > const& models );
+
+    std::size_t size() const { return ids_.size(); }
+    bool empty() const { return ids_.empty(); }
+
+    ModelRef operator[]( std::size_t index ) const { return { *this, index }; }
+    const_iterator begin() const { return { *this, 0 }; }
+    const_iterator end() const { return { *this, size() }; }
+
+    std::vector< std::string > const& groups() const { return groups_; }
+
+    void reserve( std::size_t models, std::size_t nameBytes = 0 );
+    void push_back( Model const& model );
+    void clear();
+    void shrink_to_fit();
+
+    /**
+     * Returns the number of bytes owned by the table, including the capacity of all columns and the interned group
+     * names.
+     */
+    std::size_t memory_usage() const;
+
+private:
+    void append( std::size_t id, string_view name, std::string const& group, std::time_t created, std::size_t length,
+                 std::size_t layers, std::size_t lines, std::chrono::microseconds printTime );
+    std::uint32_t intern( std::string const& group );
+
+    std::vector< std::uint32_t > ids_;
+    std::vector< std::int64_t > created_;
+    std::vector< std::uint64_t > length_;
+    std::vector< std::uint32_t > layers_;
+    std::vector< std::uint32_t > lines_;
+    std::vector< std::int64_t > printTime_;
+    std::vector< std::uint32_t > groupIndex_;
+    std::vector< std::uint32_t > nameOffsets_;
+    std::string names_;
+    std::vector< std::string > groups_;
+    std::vector< std::uint32_t > groupOrder_; // indices into groups_, sorted by name
+};
+
+/**
+ * Returns the number of bytes owned by a vector of models, counting the string buffers that did not fit into the
+ * small string optimization. Used to compare against ModelTable::memory_usage.
+ */
+std::size_t PRNET_DLL memory_usage( std::vector< Model > const& models );
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_MODEL_TABLE_HPP
@@ -0,0 +1,86 @@
+#ifndef LIB3DPRNET_REPETIER_RESOLVER_CACHE_HPP
+#define LIB3DPRNET_REPETIER_RESOLVER_CACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include "3dprnet/core/config.hpp"
+
+namespace prnet {
+namespace rep {
+
+/**
+ * class ResolverCache
+ *
+ * Caches the endpoints of a host and port for ttl, for the clients and uploads of the services it is passed to (see
+ * Service::resolver()). Concurrent lookups of the same host and port share one resolution, failures are not cached.
+ * The connections to the endpoints are attempted as in RFC 8305 ("happy eyeballs"): alternating between IPv6 and IPv4
+ * and starting the next attempt after attemptDelay or as soon as the previous one failed, whichever comes first, so
+ * that an unreachable address family costs attemptDelay instead of a connect timeout. All members may be called from
+ * any thread.
+ */
+
+class PRNET_DLL ResolverCache
+{
+    class Impl;
+
+public:
+    using Endpoints = std::vector< boost::asio::ip::tcp::endpoint >;
+    using Handler = std::function< void ( std::error_code ec, Endpoints const& endpoints ) >;
+
+    /**
+     * Resolves host and port and invokes handler with the result on a thread running context.
+     */
+    using Resolve = std::function< void ( boost::asio::io_context& context, std::string const& host,
+                                          std::string const& port, Handler handler ) >;
+
+    /**
+     * resolve defaults to the resolver of Asio if empty.
+     */
+    struct Options
+    {
+        std::chrono::seconds ttl;
+        std::chrono::milliseconds attemptDelay;
+        Resolve resolve;
+    };
+
+    static Options defaultOptions();
+
+    ResolverCache();
+    explicit ResolverCache( Options options );
+    ResolverCache( ResolverCache const& ) = delete;
+    ~ResolverCache();
+
+    /**
+     * Invokes handler with the endpoints of host and port, from the cache or once resolved. The handler is always
+     * invoked from a thread running context, never from within resolve().
+     */
+    void resolve( boost::asio::io_context& context, std::string const& host, std::string const& port,
+                  Handler handler );
+
+    /**
+     * Drops the endpoints of host and port, e.g. because none of them could be connected to.
+     */
+    void invalidate( std::string const& host, std::string const& port );
+
+    std::chrono::milliseconds attemptDelay() const;
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+private:
+    std::shared_ptr< Impl > impl_;
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_RESOLVER_CACHE_HPP
@@ -1,6 +1,8 @@
 #ifndef LIB3DPRNET_REPETIER_CLIENT_HPP
 #define LIB3DPRNET_REPETIER_CLIENT_HPP
 
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
@@ -12,6 +14,8 @@
 
 #include "3dprnet/core/config.hpp"
 #include "3dprnet/repetier/forward.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/timeouts.hpp"
 #include "3dprnet/repetier/upload.hpp"
 
 namespace prnet {
@@ -23,6 +27,11 @@ namespace rep {
 
 class PRNET_DLL Service
 {
+    /*
+     * All members may be called from any thread. The internals of a service run on a strand of the io_context, so
+     * io_context::run() may be invoked from several threads. Slots are invoked on that strand.
+     */
+
 public:
 	using CallbackHandler = std::function< void ( nlohmann::json const& data ) >;
 
@@ -36,13 +45,67 @@ public:
     using GroupsEvent = boost::signals2::signal< void ( std::string slug, std::vector< ModelGroup > groups ) >;
     using ModelsEvent = boost::signals2::signal< void ( std::string slug, std::vector< Model > models ) >;
 
+    /**
+     * Temperature events of a controller are suppressed unless wanted or actual temperature moved by at least deadband
+     * since the last delivered event, and are delivered at most once per interval. If refresh is non-zero, an
+     * unchanged reading is delivered anyway once refresh has passed. The default filter passes everything.
+     */
+    struct TemperatureFilter
+    {
+        double deadband {};
+        std::chrono::milliseconds interval {};
+        std::chrono::milliseconds refresh {};
+    };
+
+    struct TemperatureFilterStats
+    {
+        std::size_t received {};
+        std::size_t delivered {};
+        std::size_t suppressedDeadband {};
+        std::size_t suppressedRate {};
+    };
+
+    /**
+     * Every interval the watchdog measures how far the io_context lags behind, which ends up in Metrics::loopLag.
+     * Lags and event or response handlers (including their slots) that exceed threshold are logged as warnings.
+     * An interval of zero disables the watchdog, a threshold of zero the warnings. All services on an io_context would
+     * measure the same lag, so the default only warns about slow handlers and the watchdog is enabled on one of them
+     * (ServicePool does so on one service per shard).
+     */
+    struct Watchdog
+    {
+        std::chrono::milliseconds interval {};
+        std::chrono::milliseconds threshold { 100 };
+    };
+
+    /**
+     * The n-th reconnect in a row is delayed by a random amount of up to min( cap, backoff * 2^n ) ("full jitter"), so
+     * that services losing their connections at the same time spread their reconnects instead of retrying in lockstep.
+     * If limit is set, the services sharing it have at most the given number of connection attempts in flight, from
+     * initiating the connection until logged in. The default is a backoff of 500ms with a cap of 30s and no limit.
+     */
+    struct Reconnect
+    {
+        std::chrono::milliseconds backoff { 500 };
+        std::chrono::milliseconds cap { std::chrono::seconds( 30 ) };
+        std::shared_ptr< ConnectLimit > limit;
+    };
+
 private:
 	struct Action;
     class ServiceImpl;
 
 public:
+    static Watchdog defaultWatchdog();
+    static Reconnect defaultReconnect();
+
     Service( boost::asio::io_context& context, Endpoint endpoint );
     Service( Service const& ) = delete;
+
+    /**
+     * Disconnects all slots and closes the connection. Operations still in flight complete on the strand in the
+     * background, so the io_context must outlive them.
+     */
     ~Service();
 
     bool connected() const;
@@ -59,6 +122,48 @@ public:
     void moveModelToGroup( std::string slug, std::size_t id, std::string group, Handler handler = [] {} );
     void sendCommand( std::string slug, std::string command, Handler handler = []{} );
 
+    void temperature_filter( TemperatureFilter filter );
+    TemperatureFilterStats temperature_filter_stats() const;
+
+    void watchdog( Watchdog watchdog );
+
+    /**
+     * Applies from the next connection attempt on.
+     */
+    void reconnect( Reconnect reconnect );
+
+    /**
+     * Resolves and connects through resolver for the connections and uploads started from now on, e.g. to share one
+     * cache between several services. A cache of its own by default.
+     */
+    void resolver( std::shared_ptr< ResolverCache > resolver );
+
+    /**
+     * Applies to the current connection and all following ones, Client::defaultTimeouts() by default.
+     */
+    void timeouts( Timeouts timeouts );
+
+    /**
+     * Traces events from the websocket read to the return of their slots, see Tracing. Off by default.
+     */
+    void tracing( Tracing tracing );
+
+    /**
+     * Records the frames of this and all following connections into writer, one stream per connection, nullptr
+     * stops, see Client::capture().
+     */
+    void capture( std::shared_ptr< CaptureWriter > writer );
+
+    /**
+     * Latency histograms per action and traffic counters of the connection, cheap enough to be polled.
+     */
+    Metrics::Snapshot metrics() const;
+
+    /**
+     * The live metrics object, e.g. for a MetricsExporter. It stays valid after the service is destroyed.
+     */
+    std::shared_ptr< Metrics const > metrics_source() const;
+
     void on_reconnect( ReconnectEvent::slot_type const& handler );
     void on_disconnect( DisconnectEvent::slot_type const& handler );
     void on_temperature( TemperatureEvent::slot_type const& handler );
@@ -67,8 +172,14 @@ public:
     void on_groups( GroupsEvent::slot_type const& handler );
     void on_models( ModelsEvent::slot_type const& handler );
 
+protected:
+    /**
+     * Performs the first part of destruction early, for derived classes whose members are referenced by slots.
+     */
+    void shutdown();
+
 private:
-    std::unique_ptr< ServiceImpl > impl_;
+    std::shared_ptr< ServiceImpl > impl_;
 };
 
 } // namespace rep
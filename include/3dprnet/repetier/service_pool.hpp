@@ -0,0 +1,109 @@
+#ifndef LIB3DPRNET_REPETIER_SERVICE_POOL_HPP
+#define LIB3DPRNET_REPETIER_SERVICE_POOL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <boost/signals2/signal.hpp>
+
+#include "3dprnet/core/config.hpp"
+#include "3dprnet/repetier/forward.hpp"
+
+namespace prnet {
+namespace rep {
+
+class Service;
+
+/**
+ * class ServicePool
+ *
+ * Runs one Service per server, spread over a fixed number of io_context threads (shards). Events of all services are
+ * forwarded to one set of fleet-level signals with the server id ("host:port") prepended. The slots are invoked from
+ * the shard threads and therefore have to be thread-safe. The lag of each shard is measured by the watchdog of one of
+ * its services (see Service::Watchdog), the others only warn about slow handlers.
+ */
+
+class PRNET_DLL ServicePool
+{
+public:
+    using ReconnectEvent = boost::signals2::signal< void ( std::string server ) >;
+    using DisconnectEvent = boost::signals2::signal< void ( std::string server, std::error_code ec ) >;
+    using TemperatureEvent = boost::signals2::signal< void ( std::string server, std::string slug, Temperature temp ) >;
+    using PrintersEvent = boost::signals2::signal< void ( std::string server, std::vector< Printer > printers ) >;
+    using ConfigEvent = boost::signals2::signal< void ( std::string server, std::string slug, PrinterConfig config ) >;
+    using GroupsEvent = boost::signals2::signal< void ( std::string server, std::string slug, std::vector< ModelGroup > groups ) >;
+    using ModelsEvent = boost::signals2::signal< void ( std::string server, std::string slug, std::vector< Model > models ) >;
+
+    using ServiceHandler = std::function< void ( Service& service ) >;
+
+    /**
+     * shards of zero means one per hardware thread. If rebalanceInterval is non-zero, rebalance() runs at that
+     * interval.
+     */
+    struct Options
+    {
+        std::size_t shards;
+        bool pinThreads;
+        std::chrono::seconds rebalanceInterval;
+        double imbalance;
+    };
+
+    struct ShardStats
+    {
+        std::size_t servers;
+        std::size_t events;
+    };
+
+private:
+    struct Shard;
+    class Impl;
+
+public:
+    static Options defaultOptions();
+
+    ServicePool();
+    explicit ServicePool( Options options );
+    ServicePool( ServicePool const& ) = delete;
+    ~ServicePool();
+
+    /**
+     * Assigns the endpoint to the least loaded shard and returns its server id.
+     */
+    std::string add( Endpoint endpoint );
+    void remove( std::string const& server );
+
+    /**
+     * Invokes handler with the service of the server on its shard thread.
+     */
+    void dispatch( std::string const& server, ServiceHandler handler );
+
+    std::vector< ShardStats > stats() const;
+
+    /**
+     * If the busiest shard handled more than imbalance times the average number of events since the previous pass,
+     * moves its busiest server to the least busy shard. The server is moved by destroying its Service and starting a
+     * new one on the other shard, so it reconnects, logs in and fetches its printers, groups and models again.
+     */
+    void rebalance();
+
+    void on_reconnect( ReconnectEvent::slot_type const& handler );
+    void on_disconnect( DisconnectEvent::slot_type const& handler );
+    void on_temperature( TemperatureEvent::slot_type const& handler );
+    void on_printers( PrintersEvent::slot_type const& handler );
+    void on_config( ConfigEvent::slot_type const& handler );
+    void on_groups( GroupsEvent::slot_type const& handler );
+    void on_models( ModelsEvent::slot_type const& handler );
+
+private:
+    std::unique_ptr< Impl > impl_;
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_SERVICE_POOL_HPP
@@ -0,0 +1,51 @@
+#ifndef LIB3DPRNET_REPETIER_SUBSCRIBER_HPP
+#define LIB3DPRNET_REPETIER_SUBSCRIBER_HPP
+
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "3dprnet/core/async_subscriber.hpp"
+#include "3dprnet/repetier/types.hpp"
+
+namespace prnet {
+namespace rep {
+
+/**
+ * Subscriber types matching the signals of Service and Frontend
+ */
+
+using ReconnectSubscriber = AsyncSubscriber< void () >;
+using DisconnectSubscriber = AsyncSubscriber< void ( std::error_code ec ) >;
+using TemperatureSubscriber = AsyncSubscriber< void ( std::string slug, Temperature temp ) >;
+using PrintersSubscriber = AsyncSubscriber< void ( std::vector< Printer > printers ) >;
+using ConfigSubscriber = AsyncSubscriber< void ( std::string slug, PrinterConfig config ) >;
+using GroupsSubscriber = AsyncSubscriber< void ( std::string slug, std::vector< ModelGroup > groups ) >;
+using ModelsSubscriber = AsyncSubscriber< void ( std::string slug, std::vector< Model > models ) >;
+
+
+/**
+ * Key functions for QueuePolicy::latestPerKey
+ */
+
+inline std::string temperatureKey( std::string const& slug, Temperature const& temp )
+{
+    return slug + '/' + temp.controller_name();
+}
+
+template< typename Value >
+std::string printerKey( std::string const& slug, Value const& )
+{
+    return slug;
+}
+
+template< typename Value >
+std::string singleKey( Value const& )
+{
+    return std::string();
+}
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_SUBSCRIBER_HPP
@@ -0,0 +1,106 @@
+#ifndef LIB3DPRNET_REPETIER_TEMPERATURE_HISTORY_HPP
+#define LIB3DPRNET_REPETIER_TEMPERATURE_HISTORY_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "3dprnet/core/config.hpp"
+#include "3dprnet/repetier/forward.hpp"
+
+namespace prnet {
+namespace rep {
+
+class Service;
+
+/**
+ * class TemperatureHistory
+ *
+ * Keeps the recent temperature readings of every controller in fixed-size ring buffers, one raw tier and two
+ * downsampled tiers holding minimum, maximum and average per bucket. All buffers of a controller are allocated when
+ * its first reading arrives, appending is O(1) and queries copy into caller-provided storage without allocating.
+ * Queries rely on the readings of a controller being in chronological order, so a reading older than the one before
+ * (as after the system clock was set back) is recorded at the time of that one.
+ */
+
+class PRNET_DLL TemperatureHistory
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    enum Resolution
+    {
+        raw, tenSeconds, oneMinute
+    };
+
+    struct Sample
+    {
+        Clock::time_point time;
+        double wanted;
+        double actual;
+    };
+
+    struct Aggregate
+    {
+        Clock::time_point time;
+        double wanted;
+        double minimum;
+        double maximum;
+        double average;
+        std::uint32_t count;
+    };
+
+    struct Capacity
+    {
+        std::size_t raw = 600;
+        std::size_t tenSeconds = 360;
+        std::size_t oneMinute = 1440;
+    };
+
+private:
+    class Impl;
+
+public:
+    /**
+     * Returns the number of bytes allocated for each controller with the given capacity.
+     */
+    static std::size_t budget( Capacity const& capacity );
+
+    TemperatureHistory();
+    explicit TemperatureHistory( Capacity capacity );
+    TemperatureHistory( TemperatureHistory const& ) = delete;
+    ~TemperatureHistory();
+
+    /**
+     * Records every temperature event of the service until the history is destroyed.
+     */
+    void attach( Service& service );
+
+    void append( std::string const& slug, Temperature const& temp, Clock::time_point time = Clock::now() );
+
+    /**
+     * Copies the raw samples of the controller within [from, to] into out, oldest first, and returns the number of
+     * samples copied. At most count samples are copied.
+     */
+    std::size_t samples( std::string const& slug, std::string const& controller, Clock::time_point from,
+                         Clock::time_point to, Sample* out, std::size_t count ) const;
+
+    /**
+     * Copies the completed buckets of the given downsampled tier within [from, to] into out, oldest first, and
+     * returns the number of buckets copied. The bucket that is still being filled is not reported.
+     */
+    std::size_t aggregates( std::string const& slug, std::string const& controller, Resolution resolution,
+                            Clock::time_point from, Clock::time_point to, Aggregate* out, std::size_t count ) const;
+
+    void clear();
+
+private:
+    std::shared_ptr< Impl > impl_;
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_TEMPERATURE_HISTORY_HPP
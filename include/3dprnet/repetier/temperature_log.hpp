@@ -0,0 +1,110 @@
+#ifndef LIB3DPRNET_REPETIER_TEMPERATURE_LOG_HPP
+#define LIB3DPRNET_REPETIER_TEMPERATURE_LOG_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "3dprnet/core/config.hpp"
+#include "3dprnet/core/filesystem.hpp"
+#include "3dprnet/repetier/forward.hpp"
+
+namespace prnet {
+namespace rep {
+
+class Service;
+
+/**
+ * class TemperatureLogWriter
+ *
+ * Appends temperature readings to a columnar time-series file. Readings are collected per printer and controller
+ * into blocks which store timestamps as delta-of-delta and both temperatures XOR-compressed against their
+ * predecessor (as described for Facebook's Gorilla). Completed blocks are written and flushed by a background thread,
+ * which also closes blocks that have been open for maxBlockAge, so that a crash loses at most that much of the log.
+ */
+
+class PRNET_DLL TemperatureLogWriter
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+private:
+    class Impl;
+
+public:
+    /**
+     * Opens or creates the file at path, throws if it exists but is not a temperature log. A block left incomplete
+     * at its end by a crash is cut off, so that the blocks appended behind it can be read. Each block holds at most
+     * blockSize readings of one controller and is written at the latest maxBlockAge after its first reading, zero
+     * keeps it open until it is full or flushed.
+     */
+    explicit TemperatureLogWriter( filesystem::path const& path, std::size_t blockSize = 1024,
+                                   std::chrono::seconds maxBlockAge = std::chrono::seconds( 60 ) );
+    TemperatureLogWriter( TemperatureLogWriter const& ) = delete;
+    ~TemperatureLogWriter();
+
+    /**
+     * Records every temperature event of the service until the writer is destroyed.
+     */
+    void attach( Service& service );
+
+    void append( std::string const& slug, Temperature const& temp, Clock::time_point time = Clock::now() );
+
+    /**
+     * Closes all partially filled blocks and waits until they are written to disk.
+     */
+    void flush();
+
+private:
+    std::shared_ptr< Impl > impl_;
+};
+
+
+/**
+ * class TemperatureLogReader
+ */
+
+class PRNET_DLL TemperatureLogReader
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct Point
+    {
+        Clock::time_point time;
+        double wanted;
+        double actual;
+    };
+
+    using Handler = std::function< void ( std::string const& slug, std::string const& controller, Point const& point ) >;
+
+private:
+    class Impl;
+
+public:
+    explicit TemperatureLogReader( filesystem::path const& path );
+    TemperatureLogReader( TemperatureLogReader const& ) = delete;
+    ~TemperatureLogReader();
+
+    /**
+     * Invokes handler for every reading within [from, to]. Only blocks overlapping the range are decompressed, all
+     * other blocks are skipped using their headers. An incomplete block at the end of the log is ignored.
+     */
+    void scan( Clock::time_point from, Clock::time_point to, Handler const& handler );
+
+    /**
+     * Same as above, restricted to one controller of one printer.
+     */
+    void scan( std::string const& slug, std::string const& controller, Clock::time_point from, Clock::time_point to,
+               Handler const& handler );
+
+private:
+    std::unique_ptr< Impl > impl_;
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_TEMPERATURE_LOG_HPP
@@ -0,0 +1,31 @@
+#ifndef LIB3DPRNET_REPETIER_TIMEOUTS_HPP
+#define LIB3DPRNET_REPETIER_TIMEOUTS_HPP
+
+#include <chrono>
+
+namespace prnet {
+namespace rep {
+
+/**
+ * struct Timeouts
+ *
+ * A request times out after SRTT + k * RTTVAR of the round trips of its action measured so far (as in RFC 6298),
+ * clamped to [minimum, maximum], or after initial while there are none. If nothing was received for ping, a websocket
+ * ping is sent, and without any frame before it times out (estimated from the earlier pings the same way), the
+ * connection is considered dead. A ping of zero disables pings. By default, pings are sent after 5s, a request times
+ * out after 5s at first and after 2s to 30s with k = 4 later on.
+ */
+
+struct Timeouts
+{
+    std::chrono::milliseconds ping { std::chrono::seconds( 5 ) };
+    std::chrono::milliseconds initial { std::chrono::seconds( 5 ) };
+    std::chrono::milliseconds minimum { std::chrono::seconds( 2 ) };
+    std::chrono::milliseconds maximum { std::chrono::seconds( 30 ) };
+    double k { 4.0 };
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_TIMEOUTS_HPP
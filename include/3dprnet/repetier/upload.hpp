@@ -2,6 +2,7 @@
 #define LIB3DPRNET_REPETIER_UPLOAD_HPP
 
 #include <functional>
+#include <memory>
 #include <system_error>
 
 #include <boost/asio/io_context.hpp>
@@ -22,6 +23,13 @@ using UploadHandler = std::function< void( std::error_code ec ) >;
 void PRNET_DLL uploadModel( boost::asio::io_context &context, Endpoint const &settings, model_ident ident,
                             filesystem::path path, UploadHandler handler = []( auto ec ) {} );
 
+/**
+ * Same as above, counting the bytes sent in metrics and resolving and connecting through resolver if given.
+ */
+void PRNET_DLL uploadModel( boost::asio::io_context &context, Endpoint const &settings, model_ident ident,
+                            filesystem::path path, UploadHandler handler, std::shared_ptr< Metrics > metrics,
+                            std::shared_ptr< ResolverCache > resolver = nullptr );
+
 } // namespace rep
 } // namespace prnet
 
@@ -0,0 +1,108 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "3dprnet/core/allocations.hpp"
+
+using namespace std;
+
+namespace prnet {
+
+namespace detail {
+
+/**
+ * The counters are plain relaxed atomics, operator new must not allocate or take locks. thread_local only holds
+ * trivial types, which need no initialization that could allocate.
+ */
+
+struct AllocationCounters
+{
+    atomic< uint64_t > allocations;
+    atomic< uint64_t > bytes;
+};
+
+static AllocationCounters allocationCounters[ allocationTagCount ] {};
+static thread_local AllocationTag currentTag {};
+static thread_local uint64_t threadCount {};
+
+void trackAllocation( size_t size )
+{
+    auto& counters = allocationCounters[ static_cast< size_t >( currentTag ) ];
+    counters.allocations.fetch_add( 1, memory_order_relaxed );
+    counters.bytes.fetch_add( size, memory_order_relaxed );
+    ++threadCount;
+}
+
+AllocationTag& allocationTag()
+{
+    return currentTag;
+}
+
+uint64_t allocationCount()
+{
+    return threadCount;
+}
+
+} // namespace detail
+
+char const* allocationTagName( AllocationTag tag )
+{
+    switch ( tag ) {
+        case AllocationTag::client: return "client";
+        case AllocationTag::service: return "service";
+        case AllocationTag::frontend: return "frontend";
+        case AllocationTag::upload: return "upload";
+        case AllocationTag::logging: return "logging";
+        default: return "other";
+    }
+}
+
+vector< AllocationStats > allocationStats()
+{
+    vector< AllocationStats > result;
+    if ( allocationTracking ) {
+        for ( size_t i = 0 ; i < allocationTagCount ; ++i ) {
+            result.push_back( {
+                    static_cast< AllocationTag >( i ),
+                    detail::allocationCounters[ i ].allocations.load( memory_order_relaxed ),
+                    detail::allocationCounters[ i ].bytes.load( memory_order_relaxed ) } );
+        }
+    }
+    return result;
+}
+
+} // namespace prnet
+
+#if defined( PRNET_TRACK_ALLOCATIONS )
+
+void* operator new( size_t size )
+{
+    prnet::detail::trackAllocation( size );
+    if ( void* result = malloc( size > 0 ? size : 1 ) ) {
+        return result;
+    }
+    throw bad_alloc();
+}
+
+void* operator new( size_t size, nothrow_t const& ) noexcept
+{
+    prnet::detail::trackAllocation( size );
+    return malloc( size > 0 ? size : 1 );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+    free( ptr );
+}
+
+void operator delete( void* ptr, nothrow_t const& ) noexcept
+{
+    free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+    free( ptr );
+}
+
+#endif
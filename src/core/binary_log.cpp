@@ -0,0 +1,408 @@
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+#if !defined( WIN32 )
+#   include <sys/types.h>
+#   include <unistd.h>
+#else
+#   include <process.h>
+#endif
+
+#include "3dprnet/core/binary_log.hpp"
+#include "3dprnet/core/logging.hpp"
+
+using namespace std;
+
+namespace prnet {
+
+namespace detail {
+
+/**
+ * Calls func with the id of every literal among the encoded arguments.
+ */
+template< typename Func >
+void binaryLiterals( char const* args, size_t length, Func&& func )
+{
+	auto end = args + length;
+	auto varint = [&args, end] {
+		uint64_t result = 0;
+		for ( int shift = 0 ; args != end && shift < 64 ; shift += 7 ) {
+			auto byte = static_cast< uint8_t >( *args++ );
+			result |= static_cast< uint64_t >( byte & 0x7f ) << shift;
+			if ( ( byte & 0x80 ) == 0 ) {
+				return result;
+			}
+		}
+		throw runtime_error( "corrupt binary log record" );
+	};
+
+	while ( args < end ) {
+		switch ( static_cast< BinaryLogArg >( *args++ ) ) {
+			case BinaryLogArg::literal:
+				func( static_cast< uint32_t >( varint() ) );
+				break;
+			case BinaryLogArg::string:
+				args += varint();
+				break;
+			case BinaryLogArg::signedInt:
+			case BinaryLogArg::unsignedInt:
+				varint();
+				break;
+			case BinaryLogArg::floating:
+				args += 8;
+				break;
+			default:
+				throw runtime_error( "corrupt binary log record" );
+		}
+	}
+}
+
+uint32_t binaryLiteral( char const* text, size_t length )
+{
+	// the registry is only consulted the first time a thread sees a literal
+	thread_local unordered_map< char const*, pair< uint32_t, string const* > > cache;
+
+	auto it = cache.find( text );
+	if ( it == cache.end() ) {
+		auto& registry = BinaryLogRegistry::instance();
+		auto id = registry.literal( text, length );
+		it = cache.emplace( text, make_pair( id, &registry.literalText( id ) ) ).first;
+	}
+
+	// a char array that is a buffer rather than a literal may have changed since it was registered
+	auto const& registered = *it->second.second;
+	if ( registered.size() != length || memcmp( registered.data(), text, length ) != 0 ) {
+		return binaryLogNoLiteral;
+	}
+	return it->second.first;
+}
+
+
+/**
+ * class BinaryLogRegistry
+ */
+
+class BinaryLogRegistry::Impl
+{
+	using Lock = lock_guard< mutex >;
+
+public:
+	uint32_t tag( string const& text )
+	{
+		Lock lock( mutex_ );
+		auto it = tagIds_.find( text );
+		if ( it != tagIds_.end() ) {
+			return it->second;
+		}
+		auto id = static_cast< uint32_t >( tags_.size() );
+		tags_.push_back( text );
+		tagIds_.emplace( text, id );
+		return id;
+	}
+
+	uint32_t literal( char const* text, size_t length )
+	{
+		Lock lock( mutex_ );
+		auto it = literalIds_.find( text );
+		if ( it != literalIds_.end() ) {
+			return it->second;
+		}
+		auto id = static_cast< uint32_t >( literals_.size() );
+		literals_.emplace_back( text, length );
+		literalIds_.emplace( text, id );
+		return id;
+	}
+
+	string const& tagText( uint32_t id ) const
+	{
+		Lock lock( mutex_ );
+		return tags_.at( id );
+	}
+
+	string const& literalText( uint32_t id ) const
+	{
+		Lock lock( mutex_ );
+		return literals_.at( id );
+	}
+
+private:
+	mutable mutex mutex_;
+	deque< string > tags_;
+	unordered_map< string, uint32_t > tagIds_;
+	deque< string > literals_;
+	unordered_map< char const*, uint32_t > literalIds_;
+};
+
+BinaryLogRegistry& BinaryLogRegistry::instance()
+{
+	static BinaryLogRegistry registry;
+	return registry;
+}
+
+BinaryLogRegistry::BinaryLogRegistry()
+	: impl_( make_unique< Impl >() )
+{
+}
+
+BinaryLogRegistry::~BinaryLogRegistry() = default;
+
+uint32_t BinaryLogRegistry::tag( string const& text )
+{
+	return impl_->tag( text );
+}
+
+uint32_t BinaryLogRegistry::literal( char const* text, size_t length )
+{
+	return impl_->literal( text, length );
+}
+
+string const& BinaryLogRegistry::tagText( uint32_t id ) const
+{
+	return impl_->tagText( id );
+}
+
+string const& BinaryLogRegistry::literalText( uint32_t id ) const
+{
+	return impl_->literalText( id );
+}
+
+
+/**
+ * class BinaryLogWriter
+ */
+
+BinaryLogWriter::BinaryLogWriter( char const* path )
+	: out_( path, ios::out | ios::binary | ios::app )
+{
+	if ( !out_ ) {
+		throw system_error( make_error_code( errc::io_error ), string( "unable to open binary log " ) + path );
+	}
+
+	buffer_.assign( binaryLogMagic, sizeof( binaryLogMagic ) - 1 );
+	binaryVarint( buffer_, static_cast< uint64_t >( getpid() ) );
+	out_.write( buffer_.data(), static_cast< streamsize >( buffer_.size() ) );
+}
+
+void BinaryLogWriter::append( uint32_t tag, unsigned level, int64_t time, char const* args, size_t length )
+{
+	define( BinaryLogEntry::tag, tag, tags_ );
+	binaryLiterals( args, length, [this]( uint32_t id ) { this->define( BinaryLogEntry::literal, id, literals_ ); } );
+
+	buffer_.clear();
+	buffer_.push_back( static_cast< char >( BinaryLogEntry::record ) );
+	binaryVarint( buffer_, tag );
+	buffer_.push_back( static_cast< char >( level ) );
+	binaryVarint( buffer_, binaryZigzag( time - lastTime_ ) );
+	binaryVarint( buffer_, length );
+	out_.write( buffer_.data(), static_cast< streamsize >( buffer_.size() ) );
+	out_.write( args, static_cast< streamsize >( length ) );
+	lastTime_ = time;
+}
+
+void BinaryLogWriter::flush()
+{
+	out_.flush();
+}
+
+void BinaryLogWriter::define( BinaryLogEntry entry, uint32_t id, vector< bool >& defined )
+{
+	if ( id < defined.size() && defined[ id ] ) {
+		return;
+	}
+	if ( id >= defined.size() ) {
+		defined.resize( id + 1 );
+	}
+	defined[ id ] = true;
+
+	auto& registry = BinaryLogRegistry::instance();
+	auto const& text = entry == BinaryLogEntry::tag ? registry.tagText( id ) : registry.literalText( id );
+
+	buffer_.clear();
+	buffer_.push_back( static_cast< char >( entry ) );
+	binaryVarint( buffer_, id );
+	binaryVarint( buffer_, text.size() );
+	buffer_.append( text );
+	out_.write( buffer_.data(), static_cast< streamsize >( buffer_.size() ) );
+}
+
+} // namespace detail
+
+
+/**
+ * class BinaryLogReader
+ */
+
+BinaryLogReader::BinaryLogReader( istream& in )
+	: in_( in )
+{
+}
+
+bool BinaryLogReader::next( ostream& out )
+{
+	static Logger::Level const* const levels[] {
+			&Logger::Level::error, &Logger::Level::warning, &Logger::Level::info, &Logger::Level::debug };
+
+	while ( true ) {
+		auto type = in_.get();
+		if ( type == istream::traits_type::eof() ) {
+			return false;
+		}
+
+		if ( type == detail::binaryLogMagic[ 0 ] ) {
+			segment();
+			continue;
+		}
+		if ( pid_.empty() ) {
+			throw runtime_error( "corrupt binary log: missing segment header" );
+		}
+
+		switch ( static_cast< detail::BinaryLogEntry >( type ) ) {
+			case detail::BinaryLogEntry::tag:
+			case detail::BinaryLogEntry::literal: {
+				auto& table = static_cast< detail::BinaryLogEntry >( type ) == detail::BinaryLogEntry::tag
+						? tags_ : literals_;
+				auto id = static_cast< size_t >( varint() );
+				if ( id >= table.size() ) {
+					table.resize( id + 1 );
+				}
+				table[ id ] = text();
+				break;
+			}
+			case detail::BinaryLogEntry::record: {
+				auto tag = static_cast< size_t >( varint() );
+				auto level = byte();
+				auto delta = varint();
+				lastTime_ += static_cast< int64_t >( delta >> 1 ) ^ -static_cast< int64_t >( delta & 1 );
+				args_ = text();
+				if ( tag >= tags_.size() || level >= sizeof( levels ) / sizeof( levels[ 0 ] ) ) {
+					throw runtime_error( "corrupt binary log: undefined tag or level" );
+				}
+
+				char timestamp[ detail::timestampLength ];
+				out.write( timestamp, static_cast< streamsize >( detail::formatTimestamp(
+						timestamp, chrono::system_clock::time_point( chrono::microseconds( lastTime_ ) ) ) ) );
+				out << " [" << pid_ << "] [" << tags_[ tag ] << "] [" << levels[ level ]->name << "] ";
+				render( out );
+				out << '\n';
+				return true;
+			}
+			default:
+				throw runtime_error( "corrupt binary log: unknown entry type" );
+		}
+	}
+}
+
+void BinaryLogReader::render( ostream& out )
+{
+	auto args = args_.data();
+	auto end = args + args_.size();
+	auto varint = [&args, end] {
+		uint64_t result = 0;
+		for ( int shift = 0 ; args != end && shift < 64 ; shift += 7 ) {
+			auto byte = static_cast< uint8_t >( *args++ );
+			result |= static_cast< uint64_t >( byte & 0x7f ) << shift;
+			if ( ( byte & 0x80 ) == 0 ) {
+				return result;
+			}
+		}
+		throw runtime_error( "corrupt binary log: truncated argument" );
+	};
+
+	while ( args < end ) {
+		switch ( static_cast< detail::BinaryLogArg >( *args++ ) ) {
+			case detail::BinaryLogArg::literal: {
+				auto id = static_cast< size_t >( varint() );
+				if ( id >= literals_.size() ) {
+					throw runtime_error( "corrupt binary log: undefined literal" );
+				}
+				out << literals_[ id ];
+				break;
+			}
+			case detail::BinaryLogArg::string: {
+				auto length = varint();
+				if ( length > static_cast< uint64_t >( end - args ) ) {
+					throw runtime_error( "corrupt binary log: truncated argument" );
+				}
+				out.write( args, static_cast< streamsize >( length ) );
+				args += length;
+				break;
+			}
+			case detail::BinaryLogArg::signedInt: {
+				auto value = varint();
+				out << ( static_cast< int64_t >( value >> 1 ) ^ -static_cast< int64_t >( value & 1 ) );
+				break;
+			}
+			case detail::BinaryLogArg::unsignedInt:
+				out << varint();
+				break;
+			case detail::BinaryLogArg::floating: {
+				if ( end - args < 8 ) {
+					throw runtime_error( "corrupt binary log: truncated argument" );
+				}
+				uint64_t bits = 0;
+				for ( int i = 0 ; i < 8 ; ++i ) {
+					bits |= static_cast< uint64_t >( static_cast< uint8_t >( *args++ ) ) << ( i * 8 );
+				}
+				double value;
+				memcpy( &value, &bits, sizeof( value ) );
+				out << value;
+				break;
+			}
+			default:
+				throw runtime_error( "corrupt binary log: unknown argument type" );
+		}
+	}
+}
+
+uint64_t BinaryLogReader::varint()
+{
+	uint64_t result = 0;
+	for ( int shift = 0 ; shift < 64 ; shift += 7 ) {
+		auto value = byte();
+		result |= static_cast< uint64_t >( value & 0x7f ) << shift;
+		if ( ( value & 0x80 ) == 0 ) {
+			return result;
+		}
+	}
+	throw runtime_error( "corrupt binary log: invalid varint" );
+}
+
+uint8_t BinaryLogReader::byte()
+{
+	auto value = in_.get();
+	if ( value == istream::traits_type::eof() ) {
+		throw runtime_error( "truncated binary log" );
+	}
+	return static_cast< uint8_t >( value );
+}
+
+string BinaryLogReader::text()
+{
+	auto length = static_cast< size_t >( varint() );
+	string result( length, '\0' );
+	if ( !in_.read( &result[ 0 ], static_cast< streamsize >( length ) ) ) {
+		throw runtime_error( "truncated binary log" );
+	}
+	return result;
+}
+
+void BinaryLogReader::segment()
+{
+	char magic[ sizeof( detail::binaryLogMagic ) - 2 ];
+	if ( !in_.read( magic, sizeof( magic ) ) || memcmp( magic, detail::binaryLogMagic + 1, sizeof( magic ) ) != 0 ) {
+		throw runtime_error( "corrupt binary log: invalid segment header" );
+	}
+
+	auto pid = to_string( varint() );
+	pid_ = string( pid.length() < 5 ? 5 - pid.length() : 0, ' ' ) + pid;
+	tags_.clear();
+	literals_.clear();
+	lastTime_ = 0;
+}
+
+} // namespace prnet
@@ -15,6 +15,7 @@ ostream& operator<<( ostream& os, ToUtf8 const& value )
     for_each( value.native_.begin(), value.native_.end(), [out = ostream_iterator< uint8_t >( os )]( uint8_t ch ) {
         utf8::unchecked::append( static_cast< uint32_t >( ch ), out );
     } );
+    return os;
 }
 
 ostream& operator<<( ostream& os, FromUtf8 const& value )
@@ -23,6 +24,7 @@ ostream& operator<<( ostream& os, FromUtf8 const& value )
         uint32_t cp = utf8::unchecked::next( it );
         os << ( cp < 256 ? static_cast< char >( static_cast< uint8_t >( cp ) ) : '_' );
     }
+    return os;
 }
 
 } // namespace enc
@@ -1,13 +1,24 @@
+#include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <fstream>
-#include <iomanip>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+#include <vector>
 
 #if !defined( WIN32 )
+#   include <pthread.h>
 #   include <sys/types.h>
 #   include <unistd.h>
+#else
+#   include <process.h>
 #endif
 
 #include "3dprnet/core/logging.hpp"
@@ -18,27 +29,114 @@ namespace prnet {
 
 namespace detail {
 
-ostream& logTimestamp( ostream &os )
+struct TimestampCache
 {
-	auto timestamp { chrono::high_resolution_clock::now().time_since_epoch() };
-	auto seconds { chrono::duration_cast< chrono::seconds >( timestamp ) };
-	auto micros { chrono::duration_cast< chrono::microseconds >( timestamp - seconds ) };
-	time_t tt { seconds.count() };
-	tm* tm { localtime( &tt ) };
+	int64_t second { INT64_MIN };
+	char prefix[ timestampLength - 6 ];
+};
 
-	return os
-			<< setw( 4 ) << setfill( '0' ) << ( tm->tm_year + 1900 ) << "/"
-			<< setw( 2 ) << setfill( '0' ) << ( tm->tm_mon + 1 ) << "/"
-			<< setw( 2 ) << setfill( '0' ) << tm->tm_mday << " "
-			<< setw( 2 ) << setfill( '0' ) << tm->tm_hour << ":"
-			<< setw( 2 ) << setfill( '0' ) << tm->tm_min << ":"
-			<< setw( 2 ) << setfill( '0' ) << tm->tm_sec << "."
-			<< setw( 6 ) << setfill( '0' ) << micros.count();
+inline char* formatDigits( char* out, unsigned value, size_t digits )
+{
+	for ( auto i = digits ; i > 0 ; --i ) {
+		out[ i - 1 ] = static_cast< char >( '0' + value % 10 );
+		value /= 10;
+	}
+	return out + digits;
+}
+
+size_t formatTimestamp( char* buffer, chrono::system_clock::time_point time )
+{
+	thread_local TimestampCache cache;
+
+	auto timestamp = chrono::duration_cast< chrono::microseconds >( time.time_since_epoch() );
+	auto seconds = chrono::duration_cast< chrono::seconds >( timestamp );
+	auto micros = ( timestamp - seconds ).count();
+	if ( micros < 0 ) {
+		seconds -= chrono::seconds( 1 );
+		micros += 1000000;
+	}
+
+	if ( seconds.count() != cache.second ) {
+		time_t tt = seconds.count();
+		tm tm;
+#if defined( WIN32 )
+		localtime_s( &tm, &tt );
+#else
+		localtime_r( &tt, &tm );
+#endif
+
+		auto out = cache.prefix;
+		out = formatDigits( out, static_cast< unsigned >( tm.tm_year + 1900 ), 4 );
+		*out++ = '/';
+		out = formatDigits( out, static_cast< unsigned >( tm.tm_mon + 1 ), 2 );
+		*out++ = '/';
+		out = formatDigits( out, static_cast< unsigned >( tm.tm_mday ), 2 );
+		*out++ = ' ';
+		out = formatDigits( out, static_cast< unsigned >( tm.tm_hour ), 2 );
+		*out++ = ':';
+		out = formatDigits( out, static_cast< unsigned >( tm.tm_min ), 2 );
+		*out++ = ':';
+		out = formatDigits( out, static_cast< unsigned >( tm.tm_sec ), 2 );
+		*out = '.';
+		cache.second = seconds.count();
+	}
+
+	memcpy( buffer, cache.prefix, sizeof( cache.prefix ) );
+	formatDigits( buffer + sizeof( cache.prefix ), static_cast< unsigned >( micros ), 6 );
+	return timestampLength;
+}
+
+ostream& logTimestamp( ostream& os )
+{
+	char buffer[ timestampLength ];
+	return os.write( buffer, static_cast< streamsize >( formatTimestamp( buffer, chrono::system_clock::now() ) ) );
 }
 
+/**
+ * The pid formatted to five characters, refreshed in the child after fork.
+ */
+
+struct PidCache
+{
+	PidCache()
+	{
+		update();
+#if !defined( WIN32 )
+		pthread_atfork( nullptr, nullptr, [] { instance().update(); } );
+#endif
+	}
+
+	static PidCache& instance()
+	{
+		static PidCache cache;
+		return cache;
+	}
+
+	void update()
+	{
+		auto pid = static_cast< unsigned >( getpid() );
+		char digits[ 16 ];
+		auto end = digits + sizeof( digits );
+		auto out = end;
+		do {
+			*--out = static_cast< char >( '0' + pid % 10 );
+			pid /= 10;
+		} while ( pid != 0 );
+		while ( end - out < 5 ) {
+			*--out = ' ';
+		}
+		length = static_cast< size_t >( end - out );
+		memcpy( text, out, length );
+	}
+
+	char text[ 16 ];
+	size_t length;
+};
+
 ostream& logPid( ostream& os )
 {
-	return os << setw( 5 ) << setfill( ' ' ) << getpid();
+	auto const& pid = PidCache::instance();
+	return os.write( pid.text, static_cast< streamsize >( pid.length ) );
 }
 
 template< size_t L >
@@ -62,6 +160,490 @@ string buildTag( string&& tag )
 	return result;
 }
 
+
+/**
+ * class LogRecordBuffer
+ *
+ * Collects the arguments of one asynchronous log call, the string is reused by all calls of the thread.
+ */
+
+class LogRecordBuffer
+		: public streambuf
+{
+public:
+	string& text() { return text_; }
+
+protected:
+	int_type overflow( int_type ch ) override
+	{
+		if ( !traits_type::eq_int_type( ch, traits_type::eof() ) ) {
+			text_.push_back( traits_type::to_char_type( ch ) );
+		}
+		return ch;
+	}
+
+	streamsize xsputn( char const* s, streamsize count ) override
+	{
+		text_.append( s, static_cast< size_t >( count ) );
+		return count;
+	}
+
+private:
+	string text_;
+};
+
+struct LogRecordStream
+{
+	LogRecordBuffer buffer;
+	ostream stream { &buffer };
+};
+
+inline LogRecordStream& threadRecord()
+{
+	thread_local LogRecordStream record;
+	return record;
+}
+
+
+/**
+ * class LogRing
+ *
+ * Single producer, single consumer ring buffer of variable sized records. Positions grow monotonically and are masked
+ * with the power of two capacity. A record that does not fit before the end of the buffer is preceded by a padding
+ * record that fills the remainder.
+ */
+
+struct LogRecordHeader
+{
+	uint32_t size;
+	uint32_t length;
+	int64_t time;
+	Logger::Level const* level;
+	uint32_t tagId;
+	uint32_t binary;
+	char tag[ 16 ];
+};
+
+class LogRing
+{
+	static constexpr uint32_t paddingMarker = UINT32_MAX;
+
+public:
+	static size_t alignment( size_t size ) { return ( size + 7 ) & ~size_t( 7 ); }
+
+	LogRing( size_t capacity, size_t generation )
+			: generation( generation )
+			, buffer_( capacity )
+			, mask_( capacity - 1 ) {}
+
+	size_t capacity() const { return buffer_.size(); }
+	bool empty() const { return head_.load( memory_order_acquire ) == tail_.load( memory_order_acquire ); }
+
+	/**
+	 * Returns false if the record does not fit, half is set if the buffer is more than half full afterwards.
+	 */
+	bool push( LogRecordHeader& header, char const* text, size_t length, bool& half )
+	{
+		auto size = alignment( sizeof( LogRecordHeader ) + length );
+		auto tail = tail_.load( memory_order_relaxed );
+		auto head = head_.load( memory_order_acquire );
+		auto offset = tail & mask_;
+		auto contiguous = buffer_.size() - offset;
+		auto needed = contiguous < size ? contiguous + size : size;
+		if ( buffer_.size() - ( tail - head ) < needed ) {
+			return false;
+		}
+
+		if ( contiguous < size ) {
+			uint32_t padding[] { static_cast< uint32_t >( contiguous ), paddingMarker };
+			memcpy( &buffer_[ offset ], padding, sizeof( padding ) );
+			tail += contiguous;
+			offset = 0;
+		}
+
+		header.size = static_cast< uint32_t >( size );
+		header.length = static_cast< uint32_t >( length );
+		memcpy( &buffer_[ offset ], &header, sizeof( header ) );
+		memcpy( &buffer_[ offset + sizeof( header ) ], text, length );
+		tail_.store( tail + size, memory_order_release );
+
+		half = tail + size - head > buffer_.size() / 2;
+		return true;
+	}
+
+	template< typename Func >
+	size_t pop( Func&& func )
+	{
+		auto head = head_.load( memory_order_relaxed );
+		auto tail = tail_.load( memory_order_acquire );
+		size_t count = 0;
+		while ( head != tail ) {
+			auto offset = head & mask_;
+			uint32_t prefix[ 2 ];
+			memcpy( prefix, &buffer_[ offset ], sizeof( prefix ) );
+			if ( prefix[ 1 ] != paddingMarker ) {
+				LogRecordHeader header;
+				memcpy( &header, &buffer_[ offset ], sizeof( header ) );
+				func( header, &buffer_[ offset + sizeof( header ) ] );
+				++count;
+			}
+			head += prefix[ 0 ];
+			head_.store( head, memory_order_release );
+		}
+		return count;
+	}
+
+	size_t const generation;
+	atomic< bool > closed {};
+
+private:
+	vector< char > buffer_;
+	size_t mask_;
+	atomic< size_t > head_ {};
+	atomic< size_t > tail_ {};
+};
+
+
+/**
+ * class LogWriter
+ *
+ * Owns the ring buffers of all logging threads and the background thread that drains them. Lines of different
+ * threads written in the same batch are grouped by thread, the order within one thread is kept.
+ */
+
+class LogWriter
+{
+	struct RingHolder
+	{
+		~RingHolder()
+		{
+			if ( ring ) {
+				ring->closed = true;
+			}
+		}
+
+		shared_ptr< LogRing > ring;
+	};
+
+public:
+	static LogWriter& instance()
+	{
+		static LogWriter writer;
+		return writer;
+	}
+
+	~LogWriter()
+	{
+		stop();
+	}
+
+	void start( Logger::AsyncOptions const& options )
+	{
+		stop();
+
+		size_t capacity = 4096;
+		while ( capacity < options.bufferSize ) {
+			capacity <<= 1;
+		}
+
+		unique_lock< mutex > lock( mutex_ );
+		capacity_.store( capacity, memory_order_relaxed );
+		overflow_.store( options.overflow, memory_order_relaxed );
+		interval_ = options.interval;
+		rings_.clear();
+		dropped_.store( 0, memory_order_relaxed );
+		reported_ = 0;
+		generation_.fetch_add( 1, memory_order_release );
+		running_ = true;
+		thread_ = thread( [this] { this->run(); } );
+	}
+
+	void stop()
+	{
+		{
+			unique_lock< mutex > lock( mutex_ );
+			if ( !running_ ) {
+				return;
+			}
+			running_ = false;
+		}
+		wakeup_.notify_one();
+		drained_.notify_all();
+		thread_.join();
+
+		// records pushed by threads that passed the check of Logger::async_ just before the switch are lost
+		unique_lock< mutex > lock( mutex_ );
+		rings_.clear();
+	}
+
+	void flush()
+	{
+		unique_lock< mutex > lock( mutex_ );
+		if ( !running_ ) {
+			return;
+		}
+		auto requested = ++flushRequested_;
+		wakeup_.notify_one();
+		flushed_.wait( lock, [this, requested] { return flushCompleted_ >= requested || !running_; } );
+	}
+
+	size_t dropped() const
+	{
+		return dropped_.load( memory_order_relaxed );
+	}
+
+	/**
+	 * Returns false if a binary record is too large for the ring buffer, text records are truncated instead.
+	 */
+	bool push( string const& tag, uint32_t tagId, Logger::Level const& level, string& text, bool binary )
+	{
+		auto& ring = this->ring();
+
+		auto limit = ring.capacity() / 2 - sizeof( LogRecordHeader );
+		if ( binary && text.size() > limit ) {
+			return false;
+		}
+		if ( text.size() > limit ) {
+			static char const truncated[] = " [truncated]";
+			text.resize( limit - sizeof( truncated ) );
+			text.append( truncated );
+		}
+
+		LogRecordHeader header {};
+		header.time = chrono::duration_cast< chrono::microseconds >(
+				chrono::system_clock::now().time_since_epoch() ).count();
+		header.level = &level;
+		header.tagId = tagId;
+		header.binary = binary;
+		memcpy( header.tag, tag.data(), min( tag.size(), sizeof( header.tag ) - 1 ) );
+
+		bool half;
+		while ( !ring.push( header, text.data(), text.size(), half ) ) {
+			if ( overflow_.load( memory_order_relaxed ) != Logger::Overflow::block
+				 || !running_.load( memory_order_relaxed ) ) {
+				dropped_.fetch_add( 1, memory_order_relaxed );
+				return true;
+			}
+			// sleeps until the writer has drained the rings once more, it does not sleep itself while anyone waits
+			unique_lock< mutex > lock( mutex_ );
+			auto drains = drains_;
+			++blocked_;
+			wakeup_.notify_one();
+			drained_.wait( lock, [this, drains] { return drains_ != drains || !running_; } );
+			--blocked_;
+		}
+		if ( half ) {
+			wakeup_.notify_one();
+		}
+		return true;
+	}
+
+private:
+	LogWriter() = default;
+
+	LogRing& ring()
+	{
+		thread_local RingHolder holder;
+
+		auto generation = generation_.load( memory_order_acquire );
+		if ( !holder.ring || holder.ring->generation != generation ) {
+			auto ring = make_shared< LogRing >( capacity_.load( memory_order_relaxed ), generation );
+			unique_lock< mutex > lock( mutex_ );
+			if ( holder.ring ) {
+				holder.ring->closed = true;
+			}
+			rings_.push_back( ring );
+			holder.ring = move( ring );
+		}
+		return *holder.ring;
+	}
+
+	void run()
+	{
+		AllocationScope scope( AllocationTag::logging );
+		unique_lock< mutex > lock( mutex_ );
+		while ( true ) {
+			auto stopping = !running_;
+			auto requested = flushRequested_;
+			auto rings = rings_;
+			lock.unlock();
+
+			drain( rings );
+
+			lock.lock();
+			rings_.erase( remove_if( rings_.begin(), rings_.end(), []( auto const& ring ) {
+				return ring->closed && ring->empty();
+			} ), rings_.end() );
+			flushCompleted_ = requested;
+			flushed_.notify_all();
+			++drains_;
+			drained_.notify_all();
+
+			if ( stopping ) {
+				break;
+			}
+			if ( running_ && flushRequested_ == flushCompleted_ && blocked_ == 0 ) {
+				wakeup_.wait_for( lock, interval_ );
+			}
+		}
+	}
+
+	void drain( vector< shared_ptr< LogRing > > const& rings )
+	{
+		batch_.str( string() );
+
+		size_t count = 0;
+		for ( auto const& ring : rings ) {
+			count += ring->pop( [this]( LogRecordHeader const& header, char const* text ) {
+				if ( header.binary ) {
+					Logger::writeBinary( header.tagId, *header.level, header.time, text, header.length );
+					return;
+				}
+				char timestamp[ timestampLength ];
+				batch_.write( timestamp, static_cast< streamsize >( formatTimestamp(
+						timestamp, chrono::system_clock::time_point( chrono::microseconds( header.time ) ) ) ) );
+				batch_ << " [" << logPid << "] [" << header.tag << "] [" << header.level->name << "] ";
+				batch_.write( text, header.length );
+				batch_.put( '\n' );
+			} );
+		}
+
+		auto dropped = dropped_.load( memory_order_relaxed );
+		if ( overflow_.load( memory_order_relaxed ) == Logger::Overflow::count && dropped != reported_ ) {
+			static char const tag[] = "    logging    ";
+			static char const message[] = " log records dropped due to full buffers";
+			if ( Logger::binary_.load( memory_order_acquire ) ) {
+				notice_.clear();
+				binaryAppend( notice_, dropped - reported_, message );
+				Logger::writeBinary( BinaryLogRegistry::instance().tag( tag ), Logger::Level::warning,
+									 chrono::duration_cast< chrono::microseconds >(
+											 chrono::system_clock::now().time_since_epoch() ).count(),
+									 notice_.data(), notice_.size() );
+			} else {
+				logTimestamp( batch_ ) << " [" << logPid << "] [" << tag << "] [" << Logger::Level::warning.name
+						<< "] " << ( dropped - reported_ ) << message << "\n";
+			}
+			reported_ = dropped;
+			++count;
+		}
+
+		if ( count > 0 ) {
+			Logger::writeBatch( batch_.str() );
+		}
+	}
+
+	mutex mutex_;
+	condition_variable wakeup_;
+	condition_variable flushed_;
+	condition_variable drained_;
+	vector< shared_ptr< LogRing > > rings_;
+	thread thread_;
+	chrono::milliseconds interval_ {};
+	atomic< bool > running_ {};
+	atomic< size_t > generation_ {};
+	atomic< size_t > capacity_ {};
+	atomic< Logger::Overflow > overflow_ { Logger::Overflow::block };
+	atomic< size_t > dropped_ {};
+	size_t reported_ {};
+	size_t flushRequested_ {};
+	size_t flushCompleted_ {};
+	size_t drains_ {};
+	size_t blocked_ {};
+	ostringstream batch_;
+	string notice_;
+};
+
+
+
+/**
+ * class LoggerRegistry
+ *
+ * Keeps track of all loggers to apply the per-tag thresholds. Loggers are mostly static objects, the registry is a
+ * function local static so that it exists before the first of them is constructed.
+ */
+
+class LoggerRegistry
+{
+	using Lock = lock_guard< mutex >;
+
+public:
+	static LoggerRegistry& instance()
+	{
+		static LoggerRegistry registry;
+		return registry;
+	}
+
+	/**
+	 * The threshold of the logger is applied under the lock as well, so that a concurrent threshold() cannot be lost.
+	 */
+	template< typename Apply >
+	void add( Logger* logger, Apply&& apply )
+	{
+		Lock lock( mutex_ );
+		loggers_.push_back( logger );
+		apply( *logger, lookup( logger->name() ) );
+	}
+
+	void remove( Logger* logger )
+	{
+		Lock lock( mutex_ );
+		loggers_.erase( std::remove( loggers_.begin(), loggers_.end(), logger ), loggers_.end() );
+	}
+
+	template< typename Apply >
+	void threshold( unsigned level, Apply&& apply )
+	{
+		Lock lock( mutex_ );
+		default_ = level;
+		update( apply );
+	}
+
+	template< typename Apply >
+	void threshold( string const& tag, unsigned level, Apply&& apply )
+	{
+		Lock lock( mutex_ );
+		tags_[ tag ] = level;
+		update( apply );
+	}
+
+private:
+	LoggerRegistry() = default;
+
+	unsigned lookup( string const& name ) const
+	{
+		auto result = default_;
+		long best = -1;
+		for ( auto const& tag : tags_ ) {
+			auto const& pattern = tag.first;
+			bool wildcard = !pattern.empty() && pattern.back() == '*';
+			auto length = wildcard ? pattern.length() - 1 : pattern.length();
+			bool matches = wildcard
+					? name.compare( 0, length, pattern, 0, length ) == 0
+					: name == pattern;
+			// an exact match beats a wildcard of the same length
+			auto weight = static_cast< long >( length * 2 + ( wildcard ? 0 : 1 ) );
+			if ( matches && weight > best ) {
+				result = tag.second;
+				best = weight;
+			}
+		}
+		return result;
+	}
+
+	template< typename Apply >
+	void update( Apply& apply )
+	{
+		for ( auto logger : loggers_ ) {
+			apply( *logger, lookup( logger->name() ) );
+		}
+	}
+
+	mutex mutex_;
+	vector< Logger* > loggers_;
+	map< string, unsigned > tags_;
+	unsigned default_ { Logger::Level::warning.level };
+};
+
 } // namespace detail
 
 Logger::Level const Logger::Level::debug   { "DEBUG", 3 };
@@ -69,33 +651,162 @@ Logger::Level const Logger::Level::info    { "INFO ", 2 };
 Logger::Level const Logger::Level::warning { "WARN ", 1 };
 Logger::Level const Logger::Level::error   { "ERROR", 0 };
 
-Logger::Level const* Logger::level_ = &Logger::Level::warning;
 shared_ptr< ostream > Logger::output_( &cerr, []( ostream const* ) {} );
+unique_ptr< detail::BinaryLogWriter > Logger::binaryOutput_;
 recursive_mutex Logger::mutex_;
+atomic< bool > Logger::async_;
+atomic< bool > Logger::binary_;
 
-bool Logger::is( Level const& level )
+void Logger::threshold( Level const& level )
 {
-	return level_->level >= level.level;
+	detail::LoggerRegistry::instance().threshold( level.level, []( Logger& logger, unsigned threshold ) {
+		logger.threshold_.store( threshold, memory_order_relaxed );
+	} );
 }
 
-void Logger::threshold( Level const& level )
+void Logger::threshold( string const& tag, Level const& level )
 {
-	level_ = &level;
+	detail::LoggerRegistry::instance().threshold( tag, level.level, []( Logger& logger, unsigned threshold ) {
+		logger.threshold_.store( threshold, memory_order_relaxed );
+	} );
 }
 
 void Logger::output( ostream& output )
 {
+	Lock lock( mutex_ );
 	output_.reset( &output, []( ostream const* ) {} );
+	binary_.store( false, memory_order_release );
 }
 
 void Logger::output( char const* output )
 {
+	Lock lock( mutex_ );
 	output_.reset( new ofstream( output, ios::out | ios::app ) );
+	binary_.store( false, memory_order_release );
+}
+
+void Logger::binary( char const* path )
+{
+	auto output = make_unique< detail::BinaryLogWriter >( path );
+
+	Lock lock( mutex_ );
+	binaryOutput_ = move( output );
+	binary_.store( true, memory_order_release );
+}
+
+Logger::AsyncOptions Logger::defaultAsyncOptions()
+{
+	return { 1024 * 1024, Overflow::count, chrono::milliseconds( 10 ) };
+}
+
+void Logger::async()
+{
+	async( defaultAsyncOptions() );
+}
+
+void Logger::async( AsyncOptions const& options )
+{
+	async_.store( false, memory_order_release );
+	detail::LogWriter::instance().start( options );
+	async_.store( true, memory_order_release );
+}
+
+void Logger::synchronous()
+{
+	if ( async_.exchange( false, memory_order_acq_rel ) ) {
+		detail::LogWriter::instance().stop();
+	}
+}
+
+void Logger::flush()
+{
+	if ( async_.load( memory_order_acquire ) ) {
+		detail::LogWriter::instance().flush();
+	}
+	Lock lock( mutex_ );
+	output_->flush();
+	if ( binaryOutput_ ) {
+		binaryOutput_->flush();
+	}
+}
+
+size_t Logger::dropped()
+{
+	return detail::LogWriter::instance().dropped();
+}
+
+ostream& Logger::record()
+{
+	auto& record = detail::threadRecord();
+	record.buffer.text().clear();
+	record.stream.clear();
+	return record.stream;
+}
+
+string& Logger::binaryRecord()
+{
+	auto& text = detail::threadRecord().buffer.text();
+	text.clear();
+	return text;
+}
+
+void Logger::enqueue( string const& tag, Level const& level )
+{
+	detail::LogWriter::instance().push( tag, 0, level, detail::threadRecord().buffer.text(), false );
+}
+
+void Logger::writeBatch( string const& text )
+{
+	Lock lock( mutex_ );
+	if ( !text.empty() ) {
+		output_->write( text.data(), static_cast< streamsize >( text.size() ) );
+		output_->flush();
+	}
+	if ( binaryOutput_ ) {
+		binaryOutput_->flush();
+	}
+}
+
+void Logger::writeBinary( uint32_t tag, Level const& level, int64_t time, char const* args, size_t length )
+{
+	Lock lock( mutex_ );
+	if ( binaryOutput_ ) {
+		binaryOutput_->append( tag, level.level, time, args, length );
+	}
+}
+
+void Logger::commit( Level const& level )
+{
+	auto& args = detail::threadRecord().buffer.text();
+	if ( async_.load( memory_order_acquire ) ) {
+		auto& writer = detail::LogWriter::instance();
+		if ( writer.push( tag_, tagId_, level, args, true ) ) {
+			return;
+		}
+		// too large for the ring buffer, written directly after everything queued before
+		writer.flush();
+	}
+
+	auto time = chrono::duration_cast< chrono::microseconds >( chrono::system_clock::now().time_since_epoch() );
+	writeBinary( tagId_, level, time.count(), args.data(), args.size() );
+	writeBatch( string() );
 }
 
 Logger::Logger( string tag )
-	: tag_( detail::buildTag< tagLength >( move( tag ) ) )
+	: name_( tag )
+	, tag_( detail::buildTag< tagLength >( move( tag ) ) )
+	, tagId_( detail::BinaryLogRegistry::instance().tag( tag_ ) )
+	, threshold_( Level::warning.level )
+{
+	// registered only once threshold_ exists, since the registry may store into it right away
+	detail::LoggerRegistry::instance().add( this, []( Logger& logger, unsigned threshold ) {
+		logger.threshold_.store( threshold, memory_order_relaxed );
+	} );
+}
+
+Logger::~Logger()
 {
+	detail::LoggerRegistry::instance().remove( this );
 }
 
 } // namespace prnet
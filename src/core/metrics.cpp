@@ -0,0 +1,88 @@
+#include <cmath>
+
+#include "3dprnet/core/metrics.hpp"
+
+using namespace std;
+
+namespace prnet {
+
+/**
+ * class HistogramSnapshot
+ */
+
+double HistogramSnapshot::mean() const
+{
+    return count > 0 ? static_cast< double >( sum ) / count : 0.0;
+}
+
+uint64_t HistogramSnapshot::percentile( double percentile ) const
+{
+    if ( count == 0 ) {
+        return 0;
+    }
+
+    // the bucket counts may not add up to count if the snapshot was taken while recording
+    uint64_t total = 0;
+    for ( auto const& bucket : buckets ) {
+        total += bucket.second;
+    }
+    auto rank = static_cast< uint64_t >( ceil( percentile / 100.0 * total ) );
+    if ( rank == 0 ) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for ( auto const& bucket : buckets ) {
+        seen += bucket.second;
+        if ( seen >= rank ) {
+            return bucket.first < max ? bucket.first : max;
+        }
+    }
+    return max;
+}
+
+
+/**
+ * class Histogram
+ */
+
+constexpr size_t Histogram::subBuckets;
+constexpr unsigned Histogram::subBucketBits;
+constexpr unsigned Histogram::maxBits;
+constexpr size_t Histogram::bucketCount;
+
+uint64_t Histogram::upperBound( size_t index )
+{
+    if ( index < subBuckets ) {
+        return index;
+    }
+    auto exponent = static_cast< unsigned >( index / subBuckets ) + subBucketBits - 1;
+    auto sub = index % subBuckets;
+    auto shift = exponent - subBucketBits;
+    return ( ( subBuckets + sub + 1 ) << shift ) - 1;
+}
+
+Histogram::Histogram()
+{
+    for ( auto& count : counts_ ) {
+        count.store( 0, memory_order_relaxed );
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot result {};
+    result.count = count_.load( memory_order_relaxed );
+    result.sum = sum_.load( memory_order_relaxed );
+    result.min = result.count > 0 ? min_.load( memory_order_relaxed ) : 0;
+    result.max = max_.load( memory_order_relaxed );
+    for ( size_t i = 0 ; i < bucketCount ; ++i ) {
+        auto count = counts_[ i ].load( memory_order_relaxed );
+        if ( count > 0 ) {
+            result.buckets.emplace_back( upperBound( i ), count );
+        }
+    }
+    return result;
+}
+
+} // namespace prnet
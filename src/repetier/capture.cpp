@@ -0,0 +1,189 @@
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+#include "3dprnet/core/binary_log.hpp"
+#include "3dprnet/repetier/capture.hpp"
+
+using namespace std;
+
+namespace prnet {
+namespace rep {
+
+namespace detail {
+
+static constexpr char captureMagic[] = "PRNETWS2";
+
+// Beast refuses websocket messages beyond 16 MiB by default, a longer payload can only be a corrupt length
+static constexpr uint64_t maxPayload = 64 * 1024 * 1024;
+
+} // namespace detail
+
+
+/**
+ * class CaptureWriter::Impl
+ */
+
+class CaptureWriter::Impl
+{
+    using Lock = lock_guard< mutex >;
+
+public:
+    explicit Impl( filesystem::path const& path )
+            : lastTime_( Clock::now() )
+    {
+        auto localPath = filesystem::native_path( path );
+        out_.open( localPath.c_str(), ios::out | ios::trunc | ios::binary );
+        if ( !out_ ) {
+            throw system_error( make_error_code( errc::io_error ), "unable to open capture " + localPath );
+        }
+        out_.write( detail::captureMagic, sizeof( detail::captureMagic ) - 1 );
+    }
+
+    uint32_t open()
+    {
+        Lock lock( mutex_ );
+        return streams_++;
+    }
+
+    void write( uint32_t stream, CaptureFrame::Direction direction, Clock::time_point time, string_view payload )
+    {
+        Lock lock( mutex_ );
+        buffer_.clear();
+        buffer_.push_back( static_cast< char >( direction ) );
+        prnet::detail::binaryVarint( buffer_, stream );
+        prnet::detail::binaryVarint( buffer_, prnet::detail::binaryZigzag(
+                chrono::duration_cast< chrono::nanoseconds >( time - lastTime_ ).count() ) );
+        prnet::detail::binaryVarint( buffer_, payload.size() );
+        out_.write( buffer_.data(), static_cast< streamsize >( buffer_.size() ) );
+        out_.write( payload.data(), static_cast< streamsize >( payload.size() ) );
+        lastTime_ = time;
+        ++frames_;
+    }
+
+    void flush()
+    {
+        Lock lock( mutex_ );
+        out_.flush();
+    }
+
+    size_t frames() const
+    {
+        Lock lock( mutex_ );
+        return frames_;
+    }
+
+private:
+    mutable mutex mutex_;
+    ofstream out_;
+    string buffer_;
+    Clock::time_point lastTime_;
+    size_t frames_ {};
+    uint32_t streams_ {};
+};
+
+
+/**
+ * class CaptureWriter
+ */
+
+CaptureWriter::CaptureWriter( filesystem::path const& path )
+        : impl_( make_unique< Impl >( path ) ) {}
+
+CaptureWriter::~CaptureWriter() = default;
+
+uint32_t CaptureWriter::open()
+{
+    return impl_->open();
+}
+
+void CaptureWriter::write( uint32_t stream, CaptureFrame::Direction direction, Clock::time_point time,
+                           string_view payload )
+{
+    impl_->write( stream, direction, time, payload );
+}
+
+void CaptureWriter::flush()
+{
+    impl_->flush();
+}
+
+size_t CaptureWriter::frames() const
+{
+    return impl_->frames();
+}
+
+
+/**
+ * class CaptureReader
+ */
+
+CaptureReader::CaptureReader( istream& in )
+        : in_( in ) {}
+
+bool CaptureReader::next( CaptureFrame& frame )
+{
+    if ( !header_ ) {
+        char magic[ sizeof( detail::captureMagic ) - 1 ];
+        if ( !in_.read( magic, sizeof( magic ) ) || string( magic, sizeof( magic ) ) != detail::captureMagic ) {
+            throw runtime_error( "corrupt capture: invalid header" );
+        }
+        header_ = true;
+    }
+
+    auto direction = in_.get();
+    if ( direction == istream::traits_type::eof() ) {
+        return false;
+    }
+    if ( direction != static_cast< int >( CaptureFrame::Direction::inbound )
+         && direction != static_cast< int >( CaptureFrame::Direction::outbound ) ) {
+        throw runtime_error( "corrupt capture: unknown direction" );
+    }
+
+    auto stream = varint();
+    if ( stream > numeric_limits< uint32_t >::max() ) {
+        throw runtime_error( "corrupt capture: invalid stream" );
+    }
+    auto delta = varint();
+    lastTime_ += static_cast< int64_t >( delta >> 1 ) ^ -static_cast< int64_t >( delta & 1 );
+    auto length = varint();
+    if ( length > detail::maxPayload ) {
+        throw runtime_error( "corrupt capture: invalid payload length" );
+    }
+
+    frame.direction = static_cast< CaptureFrame::Direction >( direction );
+    frame.stream = static_cast< uint32_t >( stream );
+    frame.time = chrono::nanoseconds( lastTime_ );
+    frame.payload.resize( static_cast< size_t >( length ) );
+    if ( length > 0 && !in_.read( &frame.payload[ 0 ], static_cast< streamsize >( length ) ) ) {
+        throw runtime_error( "truncated capture" );
+    }
+    return true;
+}
+
+uint64_t CaptureReader::varint()
+{
+    uint64_t result = 0;
+    for ( int shift = 0 ; shift < 64 ; shift += 7 ) {
+        auto value = byte();
+        result |= static_cast< uint64_t >( value & 0x7f ) << shift;
+        if ( ( value & 0x80 ) == 0 ) {
+            return result;
+        }
+    }
+    throw runtime_error( "corrupt capture: invalid varint" );
+}
+
+uint8_t CaptureReader::byte()
+{
+    auto value = in_.get();
+    if ( value == istream::traits_type::eof() ) {
+        throw runtime_error( "truncated capture" );
+    }
+    return static_cast< uint8_t >( value );
+}
+
+} // namespace rep
+} // namespace prnet
@@ -1,12 +1,15 @@
 #include <cassert>
 #include <algorithm>
+#include <chrono>
+#include <deque>
 #include <stdexcept>
 #include <unordered_map>
 
 #include <boost/asio/buffers_iterator.hpp>
-#include <boost/asio/connect.hpp>
+#include <boost/asio/bind_executor.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/spawn.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/beast/core/buffers_to_string.hpp>
@@ -15,11 +18,18 @@
 #include <boost/beast/websocket/stream.hpp>
 #include <nlohmann/json.hpp>
 
+#include "3dprnet/core/allocations.hpp"
 #include "3dprnet/core/error.hpp"
 #include "3dprnet/core/logging.hpp"
 #include "3dprnet/core/optional.hpp"
+#include "3dprnet/repetier/capture.hpp"
 #include "3dprnet/repetier/client.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/resolver_cache.hpp"
 #include "3dprnet/repetier/types.hpp"
+#include "repetier/event_table.hpp"
+#include "repetier/happy_eyeballs.hpp"
+#include "repetier/round_trip.hpp"
 
 using namespace std;
 using namespace nlohmann;
@@ -48,37 +58,118 @@ struct Client::Pending
     size_t callbackId;
     Client::CallbackHandler handler;
     asio::steady_timer timer;
+    chrono::steady_clock::time_point sent;
+    detail::RoundTripEstimator* roundTrip {};
+    Metrics::Action* action {};
+    string const* name {};
+    bool written {};
+    optional< json > response;
 };
 
 class Client::Impl
+        : public enable_shared_from_this< Client::Impl >
 {
+    using Clock = chrono::steady_clock;
+
+    // the number of event types nobody subscribed to that are counted one by one, see counted_route()
+    static constexpr size_t maxCountedTypes = 256;
+
+    struct Route
+    {
+        deque< EventHandler > handlers;
+        atomic< uint64_t >* count {};
+        atomic< uint64_t >* allocations {};
+        Metrics::Trace* trace {};
+    };
+
 public:
-    Impl( asio::io_context& context, ErrorHandler&& errorHandler )
-            : context_( context )
+    Impl( Strand&& strand, ErrorHandler&& errorHandler )
+            : context_( strand.get_inner_executor().context() )
+            , strand_( move( strand ) )
             , errorHandler_( move( errorHandler ) )
-            , stream_( context_ ) {}
+            , stream_( context_ )
+            , pingTimer_( context_ )
+    {
+        // pongs arrive while reading, on the strand of the reading coroutine
+        stream_.control_callback( [this]( websocket::frame_type kind, boost::beast::string_view ) {
+            if ( kind == websocket::frame_type::pong ) {
+                this->handle_pong();
+            }
+        } );
+    }
 
     void connect( Endpoint&& endpoint, SuccessHandler&& handler )
     {
         assert( !connected_ );
 
-        logger.debug( "before spawn" );
+        logger.info( "connecting to ", endpoint.host(), ":", endpoint.port() );
 
-        checked_spawn( [this, endpoint = move( endpoint ), handler = move( handler )]( auto yield ) {
-            logger.info( "connecting to ", endpoint.host(), ":", endpoint.port() );
+        auto host = endpoint.host();
+        auto port = endpoint.port();
+        resolver_->resolve( context_, host, port, [self = this->shared_from_this(), endpoint = move( endpoint ),
+                                                   handler = move( handler )]( error_code ec, auto const& endpoints ) mutable {
+            asio::post( self->strand_, [self, endpoint = move( endpoint ), handler = move( handler ), ec,
+                                        endpoints]() mutable {
+                self->handle_resolve( move( endpoint ), move( handler ), ec, endpoints );
+            } );
+        } );
+    }
+
+    void handle_resolve( Endpoint&& endpoint, SuccessHandler&& handler, error_code ec,
+                         ResolverCache::Endpoints const& endpoints )
+    {
+        if ( shutdown_ ) {
+            return;
+        }
+        if ( ec ) {
+            handle_error( ec );
+            return;
+        }
 
-            tcp::resolver resolver( context_ );
-            auto resolved = resolver.async_resolve( endpoint.host(), endpoint.port(), yield );
+        connecting_ = detail::HappyEyeballs::connect(
+                context_, endpoints, resolver_->attemptDelay(),
+                [self = this->shared_from_this(), endpoint = move( endpoint ), handler = move( handler )](
+                        error_code ec, tcp::socket socket ) mutable {
+                    // the socket is moved into the handler, which must be copyable for the post
+                    auto shared = make_shared< tcp::socket >( move( socket ) );
+                    asio::post( self->strand_, [self, endpoint = move( endpoint ), handler = move( handler ), ec,
+                                                shared]() mutable {
+                        self->handle_connect( move( endpoint ), move( handler ), ec, move( *shared ) );
+                    } );
+                } );
+    }
+
+    void handle_connect( Endpoint&& endpoint, SuccessHandler&& handler, error_code ec, tcp::socket&& socket )
+    {
+        connecting_ = nullptr;
+        if ( shutdown_ ) {
+            return;
+        }
+        if ( ec ) {
+            // the cached endpoints may be stale
+            resolver_->invalidate( endpoint.host(), endpoint.port() );
+            handle_error( ec );
+            return;
+        }
 
-            asio::async_connect( stream_.next_layer(), resolved, yield );
+        stream_.next_layer() = move( socket );
+        checked_spawn( [this, endpoint = move( endpoint ), handler = move( handler )]( auto yield ) {
             stream_.async_handshake( endpoint.host(), "/socket", yield );
 
-            logger.debug( "connection successfully established" );
+            // the owner of the handler may be gone if the client was destroyed during the handshake
+            if ( shutdown_ ) {
+                return;
+            }
+
+            AllocationScope scope( AllocationTag::client );
+            PRNET_LOG_DEBUG( logger, "connection successfully established" );
 
             connected_ = true;
+            lastReceived_ = Clock::now();
             handler();
 
             this->receive();
+            this->schedule_ping();
         } );
     }
 
@@ -89,16 +180,65 @@ public:
 
         checked_spawn( [this, &request, handler = move( handler )]( auto yield ) mutable {
             auto callbackId = ++lastCallbackId_;
-            request[ "callback_id" ] = callbackId;
-            auto message = request.dump();
-
-            logger.debug( ">>> ", message );
+            string message;
+            // metrics() may replace the metrics during the write, the counters of this request stay where they began
+            auto metrics = metrics_;
+            pair< string const, Metrics::Action* >* action {};
+            {
+                // scopes must not span a yield, other work runs on this thread while the coroutine is suspended
+                AllocationScope scope( AllocationTag::client );
+                auto allocations = threadAllocations();
+
+                request[ "callback_id" ] = callbackId;
+                message = request.dump();
+                action = metrics_ ? &this->action( request.value( "action", "" ) ) : nullptr;
+
+                PRNET_LOG_DEBUG( logger, ">>> ", message );
+
+                if ( capture_ ) {
+                    this->capture_frame( request, message );
+                }
+
+                // the response may be read before the write completes, so it must be pending already
+                auto& roundTrip = this->round_trip( request );
+                pending_ = Pending( callbackId, move( handler ),
+                                    asio::steady_timer( context_, roundTrip.timeout( timeouts_ ) ) );
+                pending_->sent = Clock::now();
+                pending_->roundTrip = &roundTrip;
+                if ( action ) {
+                    pending_->action = action->second;
+                    pending_->name = &action->first;
+                }
+                pending_->timer.async_wait( asio::bind_executor( strand_, [self = this->shared_from_this(), callbackId]( error_code ec ) {
+                    self->handle_timeout( callbackId, ec );
+                } ) );
+
+                allocations = threadAllocations() - allocations;
+                sendAllocations_ += allocations;
+                if ( allocationTracking && action ) {
+                    action->second->allocations.fetch_add( allocations, memory_order_relaxed );
+                }
+            }
 
+            auto actionMetrics = action ? action->second : nullptr;
             stream_.async_write( asio::buffer( message ), yield );
-            pending_ = Pending( callbackId, move( handler ), { context_, chrono::seconds( 5 ) } ); // TODO
-            pending_->timer.async_wait( [this, callbackId]( error_code ec ) {
-                this->handle_timeout( callbackId, ec );
-            } );
+            if ( metrics ) {
+                metrics->bytesOut.fetch_add( message.size(), memory_order_relaxed );
+                metrics->framesOut.fetch_add( 1, memory_order_relaxed );
+            }
+            if ( actionMetrics ) {
+                actionMetrics->requests.fetch_add( 1, memory_order_relaxed );
+            }
+
+            if ( shutdown_ || pending_ == nullopt || pending_->callbackId != callbackId ) {
+                return;
+            }
+            AllocationScope scope( AllocationTag::client );
+            pending_->written = true;
+            if ( pending_->response != nullopt ) {
+                auto data = move( *pending_->response );
+                this->complete_callback( callbackId, data );
+            }
         } );
     }
 
@@ -113,25 +253,109 @@ public:
             stream_.next_layer().close();
             pending_ = nullopt;
             connected_ = false;
+            pingTimer_.cancel();
         } );
     }
 
     void subscribe( string&& event, EventHandler&& handler )
     {
-        subscriptions_.emplace( move( event ), move( handler ) );
+        route( event ).handlers.push_back( move( handler ) );
+    }
+
+    void resolver( shared_ptr< ResolverCache >&& resolver )
+    {
+        resolver_ = move( resolver );
+    }
+
+    void metrics( shared_ptr< Metrics >&& metrics )
+    {
+        metrics_ = move( metrics );
+        actions_.clear();
+        if ( pending_ != nullopt ) {
+            // both point into actions_
+            pending_->action = nullptr;
+            pending_->name = nullptr;
+        }
+        for ( auto& route : routes_ ) {
+            route.count = nullptr;
+            route.allocations = nullptr;
+            route.trace = nullptr;
+        }
+        otherEvents_.count = nullptr;
+        otherEvents_.allocations = nullptr;
+    }
+
+    void slow_handlers( chrono::nanoseconds threshold )
+    {
+        slowThreshold_ = threshold;
+    }
+
+    void tracing( Tracing&& tracing )
+    {
+        tracing_ = move( tracing );
+        traced_ = 0;
+        for ( auto& route : routes_ ) {
+            route.trace = nullptr;
+        }
+    }
+
+    void capture( shared_ptr< CaptureWriter >&& writer )
+    {
+        capture_ = move( writer );
+        if ( capture_ ) {
+            captureStream_ = capture_->open();
+        }
+    }
+
+    void replay( string const& message )
+    {
+        AllocationScope scope( AllocationTag::client );
+        replaying_ = true;
+        try {
+            handle_frame( message, Clock::now() );
+        } catch ( json::exception const& e ) {
+            logger.warning( "protocol violation from server: ", e.what() );
+        }
+    }
+
+    void timeouts( Timeouts&& timeouts )
+    {
+        timeouts_ = move( timeouts );
+        if ( connected_ ) {
+            schedule_ping();
+        }
+    }
+
+    void shutdown()
+    {
+        // handlers are not reset since this may be called from within one of them, shutdown_ silences them instead
+        shutdown_ = true;
+        connected_ = false;
+        pending_ = nullopt;
+
+        if ( connecting_ ) {
+            connecting_->cancel();
+        }
+
+        boost::system::error_code ec;
+        pingTimer_.cancel( ec );
+        stream_.next_layer().close( ec );
     }
 
 private:
     template< typename Func >
     void checked_spawn( Func&& func )
     {
-        asio::spawn( context_, [this, func = move( func )]( auto yield ) mutable {
+        AllocationScope scope( AllocationTag::client );
+
+        // the coroutine keeps the implementation alive until it returns, even if the client is destroyed meanwhile
+        asio::spawn( strand_, [self = this->shared_from_this(), func = move( func )]( auto yield ) mutable {
             try {
                 func( yield );
             } catch ( system_error const& e ) {
-                this->handle_error( e.code() );
+                self->handle_error( e.code() );
             } catch ( boost::beast::system_error const& e ) {
-                this->handle_error( e.code() );
+                self->handle_error( e.code() );
             } catch ( json::exception const& e ) {
                 logger.warning( "protocol violation from server: ", e.what() );
             }
@@ -143,56 +367,267 @@ private:
         checked_spawn( [this]( auto yield ) {
             boost::beast::multi_buffer buffer;
             stream_.async_read( buffer, yield );
+            auto read = Clock::now();
+            AllocationScope scope( AllocationTag::client );
+            lastReceived_ = read;
 
             // for some reason the message must be one contiguous sequence for json::parse
             auto message = boost::beast::buffers_to_string( buffer.data() );
+            if ( capture_ ) {
+                capture_->write( captureStream_, CaptureFrame::Direction::inbound, read, message );
+            }
 
-            logger.debug( "<<< ", message );
-
-            this->handle_message( json::parse( message ) );
+            this->handle_frame( message, read );
+            if ( shutdown_ ) {
+                return;
+            }
             this->receive();
         } );
     }
 
-    void handle_message( json const& message )
+    void capture_frame( json const& request, string const& message )
+    {
+        auto now = Clock::now();
+        if ( request.value( "action", "" ) != "login" ) {
+            capture_->write( captureStream_, CaptureFrame::Direction::outbound, now, message );
+            return;
+        }
+
+        // the apikey must not end up in a capture that is passed around
+        auto redacted = request;
+        redacted[ "data" ][ "apikey" ] = "";
+        capture_->write( captureStream_, CaptureFrame::Direction::outbound, now, redacted.dump() );
+    }
+
+    pair< string const, Metrics::Action* >& action( string const& name )
+    {
+        auto it = actions_.find( name );
+        if ( it == actions_.end() ) {
+            it = actions_.emplace( name, &metrics_->action( name ) ).first;
+        }
+        return *it;
+    }
+
+    /**
+     * The route of an event type, interned on first use. Routes and their handlers are kept in deques, so that a
+     * handler may subscribe while it is being invoked.
+     */
+    Route& route( string const& type )
+    {
+        auto id = eventTypes_.intern( type );
+        if ( id == routes_.size() ) {
+            routes_.emplace_back();
+        }
+        return routes_[ id ];
+    }
+
+    /**
+     * The route that counts the events of a type nobody subscribed to. A server may send any number of types, only the
+     * first maxCountedTypes of them are interned, the events of the rest are counted together under "other".
+     */
+    Route& counted_route( string const& type )
+    {
+        if ( countedTypes_ == maxCountedTypes ) {
+            return otherEvents_;
+        }
+        ++countedTypes_;
+        return this->route( type );
+    }
+
+    void count_event( Route& route, string const& type )
+    {
+        if ( route.count == nullptr ) {
+            route.count = &metrics_->event( type );
+        }
+        route.count->fetch_add( 1, memory_order_relaxed );
+    }
+
+    void count_allocations( Route& route, string const& type, uint64_t allocations )
     {
+        if ( route.allocations == nullptr ) {
+            route.allocations = &metrics_->eventAllocations( type );
+        }
+        route.allocations->fetch_add( allocations, memory_order_relaxed );
+    }
+
+    void trace_event( Route& route, string const& type, string const& printer, EventTrace::Clock::time_point read,
+                      EventTrace::Clock::time_point parsed, EventTrace::Clock::time_point dispatched,
+                      EventTrace::Clock::time_point returned )
+    {
+        if ( metrics_ ) {
+            if ( route.trace == nullptr ) {
+                route.trace = &metrics_->trace( type );
+            }
+            route.trace->parse.record( parsed - read );
+            route.trace->queue.record( dispatched - parsed );
+            route.trace->handler.record( returned - dispatched );
+            route.trace->total.record( returned - read );
+        }
+
+        if ( tracing_.sampleEvery > 0 && tracing_.handler && ++traced_ % tracing_.sampleEvery == 0 ) {
+            tracing_.handler( { type, printer, read, parsed, dispatched, returned } );
+        }
+    }
+
+    /**
+     * Returns whether a handler that started at start was slow, and counts it if so.
+     */
+    bool slow_handler( Clock::time_point start )
+    {
+        if ( slowThreshold_.count() <= 0 || Clock::now() - start <= slowThreshold_ ) {
+            return false;
+        }
+        if ( metrics_ ) {
+            metrics_->slowHandlers.fetch_add( 1, memory_order_relaxed );
+        }
+        return true;
+    }
+
+    /**
+     * Everything from the read of a frame on, shared by receive() and replay().
+     */
+    void handle_frame( string const& message, Clock::time_point read )
+    {
+        if ( metrics_ ) {
+            metrics_->bytesIn.fetch_add( message.size(), memory_order_relaxed );
+            metrics_->framesIn.fetch_add( 1, memory_order_relaxed );
+        }
+
+        PRNET_LOG_DEBUG( logger, "<<< ", message );
+
+        if ( shutdown_ ) {
+            return;
+        }
+        auto allocations = threadAllocations();
+        auto parsed = json::parse( message );
+        parseAllocations_ = threadAllocations() - allocations;
+        frameBytes_ = message.size();
+        this->handle_message( parsed, read, Clock::now() );
+    }
+
+    void handle_message( json const& message, Clock::time_point read, Clock::time_point parsed )
+    {
+        dispatch( message, read, parsed );
+        if ( metrics_ ) {
+            metrics_->dispatch.record( Clock::now() - parsed );
+        }
+    }
+
+    void dispatch( json const& message, Clock::time_point read, Clock::time_point parsed )
+    {
+        auto parse = parsed - read;
         long callbackId = message.at( "callback_id" );
         auto const& data = message.at( "data" );
         if ( callbackId >= 0 ) {
+            if ( metrics_ && metrics_->resuming.load( memory_order_relaxed ) ) {
+                metrics_->resumeBytes.fetch_add( frameBytes_, memory_order_relaxed );
+            }
+            Metrics::Action* action {};
+            if ( pending_ != nullopt && pending_->callbackId == static_cast< size_t >( callbackId ) ) {
+                pending_->roundTrip->sample( read - pending_->sent );
+                if ( pending_->action != nullptr ) {
+                    action = pending_->action;
+                    action->roundTrip.record( read - pending_->sent );
+                    action->parse.record( parse );
+                }
+            }
+            // a request sent by the handler counts for its own action
+            auto allocations = threadAllocations() - sendAllocations_;
             handle_callback( static_cast< size_t >( callbackId ), data );
+            if ( allocationTracking && action ) {
+                action->allocations.fetch_add( parseAllocations_ + threadAllocations() - sendAllocations_ - allocations,
+                                               memory_order_relaxed );
+            }
         } else if ( message.value( "eventList", false ) ) {
-            for_each( data.begin(), data.end(), [this]( auto const& event ) { this->handle_event( event ); } );
+            if ( metrics_ ) {
+                metrics_->eventParse.record( parse );
+            }
+            // every event carries its share of parsing the frame
+            parseAllocations_ /= max< size_t >( data.size(), 1 );
+            for_each( data.begin(), data.end(), [this, read, parsed]( auto const& event ) {
+                this->handle_event( event, read, parsed );
+            } );
         }
     }
 
     void handle_callback( size_t callbackId, json const& data )
     {
         if ( pending_ == nullopt ) {
-            logger.error( "received callback ", callbackId, " although no pending request exists" );
+            // a replayed session contains the responses, but not the requests
+            if ( !replaying_ ) {
+                logger.error( "received callback ", callbackId, " although no pending request exists" );
+            }
             return;
         }
         if ( pending_->callbackId != callbackId ) {
             logger.error( "received callback ", callbackId, " although waiting for callback ", pending_->callbackId );
             return;
         }
+        if ( !pending_->written ) {
+            // the handler may send the next request, which must wait for the write of this one to complete
+            pending_->response = data;
+            return;
+        }
+        complete_callback( callbackId, data );
+    }
 
+    void complete_callback( size_t callbackId, json const& data )
+    {
         auto handler = move( pending_->handler );
+        auto name = pending_->name;
         pending_ = nullopt;
+
+        auto start = Clock::now();
         handler( data );
+        if ( slow_handler( start ) ) {
+            logger.warning( "handler of response to ", name ? *name : "callback " + std::to_string( callbackId ),
+                            " blocked the event loop for ", chrono::duration_cast< chrono::milliseconds >(
+                                    Clock::now() - start ).count(), "ms" );
+        }
     }
 
-    void handle_event( json const& event )
+    void handle_event( json const& event, Clock::time_point read, Clock::time_point parsed )
     {
-        string eventType = event.at( "event" );
-        auto subscription = subscriptions_.find( eventType );
-        if ( subscription != subscriptions_.end() ) {
-            subscription->second( event.value( "printer", "" ), event.at( "data" ) );
+        if ( shutdown_ ) {
+            return;
+        }
+
+        auto allocations = threadAllocations();
+        // the type is matched in place, only types nobody subscribed to are interned here to be counted
+        auto const& eventType = event.at( "event" ).get_ref< string const& >();
+        auto id = eventTypes_.find( eventType );
+        if ( id == detail::EventTable::npos && !metrics_ ) {
+            return;
+        }
+        auto& route = id != detail::EventTable::npos ? routes_[ id ] : this->counted_route( eventType );
+        auto const& countedType = &route == &otherEvents_ ? otherEventType_ : eventType;
+        if ( metrics_ ) {
+            count_event( route, countedType );
+        }
+        if ( !route.handlers.empty() ) {
+            auto printer = event.value( "printer", "" );
+            auto const& data = event.at( "data" );
+            auto start = Clock::now();
+            for ( size_t i = 0 ; i < route.handlers.size() ; ++i ) {
+                route.handlers[ i ]( printer, data );
+            }
+            if ( tracing_.enabled ) {
+                this->trace_event( route, eventType, printer, read, parsed, start, Clock::now() );
+            }
+            if ( slow_handler( start ) ) {
+                logger.warning( "handlers of event ", eventType, " for printer \"", printer,
+                                "\" blocked the event loop for ", chrono::duration_cast< chrono::milliseconds >(
+                                        Clock::now() - start ).count(), "ms" );
+            }
+        }
+        if ( allocationTracking && metrics_ ) {
+            count_allocations( route, countedType, parseAllocations_ + threadAllocations() - allocations );
         }
     }
 
     void handle_error( error_code ec )
     {
-        if ( ec != make_error_code( asio::error::operation_aborted ) ) {
+        if ( !shutdown_ && ec != make_error_code( asio::error::operation_aborted ) ) {
             logger.error( "error communicating with server: ", ec.message() );
 
             connected_ = false;
@@ -200,17 +635,110 @@ private:
         }
     }
 
+    detail::RoundTripEstimator& round_trip( json const& request )
+    {
+        static string const none;
+        auto it = request.find( "action" );
+        auto const& name = it != request.end() && it->is_string() ? it->get_ref< string const& >() : none;
+        auto found = roundTrips_.find( name );
+        if ( found == roundTrips_.end() ) {
+            found = roundTrips_.emplace( name, detail::RoundTripEstimator() ).first;
+        }
+        return found->second;
+    }
+
+    /**
+     * Waits until nothing was received for the ping interval, or for the pong while a ping is outstanding.
+     */
+    void schedule_ping()
+    {
+        if ( shutdown_ || !connected_ || timeouts_.ping.count() <= 0 ) {
+            pingTimer_.cancel();
+            return;
+        }
+
+        pingTimer_.expires_at( pingSent_ != Clock::time_point()
+                               ? pingSent_ + pingRoundTrip_.timeout( timeouts_ )
+                               : lastReceived_ + timeouts_.ping );
+        pingTimer_.async_wait( asio::bind_executor( strand_, [self = this->shared_from_this()]( error_code ec ) {
+            if ( !ec ) {
+                self->handle_ping_timer();
+            }
+        } ) );
+    }
+
+    void handle_ping_timer()
+    {
+        AllocationScope scope( AllocationTag::client );
+        if ( shutdown_ || !connected_ ) {
+            return;
+        }
+
+        auto now = Clock::now();
+        if ( pingSent_ == Clock::time_point() ) {
+            if ( now - lastReceived_ >= timeouts_.ping ) {
+                PRNET_LOG_DEBUG( logger, "sending ping after ", chrono::duration_cast< chrono::milliseconds >(
+                        now - lastReceived_ ).count(), "ms of silence" );
+                pingSent_ = now;
+                // a failed ping fails the read as well, which reports the error
+                stream_.async_ping( {}, asio::bind_executor( strand_, [self = this->shared_from_this()]( error_code ) {} ) );
+            }
+        } else if ( lastReceived_ > pingSent_ ) {
+            // any frame proves the connection alive, the late pong is not taken as a sample
+            pingSent_ = {};
+        } else {
+            logger.error( "no response to ping within ", chrono::duration_cast< chrono::milliseconds >(
+                    now - pingSent_ ).count(), "ms, considering the connection dead" );
+            if ( metrics_ ) {
+                metrics_->pingTimeouts.fetch_add( 1, memory_order_relaxed );
+            }
+            // aborts the read, which would report the error once more when the peer finally gives up
+            boost::system::error_code ec;
+            stream_.next_layer().close( ec );
+            pending_ = nullopt;
+            connected_ = false;
+            errorHandler_( make_error_code( prnet_errc::timeout ) );
+            return;
+        }
+        schedule_ping();
+    }
+
+    void handle_pong()
+    {
+        auto now = Clock::now();
+        lastReceived_ = now;
+        if ( pingSent_ == Clock::time_point() ) {
+            return;
+        }
+
+        pingRoundTrip_.sample( now - pingSent_ );
+        if ( metrics_ ) {
+            metrics_->pingRoundTrip.record( now - pingSent_ );
+        }
+        pingSent_ = {};
+        schedule_ping();
+    }
+
     void handle_timeout( size_t callbackId, error_code ec )
     {
-        if ( ec == make_error_code( asio::error::operation_aborted ) ) {
+        AllocationScope scope( AllocationTag::client );
+        if ( shutdown_ || ec == make_error_code( asio::error::operation_aborted ) ) {
             return;
         }
 
         if ( ec ) {
             logger.error( "error waiting for callback ", callbackId, ": ", ec.message() );
         } else {
-            logger.error( "timeout waiting for callback ", callbackId );
+            logger.error( "timeout waiting for callback ", callbackId, " after ",
+                          pending_ != nullopt ? chrono::duration_cast< chrono::milliseconds >(
+                                  Clock::now() - pending_->sent ).count() : 0, "ms" );
             ec = make_error_code( prnet_errc::timeout );
+            if ( metrics_ ) {
+                metrics_->timeouts.fetch_add( 1, memory_order_relaxed );
+                if ( pending_ != nullopt && pending_->action != nullptr ) {
+                    pending_->action->timeouts.fetch_add( 1, memory_order_relaxed );
+                }
+            }
         }
 
         pending_ = nullopt;
@@ -218,18 +746,54 @@ private:
     }
 
     asio::io_context& context_;
+    Strand strand_;
     ErrorHandler errorHandler_;
     boost::beast::websocket::stream< asio::ip::tcp::socket > stream_;
+    shared_ptr< ResolverCache > resolver_ { make_shared< ResolverCache >() };
+    shared_ptr< detail::HappyEyeballs > connecting_;
     bool connected_ {};
+    bool shutdown_ {};
     optional< Pending > pending_;
-    unordered_map< string, EventHandler > subscriptions_;
+    detail::EventTable eventTypes_;
+    deque< Route > routes_;
+    size_t countedTypes_ {};
+    Route otherEvents_;
+    string const otherEventType_ { "other" };
     size_t lastCallbackId_ {};
+    shared_ptr< Metrics > metrics_;
+    unordered_map< string, Metrics::Action* > actions_;
+    uint64_t parseAllocations_ {};
+    uint64_t sendAllocations_ {};
+    Clock::duration slowThreshold_ {};
+    Tracing tracing_ {};
+    size_t traced_ {};
+    shared_ptr< CaptureWriter > capture_;
+    uint32_t captureStream_ {};
+    bool replaying_ {};
+    size_t frameBytes_ {};
+    Timeouts timeouts_ { defaultTimeouts() };
+    unordered_map< string, detail::RoundTripEstimator > roundTrips_;
+    detail::RoundTripEstimator pingRoundTrip_;
+    asio::steady_timer pingTimer_;
+    Clock::time_point lastReceived_;
+    Clock::time_point pingSent_;
 };
 
+Timeouts Client::defaultTimeouts()
+{
+    return {};
+}
+
 Client::Client( asio::io_context& context, ErrorHandler handler )
-        : impl_( make_unique< Impl >( context, move( handler ) ) ) {}
+        : Client( Strand( context.get_executor() ), move( handler ) ) {}
+
+Client::Client( Strand strand, ErrorHandler handler )
+        : impl_( make_shared< Impl >( move( strand ), move( handler ) ) ) {}
 
-Client::~Client() = default;
+Client::~Client()
+{
+    impl_->shutdown();
+}
 
 void Client::connect( Endpoint endpoint, SuccessHandler handler )
 {
@@ -251,5 +815,40 @@ void Client::subscribe( string event, EventHandler handler )
     impl_->subscribe( move( event ), move( handler ) );
 }
 
+void Client::resolver( shared_ptr< ResolverCache > resolver )
+{
+    impl_->resolver( move( resolver ) );
+}
+
+void Client::metrics( shared_ptr< Metrics > metrics )
+{
+    impl_->metrics( move( metrics ) );
+}
+
+void Client::slow_handlers( chrono::nanoseconds threshold )
+{
+    impl_->slow_handlers( threshold );
+}
+
+void Client::tracing( Tracing tracing )
+{
+    impl_->tracing( move( tracing ) );
+}
+
+void Client::timeouts( Timeouts timeouts )
+{
+    impl_->timeouts( move( timeouts ) );
+}
+
+void Client::capture( shared_ptr< CaptureWriter > writer )
+{
+    impl_->capture( move( writer ) );
+}
+
+void Client::replay( string const& message )
+{
+    impl_->replay( message );
+}
+
 } // namespace rep
 } // namespace prnet
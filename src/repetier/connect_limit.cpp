@@ -0,0 +1,105 @@
+#include <deque>
+#include <mutex>
+#include <utility>
+
+#include "3dprnet/repetier/connect_limit.hpp"
+
+using namespace std;
+
+namespace prnet {
+namespace rep {
+
+/**
+ * class ConnectLimit::Impl
+ */
+
+class ConnectLimit::Impl
+{
+    using Lock = lock_guard< mutex >;
+
+public:
+    explicit Impl( size_t concurrent )
+            : concurrent_( concurrent > 0 ? concurrent : 1 ) {}
+
+    void acquire( Handler&& handler )
+    {
+        {
+            Lock lock( mutex_ );
+            if ( active_ == concurrent_ ) {
+                waiting_.push_back( move( handler ) );
+                return;
+            }
+            ++active_;
+        }
+        handler();
+    }
+
+    void release()
+    {
+        Handler next;
+        {
+            Lock lock( mutex_ );
+            if ( waiting_.empty() ) {
+                if ( active_ > 0 ) {
+                    --active_;
+                }
+                return;
+            }
+            // the slot is passed on directly
+            next = move( waiting_.front() );
+            waiting_.pop_front();
+        }
+        next();
+    }
+
+    size_t active() const
+    {
+        Lock lock( mutex_ );
+        return active_;
+    }
+
+    size_t waiting() const
+    {
+        Lock lock( mutex_ );
+        return waiting_.size();
+    }
+
+private:
+    size_t concurrent_;
+    size_t active_ {};
+    deque< Handler > waiting_;
+    mutable mutex mutex_;
+};
+
+
+/**
+ * class ConnectLimit
+ */
+
+ConnectLimit::ConnectLimit( size_t concurrent )
+        : impl_( make_unique< Impl >( concurrent ) ) {}
+
+ConnectLimit::~ConnectLimit() = default;
+
+void ConnectLimit::acquire( Handler handler )
+{
+    impl_->acquire( move( handler ) );
+}
+
+void ConnectLimit::release()
+{
+    impl_->release();
+}
+
+size_t ConnectLimit::active() const
+{
+    return impl_->active();
+}
+
+size_t ConnectLimit::waiting() const
+{
+    return impl_->waiting();
+}
+
+} // namespace rep
+} // namespace prnet
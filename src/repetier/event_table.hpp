@@ -0,0 +1,108 @@
+#ifndef LIB3DPRNET_REPETIER_EVENT_TABLE_HPP
+#define LIB3DPRNET_REPETIER_EVENT_TABLE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "3dprnet/core/string_view.hpp"
+
+namespace prnet {
+namespace rep {
+namespace detail {
+
+/**
+ * class EventTable
+ *
+ * Interns event types into consecutive ids. Looking up the id of a type neither allocates nor copies it: the ids are
+ * kept in an open addressing table of FNV-1a hashes that is at most half full. Private to the library and the
+ * benchmarks.
+ */
+
+class EventTable
+{
+    struct Slot
+    {
+        std::uint64_t hash;
+        std::size_t id;
+    };
+
+public:
+    static constexpr std::size_t npos = static_cast< std::size_t >( -1 );
+
+    std::size_t intern( std::string const& type )
+    {
+        auto id = find( type );
+        if ( id != npos ) {
+            return id;
+        }
+
+        id = types_.size();
+        types_.push_back( type );
+        if ( 2 * types_.size() > slots_.size() ) {
+            rehash( std::max< std::size_t >( 16, 2 * slots_.size() ) );
+        } else {
+            insert( id );
+        }
+        return id;
+    }
+
+    std::size_t find( string_view type ) const
+    {
+        if ( slots_.empty() ) {
+            return npos;
+        }
+        auto hash = hashOf( type );
+        for ( auto i = hash & ( slots_.size() - 1 ) ; ; i = ( i + 1 ) & ( slots_.size() - 1 ) ) {
+            auto const& slot = slots_[ i ];
+            if ( slot.id == npos ) {
+                return npos;
+            }
+            if ( slot.hash == hash && string_view( types_[ slot.id ] ) == type ) {
+                return slot.id;
+            }
+        }
+    }
+
+    std::string const& type( std::size_t id ) const { return types_[ id ]; }
+    std::size_t size() const { return types_.size(); }
+
+private:
+    static std::uint64_t hashOf( string_view type )
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for ( auto c : type ) {
+            hash = ( hash ^ static_cast< unsigned char >( c ) ) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    void insert( std::size_t id )
+    {
+        auto hash = hashOf( types_[ id ] );
+        auto i = hash & ( slots_.size() - 1 );
+        while ( slots_[ i ].id != npos ) {
+            i = ( i + 1 ) & ( slots_.size() - 1 );
+        }
+        slots_[ i ] = { hash, id };
+    }
+
+    void rehash( std::size_t capacity )
+    {
+        slots_.assign( capacity, { 0, npos } );
+        for ( std::size_t id = 0 ; id < types_.size() ; ++id ) {
+            insert( id );
+        }
+    }
+
+    std::vector< std::string > types_;
+    std::vector< Slot > slots_;
+};
+
+} // namespace detail
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_EVENT_TABLE_HPP
@@ -1,7 +1,9 @@
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <utility>
 
+#include "3dprnet/core/allocations.hpp"
 #include "3dprnet/core/optional.hpp"
 #include "3dprnet/repetier/frontend.hpp"
 #include "3dprnet/repetier/service.hpp"
@@ -16,6 +18,11 @@ namespace detail {
 
 using Lock = lock_guard< recursive_mutex >;
 
+inline bool changed( Printer const& a, Printer const& b )
+{
+    return a.active() != b.active() || a.name() != b.name() || a.online() != b.online() || a.job() != b.job();
+}
+
 } // namespace detail
 
 
@@ -25,25 +32,49 @@ using Lock = lock_guard< recursive_mutex >;
 
 struct Frontend::PrinterData
 {
+    Printer printer;
     std::vector< ModelGroup > modelGroups;
     std::vector< Model > models;
+    bool modelGroupsLoaded {};
+    bool modelsLoaded {};
 };
     
 class Frontend::FrontendImpl
+        : public enable_shared_from_this< FrontendImpl >
 {
 public:
     FrontendImpl( Service& service )
-            : service_( service )
+            : service_( service ) {}
+
+    void start()
     {
-        service_.on_disconnect( [this]( auto ec ) { on_disconnect_( ec ); } );
-        service_.on_printers( [this]( auto printers ) { this->handlePrinters( move( printers ) ); } );
-        service_.on_groups( [this]( auto slug, auto modelGroups ) { this->handleModelGroups( slug, move( modelGroups ) ); } );
-        service_.on_models( [this]( auto slug, auto models ) { this->handleModels( slug, move( models ) ); } );
+        // the slots are tracked so that a handler that is already running while the frontend is destroyed on another
+        // thread keeps the object alive, it will find stopped_ set and return
+        AllocationScope scope( AllocationTag::frontend );
+        weak_ptr< FrontendImpl > self( shared_from_this() );
+        service_.on_reconnect( ReconnectEvent::slot_type(
+                [this] { this->handleReconnect(); } ).track_foreign( self ) );
+        service_.on_disconnect( DisconnectEvent::slot_type(
+                [this]( auto ec ) { this->handleDisconnect( ec ); } ).track_foreign( self ) );
+        service_.on_printers( PrintersEvent::slot_type(
+                [this]( auto printers ) { this->handlePrinters( move( printers ) ); } ).track_foreign( self ) );
+        service_.on_groups( GroupsEvent::slot_type(
+                [this]( auto slug, auto modelGroups ) { this->handleModelGroups( slug, move( modelGroups ) ); } )
+                        .track_foreign( self ) );
+        service_.on_models( ModelsEvent::slot_type(
+                [this]( auto slug, auto models ) { this->handleModels( slug, move( models ) ); } ).track_foreign( self ) );
         service_.request_printers();
     }
 
+    void stop()
+    {
+        detail::Lock lock( mutex_ );
+        stopped_ = true;
+    }
+
     void requestPrinters()
     {
+        AllocationScope scope( AllocationTag::frontend );
         detail::Lock lock( mutex_ );
 
         if ( printers_ != nullopt ) {
@@ -53,6 +84,7 @@ public:
 
     void requestModelGroups( std::string const& slug )
     {
+        AllocationScope scope( AllocationTag::frontend );
         detail::Lock lock( mutex_ );
 
         auto printerData = allPrinterData_.find( slug );
@@ -63,6 +95,7 @@ public:
 
     void requestModels( std::string const& slug )
     {
+        AllocationScope scope( AllocationTag::frontend );
         detail::Lock lock( mutex_ );
 
         auto printerData = allPrinterData_.find( slug );
@@ -97,21 +130,61 @@ public:
     }
 
 private:
+    void handleReconnect()
+    {
+        AllocationScope scope( AllocationTag::frontend );
+        detail::Lock lock( mutex_ );
+        if ( stopped_ ) {
+            return;
+        }
+
+        // the first printer list is still queued. After a reconnect, the changes missed while disconnected cannot be told
+        // from the printer list, so everything is fetched again like the first time and served as it is until then
+        if ( printers_ != nullopt ) {
+            for ( auto& printerData : allPrinterData_ ) {
+                printerData.second.modelGroupsLoaded = false;
+                printerData.second.modelsLoaded = false;
+            }
+            service_.request_printers();
+        }
+        on_reconnect_();
+    }
+
+    void handleDisconnect( error_code ec )
+    {
+        AllocationScope scope( AllocationTag::frontend );
+        detail::Lock lock( mutex_ );
+        if ( stopped_ ) {
+            return;
+        }
+
+        on_disconnect_( ec );
+    }
+
     void handlePrinters( std::vector< Printer >&& printers )
     {
+        AllocationScope scope( AllocationTag::frontend );
         detail::Lock lock( mutex_ );
+        if ( stopped_ ) {
+            return;
+        }
 
+        // groups and models are only refetched for printers that are new, changed since the last list or not loaded
+        // since the last reconnect, their changes in between arrive as events while connected
         unordered_map< string, PrinterData > allPrinterData;
         for ( auto const& printer : printers ) {
             auto printerData = allPrinterData_.find( printer.slug() );
-            if ( printerData != allPrinterData_.end() ) {
-                allPrinterData.insert( move( *printerData ) );
-            } else {
-                allPrinterData.emplace( printer.slug(), PrinterData() );
+            auto refetch = printerData == allPrinterData_.end() || !printerData->second.modelGroupsLoaded
+                           || !printerData->second.modelsLoaded || detail::changed( printerData->second.printer, printer );
+            auto& data = printerData != allPrinterData_.end()
+                         ? allPrinterData.insert( move( *printerData ) ).first->second
+                         : allPrinterData[ printer.slug() ];
+            data.printer = printer;
+
+            if ( refetch ) {
+                service_.request_groups( printer.slug() );
+                service_.request_models( printer.slug() );
             }
-
-            service_.request_groups( printer.slug() );
-            service_.request_models( printer.slug() );
         }
 
         allPrinterData_ = move( allPrinterData );
@@ -121,26 +194,40 @@ private:
 
     void handleModelGroups( string const& slug, vector< ModelGroup >&& modelGroups )
     {
+        AllocationScope scope( AllocationTag::frontend );
         detail::Lock lock( mutex_ );
 
-        auto& printerData = allPrinterData_.at( slug );
-        printerData.modelGroups = move( modelGroups );
-        on_groups_( slug, printerData.modelGroups );
+        // the printer may have vanished from the list while the request was in flight
+        auto printerData = allPrinterData_.find( slug );
+        if ( stopped_ || printerData == allPrinterData_.end() ) {
+            return;
+        }
+
+        printerData->second.modelGroups = move( modelGroups );
+        printerData->second.modelGroupsLoaded = true;
+        on_groups_( slug, printerData->second.modelGroups );
     }
 
     void handleModels( string const& slug, vector< Model >&& models )
     {
+        AllocationScope scope( AllocationTag::frontend );
         detail::Lock lock( mutex_ );
 
-        auto& printerData = allPrinterData_.at( slug );
-        printerData.models = move( models );
-        on_models_( slug, printerData.models );
+        auto printerData = allPrinterData_.find( slug );
+        if ( stopped_ || printerData == allPrinterData_.end() ) {
+            return;
+        }
+
+        printerData->second.models = move( models );
+        printerData->second.modelsLoaded = true;
+        on_models_( slug, printerData->second.models );
     }
 
     Service& service_;
     optional< std::vector< Printer > > printers_;
     std::unordered_map< std::string, PrinterData > allPrinterData_;
     std::recursive_mutex mutex_;
+    bool stopped_ {};
 
     ReconnectEvent on_reconnect_;
     DisconnectEvent on_disconnect_;
@@ -151,9 +238,17 @@ private:
 
 Frontend::Frontend( boost::asio::io_context& context, Endpoint endpoint )
         : Service( context, move( endpoint ) )
-        , impl_( make_unique< FrontendImpl >( static_cast< Service& >( *this ) ) ) {}
+        , impl_( make_shared< FrontendImpl >( static_cast< Service& >( *this ) ) )
+{
+    impl_->start();
+}
 
-Frontend::~Frontend() = default;
+Frontend::~Frontend()
+{
+    // the slots of the service refer to impl_, handlers running concurrently keep it alive until they see the stop
+    shutdown();
+    impl_->stop();
+}
 
 void Frontend::requestPrinters()
 {
@@ -0,0 +1,137 @@
+#include <utility>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+
+#include "repetier/happy_eyeballs.hpp"
+
+using namespace std;
+
+namespace asio = boost::asio;
+
+using tcp = asio::ip::tcp;
+
+namespace prnet {
+namespace rep {
+namespace detail {
+
+static HappyEyeballs::Endpoints interleaveFamilies( HappyEyeballs::Endpoints const& endpoints )
+{
+    HappyEyeballs::Endpoints first;
+    HappyEyeballs::Endpoints second;
+    for ( auto const& endpoint : endpoints ) {
+        ( endpoint.protocol() == endpoints.front().protocol() ? first : second ).push_back( endpoint );
+    }
+
+    HappyEyeballs::Endpoints result;
+    for ( size_t i = 0 ; i < first.size() || i < second.size() ; ++i ) {
+        if ( i < first.size() ) {
+            result.push_back( first[ i ] );
+        }
+        if ( i < second.size() ) {
+            result.push_back( second[ i ] );
+        }
+    }
+    return result;
+}
+
+
+/**
+ * class HappyEyeballs
+ */
+
+shared_ptr< HappyEyeballs > HappyEyeballs::connect( asio::io_context& context, Endpoints const& endpoints,
+                                                    chrono::milliseconds attemptDelay, Handler handler )
+{
+    auto result = make_shared< HappyEyeballs >( context, endpoints, attemptDelay, move( handler ) );
+    asio::dispatch( result->strand_, [self = result] { self->attempt(); } );
+    return result;
+}
+
+HappyEyeballs::HappyEyeballs( asio::io_context& context, Endpoints const& endpoints,
+                              chrono::milliseconds attemptDelay, Handler&& handler )
+        : context_( context )
+        , strand_( context.get_executor() )
+        , endpoints_( interleaveFamilies( endpoints ) )
+        , attemptDelay_( attemptDelay )
+        , handler_( move( handler ) )
+        , timer_( context ) {}
+
+void HappyEyeballs::cancel()
+{
+    asio::dispatch( strand_, [self = shared_from_this()] {
+        if ( !self->done_ ) {
+            self->done_ = true;
+            self->finish( {}, self->attempts_.size() );
+        }
+    } );
+}
+
+void HappyEyeballs::attempt()
+{
+    if ( done_ ) {
+        return;
+    }
+    if ( attempts_.size() == endpoints_.size() ) {
+        if ( pending_ == 0 ) {
+            done_ = true;
+            finish( error_ ? error_ : make_error_code( asio::error::host_not_found ), attempts_.size() );
+        }
+        return;
+    }
+
+    auto index = attempts_.size();
+    attempts_.push_back( make_unique< tcp::socket >( context_ ) );
+    ++pending_;
+    attempts_.back()->async_connect( endpoints_[ index ], asio::bind_executor(
+            strand_, [self = shared_from_this(), index]( error_code ec ) {
+                self->handle_connect( index, ec );
+            } ) );
+
+    // rescheduling aborts the wait for the previous attempt
+    timer_.expires_after( attemptDelay_ );
+    timer_.async_wait( asio::bind_executor( strand_, [self = shared_from_this()]( error_code ec ) {
+        if ( !ec ) {
+            self->attempt();
+        }
+    } ) );
+}
+
+void HappyEyeballs::handle_connect( size_t index, error_code ec )
+{
+    --pending_;
+    if ( done_ ) {
+        return;
+    }
+    if ( ec ) {
+        error_ = ec;
+        attempt();
+        return;
+    }
+
+    done_ = true;
+    auto handler = move( handler_ );
+    auto socket = move( *attempts_[ index ] );
+    finish( {}, index );
+    handler( {}, move( socket ) );
+}
+
+void HappyEyeballs::finish( error_code ec, size_t index )
+{
+    timer_.cancel();
+    for ( size_t i = 0 ; i < attempts_.size() ; ++i ) {
+        if ( i != index ) {
+            boost::system::error_code ignored;
+            attempts_[ i ]->close( ignored );
+        }
+    }
+    if ( ec && handler_ ) {
+        auto handler = move( handler_ );
+        handler( ec, tcp::socket( context_ ) );
+    }
+    handler_ = nullptr;
+}
+
+} // namespace detail
+} // namespace rep
+} // namespace prnet
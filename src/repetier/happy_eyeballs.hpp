@@ -0,0 +1,72 @@
+#ifndef LIB3DPRNET_REPETIER_HAPPY_EYEBALLS_HPP
+#define LIB3DPRNET_REPETIER_HAPPY_EYEBALLS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+namespace prnet {
+namespace rep {
+namespace detail {
+
+/**
+ * class HappyEyeballs
+ *
+ * Connects to the first of the endpoints that accepts as in RFC 8305: the endpoints are interleaved by address
+ * family, starting with the family of the first one, and every attemptDelay the next attempt is started while the
+ * earlier ones are still pending, or right away when one fails. The first established connection is passed to the
+ * handler on a thread running the io_context, the other attempts are abandoned. Private to the library and the
+ * benchmarks.
+ */
+
+class HappyEyeballs
+        : public std::enable_shared_from_this< HappyEyeballs >
+{
+    using Strand = boost::asio::strand< boost::asio::io_context::executor_type >;
+
+public:
+    using Endpoints = std::vector< boost::asio::ip::tcp::endpoint >;
+    using Handler = std::function< void ( std::error_code ec, boost::asio::ip::tcp::socket socket ) >;
+
+    static std::shared_ptr< HappyEyeballs > connect( boost::asio::io_context& context, Endpoints const& endpoints,
+                                                     std::chrono::milliseconds attemptDelay, Handler handler );
+
+    HappyEyeballs( boost::asio::io_context& context, Endpoints const& endpoints,
+                   std::chrono::milliseconds attemptDelay, Handler&& handler );
+    HappyEyeballs( HappyEyeballs const& ) = delete;
+
+    /**
+     * Abandons all attempts, the handler is not invoked anymore.
+     */
+    void cancel();
+
+private:
+    void attempt();
+    void handle_connect( std::size_t index, std::error_code ec );
+    void finish( std::error_code ec, std::size_t index );
+
+    boost::asio::io_context& context_;
+    Strand strand_;
+    Endpoints endpoints_;
+    std::chrono::milliseconds attemptDelay_;
+    Handler handler_;
+    boost::asio::steady_timer timer_;
+    std::vector< std::unique_ptr< boost::asio::ip::tcp::socket > > attempts_;
+    std::size_t pending_ {};
+    std::error_code error_;
+    bool done_ {};
+};
+
+} // namespace detail
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_HAPPY_EYEBALLS_HPP
@@ -0,0 +1,107 @@
+#include "3dprnet/repetier/metrics.hpp"
+
+using namespace std;
+
+namespace prnet {
+namespace rep {
+
+/**
+ * class Metrics
+ */
+
+Metrics::Metrics() = default;
+
+Metrics::~Metrics() = default;
+
+Metrics::Action& Metrics::action( string const& name )
+{
+    lock_guard< mutex > lock( mutex_ );
+    auto& result = actions_[ name ];
+    if ( !result ) {
+        result = make_unique< Action >();
+    }
+    return *result;
+}
+
+atomic< uint64_t >& Metrics::event( string const& type )
+{
+    lock_guard< mutex > lock( mutex_ );
+    auto& result = events_[ type ];
+    if ( !result ) {
+        result = make_unique< atomic< uint64_t > >( 0 );
+    }
+    return *result;
+}
+
+atomic< uint64_t >& Metrics::eventAllocations( string const& type )
+{
+    lock_guard< mutex > lock( mutex_ );
+    auto& result = eventAllocations_[ type ];
+    if ( !result ) {
+        result = make_unique< atomic< uint64_t > >( 0 );
+    }
+    return *result;
+}
+
+Metrics::Trace& Metrics::trace( string const& type )
+{
+    lock_guard< mutex > lock( mutex_ );
+    auto& result = traces_[ type ];
+    if ( !result ) {
+        result = make_unique< Trace >();
+    }
+    return *result;
+}
+
+Metrics::Snapshot Metrics::snapshot() const
+{
+    Snapshot result {};
+    result.connected = connected.load( memory_order_relaxed );
+    result.queueDepth = queueDepth.load( memory_order_relaxed );
+    result.uploadBytes = uploadBytes.load( memory_order_relaxed );
+    result.bytesIn = bytesIn.load( memory_order_relaxed );
+    result.bytesOut = bytesOut.load( memory_order_relaxed );
+    result.framesIn = framesIn.load( memory_order_relaxed );
+    result.framesOut = framesOut.load( memory_order_relaxed );
+    result.reconnects = reconnects.load( memory_order_relaxed );
+    result.timeouts = timeouts.load( memory_order_relaxed );
+    result.slowHandlers = slowHandlers.load( memory_order_relaxed );
+    result.pingTimeouts = pingTimeouts.load( memory_order_relaxed );
+    result.resumeBytes = resumeBytes.load( memory_order_relaxed );
+    result.eventParse = eventParse.snapshot();
+    result.loopLag = loopLag.snapshot();
+    result.dispatch = dispatch.snapshot();
+    result.pingRoundTrip = pingRoundTrip.snapshot();
+    result.reconnectTime = reconnectTime.snapshot();
+    result.resumeTime = resumeTime.snapshot();
+
+    lock_guard< mutex > lock( mutex_ );
+    for ( auto const& action : actions_ ) {
+        result.actions.push_back( {
+                action.first,
+                action.second->requests.load( memory_order_relaxed ),
+                action.second->timeouts.load( memory_order_relaxed ),
+                action.second->allocations.load( memory_order_relaxed ),
+                action.second->queueWait.snapshot(),
+                action.second->roundTrip.snapshot(),
+                action.second->parse.snapshot() } );
+    }
+    for ( auto const& event : events_ ) {
+        result.events.emplace_back( event.first, event.second->load( memory_order_relaxed ) );
+    }
+    for ( auto const& event : eventAllocations_ ) {
+        result.eventAllocations.emplace_back( event.first, event.second->load( memory_order_relaxed ) );
+    }
+    for ( auto const& trace : traces_ ) {
+        result.traces.push_back( {
+                trace.first,
+                trace.second->parse.snapshot(),
+                trace.second->queue.snapshot(),
+                trace.second->handler.snapshot(),
+                trace.second->total.snapshot() } );
+    }
+    return result;
+}
+
+} // namespace rep
+} // namespace prnet
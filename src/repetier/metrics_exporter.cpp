@@ -0,0 +1,457 @@
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/write.hpp>
+#include <boost/beast/version.hpp>
+
+#include "3dprnet/core/allocations.hpp"
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/metrics_exporter.hpp"
+
+using namespace std;
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using tcp = asio::ip::tcp;
+
+namespace prnet {
+namespace rep {
+
+static Logger logger( "rep::MetricsExporter" );
+
+namespace detail {
+
+// bucket bounds of the exported histograms in seconds, the internal ones are far too fine-grained for a scrape
+static double const exportBuckets[] {
+        0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0 };
+
+class PrometheusWriter
+{
+public:
+    PrometheusWriter()
+    {
+        // counters like the sums of the histograms must not be rounded, rate() would see them step unevenly
+        out_.precision( numeric_limits< double >::max_digits10 );
+    }
+
+    void family( char const* name, char const* type, char const* help )
+    {
+        out_ << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+    }
+
+    template< typename Value >
+    void sample( char const* name, string const& server, Value value, char const* label = nullptr,
+                 string const* labelValue = nullptr )
+    {
+        out_ << name;
+        labels( server, label, labelValue );
+        out_ << ' ' << value << '\n';
+    }
+
+    // a sample of the whole process instead of one server
+    template< typename Value >
+    void processSample( char const* name, char const* label, string const& labelValue, Value value )
+    {
+        out_ << name << '{' << label << "=\"";
+        escape( labelValue );
+        out_ << "\"} " << value << '\n';
+    }
+
+    void histogram( char const* name, string const& server, HistogramSnapshot const& snapshot,
+                    char const* label = nullptr, string const* labelValue = nullptr )
+    {
+        auto bucket = snapshot.buckets.cbegin();
+        uint64_t cumulative = 0;
+        for ( auto bound : exportBuckets ) {
+            auto nanos = static_cast< uint64_t >( bound * 1e9 );
+            for ( ; bucket != snapshot.buckets.cend() && bucket->first <= nanos ; ++bucket ) {
+                cumulative += bucket->second;
+            }
+            out_ << name << "_bucket";
+            labels( server, label, labelValue, bound );
+            out_ << ' ' << cumulative << '\n';
+        }
+        // snapshot.count may lag behind the buckets if the snapshot was taken while recording, the buckets must not
+        // exceed +Inf
+        for ( ; bucket != snapshot.buckets.cend() ; ++bucket ) {
+            cumulative += bucket->second;
+        }
+        out_ << name << "_bucket";
+        labels( server, label, labelValue, -1.0 );
+        out_ << ' ' << cumulative << '\n';
+
+        out_ << name << "_sum";
+        labels( server, label, labelValue );
+        out_ << ' ' << static_cast< double >( snapshot.sum ) / 1e9 << '\n';
+        out_ << name << "_count";
+        labels( server, label, labelValue );
+        out_ << ' ' << cumulative << '\n';
+    }
+
+    string str() const
+    {
+        return out_.str();
+    }
+
+private:
+    void labels( string const& server, char const* label, string const* labelValue, double le = 0.0 )
+    {
+        out_ << "{server=\"";
+        escape( server );
+        out_ << '"';
+        if ( label ) {
+            out_ << ',' << label << "=\"";
+            escape( *labelValue );
+            out_ << '"';
+        }
+        if ( le > 0.0 ) {
+            // the bounds read better with the default precision, they need no more
+            auto precision = out_.precision( 6 );
+            out_ << ",le=\"" << le << '"';
+            out_.precision( precision );
+        } else if ( le < 0.0 ) {
+            out_ << ",le=\"+Inf\"";
+        }
+        out_ << '}';
+    }
+
+    void escape( string const& value )
+    {
+        for ( auto c : value ) {
+            switch ( c ) {
+                case '\\': out_ << "\\\\"; break;
+                case '"': out_ << "\\\""; break;
+                case '\n': out_ << "\\n"; break;
+                default: out_ << c; break;
+            }
+        }
+    }
+
+    ostringstream out_;
+};
+
+} // namespace detail
+
+
+/**
+ * class MetricsExporter::Impl
+ */
+
+class MetricsExporter::Impl
+        : public enable_shared_from_this< MetricsExporter::Impl >
+{
+    using Lock = lock_guard< mutex >;
+    using Strand = asio::strand< asio::io_context::executor_type >;
+    using Sources = vector< pair< string, shared_ptr< Metrics const > > >;
+
+public:
+    Impl( asio::io_context& context, unsigned short port, string const& address )
+            : context_( context )
+            , strand_( context.get_executor() )
+            , acceptor_( context, tcp::endpoint( asio::ip::make_address( address ), port ) )
+    {
+    }
+
+    void start()
+    {
+        logger.info( "serving metrics at http://", acceptor_.local_endpoint(), "/metrics" );
+
+        asio::spawn( strand_, [self = shared_from_this()]( auto yield ) {
+            while ( true ) {
+                boost::beast::error_code ec;
+                auto socket = make_shared< tcp::socket >( self->context_ );
+                self->acceptor_.async_accept( *socket, yield[ ec ] );
+                if ( ec == asio::error::operation_aborted ) {
+                    return;
+                }
+                if ( ec ) {
+                    logger.warning( "error accepting metrics connection: ", ec.message() );
+                    continue;
+                }
+                self->serve( move( socket ) );
+            }
+        } );
+    }
+
+    void stop()
+    {
+        asio::post( strand_, [self = shared_from_this()] {
+            boost::system::error_code ec;
+            self->acceptor_.close( ec );
+            for ( auto const& socket : self->sessions_ ) {
+                socket->close( ec );
+            }
+        } );
+    }
+
+    unsigned short port() const
+    {
+        return port_;
+    }
+
+    void add( string&& server, shared_ptr< Metrics const >&& metrics )
+    {
+        Lock lock( mutex_ );
+        sources_[ move( server ) ] = move( metrics );
+    }
+
+    void remove( string const& server )
+    {
+        Lock lock( mutex_ );
+        sources_.erase( server );
+    }
+
+    string render() const
+    {
+        Sources sources;
+        {
+            Lock lock( mutex_ );
+            sources.assign( sources_.cbegin(), sources_.cend() );
+        }
+
+        vector< pair< string, Metrics::Snapshot > > snapshots;
+        snapshots.reserve( sources.size() );
+        for ( auto const& source : sources ) {
+            snapshots.emplace_back( source.first, source.second->snapshot() );
+        }
+
+        detail::PrometheusWriter out;
+        auto counter = [&]( char const* name, char const* type, char const* help, auto member ) {
+            out.family( name, type, help );
+            for ( auto const& snapshot : snapshots ) {
+                out.sample( name, snapshot.first, snapshot.second.*member );
+            }
+        };
+        counter( "prnet_connected", "gauge", "Whether the service is logged in to the server.",
+                 &Metrics::Snapshot::connected );
+        counter( "prnet_queue_depth", "gauge", "Requests queued by the service, including the one in flight.",
+                 &Metrics::Snapshot::queueDepth );
+        counter( "prnet_upload_bytes_total", "counter", "Bytes of model uploads sent.",
+                 &Metrics::Snapshot::uploadBytes );
+        counter( "prnet_received_bytes_total", "counter", "Websocket payload bytes received.",
+                 &Metrics::Snapshot::bytesIn );
+        counter( "prnet_sent_bytes_total", "counter", "Websocket payload bytes sent.",
+                 &Metrics::Snapshot::bytesOut );
+        counter( "prnet_received_frames_total", "counter", "Websocket frames received.",
+                 &Metrics::Snapshot::framesIn );
+        counter( "prnet_sent_frames_total", "counter", "Websocket frames sent.",
+                 &Metrics::Snapshot::framesOut );
+        counter( "prnet_reconnects_total", "counter", "Reconnection attempts.",
+                 &Metrics::Snapshot::reconnects );
+        counter( "prnet_timeouts_total", "counter", "Requests that timed out.",
+                 &Metrics::Snapshot::timeouts );
+        counter( "prnet_slow_handlers_total", "counter", "Event and response handlers that exceeded the threshold.",
+                 &Metrics::Snapshot::slowHandlers );
+        counter( "prnet_ping_timeouts_total", "counter", "Connections considered dead for lack of a pong.",
+                 &Metrics::Snapshot::pingTimeouts );
+        counter( "prnet_resume_bytes_total", "counter", "Response bytes received while resuming after a reconnect.",
+                 &Metrics::Snapshot::resumeBytes );
+
+        out.family( "prnet_events_total", "counter", "Events received by type." );
+        for ( auto const& snapshot : snapshots ) {
+            for ( auto const& event : snapshot.second.events ) {
+                out.sample( "prnet_events_total", snapshot.first, event.second, "type", &event.first );
+            }
+        }
+
+        auto histogram = [&]( char const* name, char const* help, auto member ) {
+            out.family( name, "histogram", help );
+            for ( auto const& snapshot : snapshots ) {
+                out.histogram( name, snapshot.first, snapshot.second.*member );
+            }
+        };
+        histogram( "prnet_event_parse_seconds", "Time spent parsing event frames.", &Metrics::Snapshot::eventParse );
+        histogram( "prnet_loop_lag_seconds", "Delay of the watchdog behind its schedule on the io_context.",
+                   &Metrics::Snapshot::loopLag );
+        histogram( "prnet_dispatch_seconds", "Time spent handling one received frame, including all slots.",
+                   &Metrics::Snapshot::dispatch );
+        histogram( "prnet_ping_round_trip_seconds", "Time from sending a websocket ping until its pong was read.",
+                   &Metrics::Snapshot::pingRoundTrip );
+        histogram( "prnet_reconnect_seconds", "Time from losing the connection until logged in again.",
+                   &Metrics::Snapshot::reconnectTime );
+        histogram( "prnet_resume_seconds", "Time from logging in again until the session was resumed.",
+                   &Metrics::Snapshot::resumeTime );
+
+        auto action = [&]( char const* name, char const* type, char const* help, auto member ) {
+            out.family( name, type, help );
+            for ( auto const& snapshot : snapshots ) {
+                for ( auto const& action : snapshot.second.actions ) {
+                    out.sample( name, snapshot.first, action.*member, "action", &action.name );
+                }
+            }
+        };
+        action( "prnet_action_requests_total", "counter", "Requests sent by action.",
+                &Metrics::ActionSnapshot::requests );
+        action( "prnet_action_timeouts_total", "counter", "Requests that timed out by action.",
+                &Metrics::ActionSnapshot::timeouts );
+        if ( allocationTracking ) {
+            action( "prnet_action_allocations_total", "counter", "Allocations of requests and their responses by action.",
+                    &Metrics::ActionSnapshot::allocations );
+
+            out.family( "prnet_event_allocations_total", "counter", "Allocations of handling events by type." );
+            for ( auto const& snapshot : snapshots ) {
+                for ( auto const& event : snapshot.second.eventAllocations ) {
+                    out.sample( "prnet_event_allocations_total", snapshot.first, event.second, "type", &event.first );
+                }
+            }
+
+            auto stats = allocationStats();
+            out.family( "prnet_allocations_total", "counter", "Allocations of the process by subsystem." );
+            for ( auto const& stat : stats ) {
+                out.processSample( "prnet_allocations_total", "tag", allocationTagName( stat.tag ), stat.allocations );
+            }
+            out.family( "prnet_allocated_bytes_total", "counter", "Bytes allocated by the process by subsystem." );
+            for ( auto const& stat : stats ) {
+                out.processSample( "prnet_allocated_bytes_total", "tag", allocationTagName( stat.tag ), stat.bytes );
+            }
+        }
+
+        auto actionHistogram = [&]( char const* name, char const* help, auto member ) {
+            out.family( name, "histogram", help );
+            for ( auto const& snapshot : snapshots ) {
+                for ( auto const& action : snapshot.second.actions ) {
+                    out.histogram( name, snapshot.first, action.*member, "action", &action.name );
+                }
+            }
+        };
+        actionHistogram( "prnet_action_queue_wait_seconds", "Time requests spent queued in the service until sent.",
+                         &Metrics::ActionSnapshot::queueWait );
+        actionHistogram( "prnet_action_round_trip_seconds",
+                         "Time from starting to write a request until its response was read.",
+                         &Metrics::ActionSnapshot::roundTrip );
+        actionHistogram( "prnet_action_parse_seconds", "Time spent parsing responses.",
+                         &Metrics::ActionSnapshot::parse );
+
+        auto traceHistogram = [&]( char const* name, char const* help, auto member ) {
+            out.family( name, "histogram", help );
+            for ( auto const& snapshot : snapshots ) {
+                for ( auto const& trace : snapshot.second.traces ) {
+                    out.histogram( name, snapshot.first, trace.*member, "type", &trace.type );
+                }
+            }
+        };
+        traceHistogram( "prnet_trace_parse_seconds", "Time from reading an event frame until it was parsed.",
+                        &Metrics::TraceSnapshot::parse );
+        traceHistogram( "prnet_trace_queue_seconds", "Time from parsing an event frame until the event was dispatched.",
+                        &Metrics::TraceSnapshot::queue );
+        traceHistogram( "prnet_trace_handler_seconds", "Time spent in the handler and slots of an event.",
+                        &Metrics::TraceSnapshot::handler );
+        traceHistogram( "prnet_trace_total_seconds", "Time from reading an event frame until its slots returned.",
+                        &Metrics::TraceSnapshot::total );
+
+        return out.str();
+    }
+
+private:
+    void serve( shared_ptr< tcp::socket >&& connection )
+    {
+        sessions_.insert( connection );
+        asio::spawn( strand_, [self = shared_from_this(), connection = move( connection )]( auto yield ) {
+            auto& socket = *connection;
+            boost::beast::error_code ec;
+            boost::beast::flat_buffer buffer;
+            while ( true ) {
+                http::request< http::string_body > request;
+                http::async_read( socket, buffer, request, yield[ ec ] );
+                if ( ec ) {
+                    break;
+                }
+
+                http::response< http::string_body > response;
+                response.version( request.version() );
+                response.keep_alive( request.keep_alive() );
+                response.set( http::field::server, BOOST_BEAST_VERSION_STRING );
+                if ( request.target() != "/metrics" ) {
+                    response.result( http::status::not_found );
+                    response.set( http::field::content_type, "text/plain" );
+                    response.body() = "not found\n";
+                } else if ( request.method() != http::verb::get && request.method() != http::verb::head ) {
+                    response.result( http::status::method_not_allowed );
+                    response.set( http::field::allow, "GET, HEAD" );
+                } else {
+                    response.result( http::status::ok );
+                    response.set( http::field::content_type, "text/plain; version=0.0.4; charset=utf-8" );
+                    response.body() = self->render();
+                }
+                response.prepare_payload();
+                if ( request.method() == http::verb::head ) {
+                    response.body().clear();
+                }
+
+                http::async_write( socket, response, yield[ ec ] );
+                if ( ec || !response.keep_alive() ) {
+                    break;
+                }
+            }
+            if ( ec && ec != http::error::end_of_stream ) {
+                PRNET_LOG_DEBUG( logger, "metrics connection closed: ", ec.message() );
+            }
+            socket.shutdown( tcp::socket::shutdown_send, ec );
+            self->sessions_.erase( connection );
+        } );
+    }
+
+    asio::io_context& context_;
+    Strand strand_;
+    tcp::acceptor acceptor_;
+    unsigned short port_ { acceptor_.local_endpoint().port() };
+
+    mutable mutex mutex_;
+    map< string, shared_ptr< Metrics const > > sources_;
+    set< shared_ptr< tcp::socket > > sessions_; // on strand_
+};
+
+
+/**
+ * class MetricsExporter
+ */
+
+MetricsExporter::MetricsExporter( asio::io_context& context, unsigned short port, string address )
+        : impl_( make_shared< Impl >( context, port, address ) )
+{
+    impl_->start();
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    impl_->stop();
+}
+
+unsigned short MetricsExporter::port() const
+{
+    return impl_->port();
+}
+
+void MetricsExporter::add( string server, shared_ptr< Metrics const > metrics )
+{
+    impl_->add( move( server ), move( metrics ) );
+}
+
+void MetricsExporter::remove( string const& server )
+{
+    impl_->remove( server );
+}
+
+string MetricsExporter::render() const
+{
+    return impl_->render();
+}
+
+} // namespace rep
+} // namespace prnet
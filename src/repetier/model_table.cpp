@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/encoding.hpp"
+#include "3dprnet/repetier/model_table.hpp"
+#include "3dprnet/repetier/types.hpp"
+
+using namespace std;
+using namespace nlohmann;
+
+namespace prnet {
+namespace rep {
+
+namespace detail {
+
+template< typename T >
+size_t capacityBytes( vector< T > const& values )
+{
+    return values.capacity() * sizeof( T );
+}
+
+inline size_t heapBytes( string const& value )
+{
+    // a string whose buffer lives inside the object itself uses the small string optimization
+    auto object = reinterpret_cast< char const* >( &value );
+    auto data = value.data();
+    return data >= object && data < object + sizeof( string ) ? 0 : value.capacity() + 1;
+}
+
+template< typename To, typename From >
+To narrow( From value, char const* column )
+{
+    if ( value > numeric_limits< To >::max() ) {
+        throw out_of_range( string( "model table column " ) + column + " out of range" );
+    }
+    return static_cast< To >( value );
+}
+
+} // namespace detail
+
+
+/**
+ * class ModelRef
+ */
+
+size_t ModelRef::id() const
+{
+    return table_->ids_[ index_ ];
+}
+
+string_view ModelRef::name() const
+{
+    auto begin = table_->nameOffsets_[ index_ ];
+    auto end = table_->nameOffsets_[ index_ + 1 ];
+    return string_view( table_->names_.data() + begin, end - begin );
+}
+
+string const& ModelRef::modelGroup() const
+{
+    return table_->groups_[ table_->groupIndex_[ index_ ] ];
+}
+
+time_t ModelRef::created() const
+{
+    return static_cast< time_t >( table_->created_[ index_ ] );
+}
+
+size_t ModelRef::length() const
+{
+    return static_cast< size_t >( table_->length_[ index_ ] );
+}
+
+size_t ModelRef::layers() const
+{
+    return table_->layers_[ index_ ];
+}
+
+size_t ModelRef::lines() const
+{
+    return table_->lines_[ index_ ];
+}
+
+chrono::microseconds ModelRef::printTime() const
+{
+    return chrono::microseconds( table_->printTime_[ index_ ] );
+}
+
+
+/**
+ * class ModelTable
+ */
+
+ModelTable::ModelTable()
+        : nameOffsets_( 1, 0 ) {}
+
+ModelTable::ModelTable( vector< Model > const& models )
+        : ModelTable()
+{
+    reserve( models.size() );
+    for ( auto const& model : models ) {
+        push_back( model );
+    }
+}
+
+void ModelTable::reserve( size_t models, size_t nameBytes )
+{
+    ids_.reserve( models );
+    created_.reserve( models );
+    length_.reserve( models );
+    layers_.reserve( models );
+    lines_.reserve( models );
+    printTime_.reserve( models );
+    groupIndex_.reserve( models );
+    nameOffsets_.reserve( models + 1 );
+    names_.reserve( nameBytes );
+}
+
+void ModelTable::push_back( Model const& model )
+{
+    append( model.id(), model.name(), model.modelGroup(), model.created(), model.length(), model.layers(),
+            model.lines(), model.printTime() );
+}
+
+void ModelTable::clear()
+{
+    ids_.clear();
+    created_.clear();
+    length_.clear();
+    layers_.clear();
+    lines_.clear();
+    printTime_.clear();
+    groupIndex_.clear();
+    nameOffsets_.assign( 1, 0 );
+    names_.clear();
+    groups_.clear();
+    groupOrder_.clear();
+}
+
+void ModelTable::shrink_to_fit()
+{
+    ids_.shrink_to_fit();
+    created_.shrink_to_fit();
+    length_.shrink_to_fit();
+    layers_.shrink_to_fit();
+    lines_.shrink_to_fit();
+    printTime_.shrink_to_fit();
+    groupIndex_.shrink_to_fit();
+    nameOffsets_.shrink_to_fit();
+    names_.shrink_to_fit();
+    groups_.shrink_to_fit();
+    groupOrder_.shrink_to_fit();
+}
+
+size_t ModelTable::memory_usage() const
+{
+    size_t result = sizeof( *this )
+            + detail::capacityBytes( ids_ )
+            + detail::capacityBytes( created_ )
+            + detail::capacityBytes( length_ )
+            + detail::capacityBytes( layers_ )
+            + detail::capacityBytes( lines_ )
+            + detail::capacityBytes( printTime_ )
+            + detail::capacityBytes( groupIndex_ )
+            + detail::capacityBytes( nameOffsets_ )
+            + detail::heapBytes( names_ )
+            + detail::capacityBytes( groups_ )
+            + detail::capacityBytes( groupOrder_ );
+    for ( auto const& group : groups_ ) {
+        result += detail::heapBytes( group );
+    }
+    return result;
+}
+
+void ModelTable::append( size_t id, string_view name, string const& group, time_t created, size_t length,
+                         size_t layers, size_t lines, chrono::microseconds printTime )
+{
+    // all columns must keep the same length, so nothing is appended before every value is known to fit
+    auto narrowId = detail::narrow< uint32_t >( id, "id" );
+    auto narrowLayers = detail::narrow< uint32_t >( layers, "layers" );
+    auto narrowLines = detail::narrow< uint32_t >( lines, "lines" );
+    auto nameOffset = detail::narrow< uint32_t >( names_.size() + name.size(), "name" );
+    auto groupIndex = intern( group );
+
+    ids_.push_back( narrowId );
+    created_.push_back( static_cast< int64_t >( created ) );
+    length_.push_back( length );
+    layers_.push_back( narrowLayers );
+    lines_.push_back( narrowLines );
+    printTime_.push_back( printTime.count() );
+    groupIndex_.push_back( groupIndex );
+    names_.append( name.data(), name.size() );
+    nameOffsets_.push_back( nameOffset );
+}
+
+uint32_t ModelTable::intern( string const& group )
+{
+    // a printer has few groups, a binary search over their indices needs no second copy of the names
+    auto it = lower_bound( groupOrder_.begin(), groupOrder_.end(), group,
+                           [this]( uint32_t index, string const& name ) { return groups_[ index ] < name; } );
+    if ( it != groupOrder_.end() && groups_[ *it ] == group ) {
+        return *it;
+    }
+
+    // reserved up front, so that the insertion cannot fail once the name is added
+    auto position = it - groupOrder_.begin();
+    auto index = detail::narrow< uint32_t >( groups_.size(), "group" );
+    groupOrder_.reserve( groups_.size() + 1 );
+    groups_.push_back( group );
+    groupOrder_.insert( groupOrder_.begin() + position, index );
+    return index;
+}
+
+void from_json( json const& src, ModelTable& dst )
+{
+    dst.clear();
+    dst.reserve( src.size() );
+    for ( auto const& model : src ) {
+        dst.append(
+                model.at( "id" ),
+                enc::convert< enc::ToUtf8 >( model.at( "name" ) ),
+                enc::convert< enc::ToUtf8 >( model.at( "group" ) ),
+                model.at( "created" ).get< size_t >() / 1000,
+                model.at( "length" ),
+                model.at( "layer" ),
+                model.at( "lines" ),
+                chrono::milliseconds( static_cast< uint64_t >( model.at( "printTime" ).get< double >() * 1000.0 ) ) );
+    }
+}
+
+size_t memory_usage( vector< Model > const& models )
+{
+    size_t result = sizeof( models ) + detail::capacityBytes( models );
+    for ( auto const& model : models ) {
+        result += detail::heapBytes( model.name() ) + detail::heapBytes( model.modelGroup() );
+    }
+    return result;
+}
+
+} // namespace rep
+} // namespace prnet
@@ -0,0 +1,46 @@
+#ifndef LIB3DPRNET_REPETIER_REQUEST_HPP
+#define LIB3DPRNET_REPETIER_REQUEST_HPP
+
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/error.hpp"
+
+namespace prnet {
+namespace rep {
+namespace detail {
+
+/**
+ * Building and checking the JSON objects exchanged with the server, private to the library and the benchmarks.
+ */
+
+inline void checkResponseOk( nlohmann::json const& data )
+{
+    if ( !data.at( "ok" ) ) {
+        throw std::system_error( make_error_code( prnet_errc::not_ok ) );
+    }
+}
+
+inline nlohmann::json makeRequest( std::string action )
+{
+    return {
+        { "action", std::move( action ) },
+        { "data", nlohmann::json::object() }
+    };
+}
+
+inline nlohmann::json makeRequest( std::string action, std::string slug )
+{
+    auto request = makeRequest( std::move( action ) );
+    request.emplace( "printer", std::move( slug ) );
+    return request;
+}
+
+} // namespace detail
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_REQUEST_HPP
@@ -0,0 +1,205 @@
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include <boost/asio/post.hpp>
+
+#include "3dprnet/repetier/resolver_cache.hpp"
+
+using namespace std;
+
+namespace asio = boost::asio;
+
+using tcp = asio::ip::tcp;
+
+namespace prnet {
+namespace rep {
+
+namespace detail {
+
+static void asioResolve( asio::io_context& context, string const& host, string const& port,
+                         ResolverCache::Handler handler )
+{
+    auto resolver = make_shared< tcp::resolver >( context );
+    resolver->async_resolve( host, port, [resolver, handler = move( handler )](
+            error_code ec, tcp::resolver::results_type results ) {
+        ResolverCache::Endpoints endpoints;
+        for ( auto const& entry : results ) {
+            endpoints.push_back( entry.endpoint() );
+        }
+        handler( ec, endpoints );
+    } );
+}
+
+} // namespace detail
+
+
+/**
+ * class ResolverCache::Impl
+ */
+
+class ResolverCache::Impl
+        : public enable_shared_from_this< ResolverCache::Impl >
+{
+    using Lock = lock_guard< mutex >;
+    using Clock = chrono::steady_clock;
+    using Key = pair< string, string >;
+
+    struct Waiter
+    {
+        asio::io_context* context;
+        Handler handler;
+    };
+
+    struct Entry
+    {
+        Endpoints endpoints;
+        Clock::time_point expiry;
+        bool resolving {};
+        vector< Waiter > waiting;
+    };
+
+public:
+    explicit Impl( Options&& options )
+            : options_( move( options ) )
+    {
+        if ( !options_.resolve ) {
+            options_.resolve = detail::asioResolve;
+        }
+    }
+
+    void resolve( asio::io_context& context, string const& host, string const& port, Handler&& handler )
+    {
+        {
+            Lock lock( mutex_ );
+            auto& entry = entries_[ { host, port } ];
+            if ( !entry.resolving && Clock::now() < entry.expiry ) {
+                ++hits_;
+                asio::post( context, [handler = move( handler ), endpoints = entry.endpoints] {
+                    handler( {}, endpoints );
+                } );
+                return;
+            }
+            entry.waiting.push_back( { &context, move( handler ) } );
+            if ( entry.resolving ) {
+                ++hits_;
+                return;
+            }
+            entry.resolving = true;
+            ++misses_;
+        }
+
+        options_.resolve( context, host, port, [self = shared_from_this(), key = Key( host, port )](
+                error_code ec, Endpoints const& endpoints ) {
+            self->complete( key, ec, endpoints );
+        } );
+    }
+
+    void invalidate( string const& host, string const& port )
+    {
+        Lock lock( mutex_ );
+        auto it = entries_.find( { host, port } );
+        if ( it != entries_.end() && !it->second.resolving ) {
+            entries_.erase( it );
+        }
+    }
+
+    chrono::milliseconds attemptDelay() const
+    {
+        return options_.attemptDelay;
+    }
+
+    size_t hits() const
+    {
+        Lock lock( mutex_ );
+        return hits_;
+    }
+
+    size_t misses() const
+    {
+        Lock lock( mutex_ );
+        return misses_;
+    }
+
+private:
+    void complete( Key const& key, error_code ec, Endpoints const& endpoints )
+    {
+        if ( !ec && endpoints.empty() ) {
+            ec = make_error_code( asio::error::host_not_found );
+        }
+
+        vector< Waiter > waiting;
+        {
+            Lock lock( mutex_ );
+            auto it = entries_.find( key );
+            waiting = move( it->second.waiting );
+            if ( ec ) {
+                entries_.erase( it );
+            } else {
+                it->second.endpoints = endpoints;
+                it->second.expiry = Clock::now() + options_.ttl;
+                it->second.resolving = false;
+                it->second.waiting.clear();
+            }
+        }
+
+        // the waiters may run on different io_contexts than the resolution
+        for ( auto& waiter : waiting ) {
+            asio::post( *waiter.context, [handler = move( waiter.handler ), ec, endpoints] {
+                handler( ec, endpoints );
+            } );
+        }
+    }
+
+    Options options_;
+    mutable mutex mutex_;
+    map< Key, Entry > entries_;
+    size_t hits_ {};
+    size_t misses_ {};
+};
+
+
+/**
+ * class ResolverCache
+ */
+
+ResolverCache::Options ResolverCache::defaultOptions()
+{
+    return { chrono::seconds( 60 ), chrono::milliseconds( 250 ), nullptr };
+}
+
+ResolverCache::ResolverCache()
+        : ResolverCache( defaultOptions() ) {}
+
+ResolverCache::ResolverCache( Options options )
+        : impl_( make_shared< Impl >( move( options ) ) ) {}
+
+ResolverCache::~ResolverCache() = default;
+
+void ResolverCache::resolve( asio::io_context& context, string const& host, string const& port, Handler handler )
+{
+    impl_->resolve( context, host, port, move( handler ) );
+}
+
+void ResolverCache::invalidate( string const& host, string const& port )
+{
+    impl_->invalidate( host, port );
+}
+
+chrono::milliseconds ResolverCache::attemptDelay() const
+{
+    return impl_->attemptDelay();
+}
+
+size_t ResolverCache::hits() const
+{
+    return impl_->hits();
+}
+
+size_t ResolverCache::misses() const
+{
+    return impl_->misses();
+}
+
+} // namespace rep
+} // namespace prnet
@@ -0,0 +1,65 @@
+#ifndef LIB3DPRNET_REPETIER_ROUND_TRIP_HPP
+#define LIB3DPRNET_REPETIER_ROUND_TRIP_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+#include "3dprnet/repetier/timeouts.hpp"
+
+namespace prnet {
+namespace rep {
+namespace detail {
+
+/**
+ * class RoundTripEstimator
+ *
+ * Smoothed round trip time SRTT and its mean deviation RTTVAR as in RFC 6298, from which the timeout of the next
+ * request is derived.
+ */
+
+class RoundTripEstimator
+{
+public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    void sample( Duration rtt )
+    {
+        if ( samples_++ == 0 ) {
+            srtt_ = rtt;
+            rttvar_ = rtt / 2;
+            return;
+        }
+        auto deviation = srtt_ > rtt ? srtt_ - rtt : rtt - srtt_;
+        rttvar_ = ( 3 * rttvar_ + deviation ) / 4;
+        srtt_ = ( 7 * srtt_ + rtt ) / 8;
+    }
+
+    /**
+     * SRTT + k * RTTVAR clamped to the bounds of timeouts, or the initial timeout before the first sample.
+     */
+    Duration timeout( Timeouts const& timeouts ) const
+    {
+        if ( samples_ == 0 ) {
+            return timeouts.initial;
+        }
+        auto result = srtt_ + std::chrono::duration_cast< Duration >(
+                std::chrono::duration< double, Duration::period >( rttvar_.count() * timeouts.k ) );
+        return std::min< Duration >( std::max< Duration >( result, timeouts.minimum ), timeouts.maximum );
+    }
+
+    Duration srtt() const { return srtt_; }
+    Duration rttvar() const { return rttvar_; }
+    std::size_t samples() const { return samples_; }
+
+private:
+    Duration srtt_ {};
+    Duration rttvar_ {};
+    std::size_t samples_ {};
+};
+
+} // namespace detail
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_ROUND_TRIP_HPP
@@ -1,18 +1,30 @@
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <list>
+#include <random>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <nlohmann/json.hpp>
 
+#include "3dprnet/core/allocations.hpp"
 #include "3dprnet/core/error.hpp"
 #include "3dprnet/core/logging.hpp"
 #include "3dprnet/repetier/client.hpp"
+#include "3dprnet/repetier/connect_limit.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/resolver_cache.hpp"
 #include "3dprnet/repetier/service.hpp"
 #include "3dprnet/repetier/types.hpp"
 #include "3dprnet/repetier/upload.hpp"
+#include "repetier/request.hpp"
 
 using namespace std;
 using namespace nlohmann;
@@ -26,38 +38,108 @@ static Logger logger( "rep::Service" );
     
 namespace detail {
     
-inline long retryTimeout( size_t retry ) 
+template< typename Random >
+chrono::milliseconds retryTimeout( size_t retry, chrono::milliseconds backoff, chrono::milliseconds cap, Random& random )
 {
-    switch ( retry ) {
-        case 0: return 0;
-        case 1: return 2;
-        case 2: return 5;
-        case 3: return 10;
-        default: return 30;
+    // backoff * 2^retry without overflowing
+    auto limit = retry < 32 && backoff.count() <= ( cap.count() >> retry ) ? backoff * ( chrono::milliseconds::rep( 1 ) << retry ) : cap;
+    if ( limit.count() <= 0 ) {
+        return {};
     }
+    return chrono::milliseconds( uniform_int_distribution< chrono::milliseconds::rep >( 0, limit.count() )( random ) );
 }
 
-inline void checkResponseOk( json const& data )
+/**
+ * Counts the allocations of func, which the client invokes, for the service.
+ */
+template< typename Func >
+auto tagged( Func&& func )
 {
-    if ( !data.at( "ok" ) ) {
-        throw system_error( make_error_code( prnet_errc::not_ok ) );
-    }
+    return [func = forward< Func >( func )]( auto&&... args ) mutable {
+        AllocationScope scope( AllocationTag::service );
+        func( forward< decltype( args ) >( args )... );
+    };
 }
 
-inline json makeRequest( string action )
+
+/**
+ * class TemperatureGate
+ */
+
+class TemperatureGate
 {
-    return {
-        { "action", move( action ) },
-        { "data", json::object() }
+    using Clock = chrono::steady_clock;
+
+    struct Reading
+    {
+        double wanted;
+        double actual;
+        Clock::time_point time;
     };
-}
 
-inline json makeRequest( string action, string slug )
-{
-    auto request = makeRequest( move( action ) );
-    request.emplace( "printer", move( slug ) );
-    return move( request );
-}
+public:
+    void configure( Service::TemperatureFilter const& filter )
+    {
+        filter_ = filter;
+        readings_.clear();
+    }
+
+    Service::TemperatureFilterStats stats() const
+    {
+        return { received_.load( memory_order_relaxed ), delivered_.load( memory_order_relaxed ),
+                 suppressedDeadband_.load( memory_order_relaxed ), suppressedRate_.load( memory_order_relaxed ) };
+    }
+
+    /**
+     * Decides on the raw event data, before it is converted into a Temperature.
+     */
+    bool pass( string const& slug, json const& data )
+    {
+        received_.fetch_add( 1, memory_order_relaxed );
+
+        if ( filter_.deadband <= 0.0 && filter_.interval.count() <= 0 ) {
+            delivered_.fetch_add( 1, memory_order_relaxed );
+            return true;
+        }
+
+        int id = data.at( "id" );
+        double wanted = data.at( "S" );
+        double actual = data.at( "T" );
+        auto now = Clock::now();
+
+        auto& controllers = readings_[ slug ];
+        auto reading = controllers.find( id );
+        if ( reading == controllers.end() ) {
+            controllers.emplace( id, Reading { wanted, actual, now } );
+            delivered_.fetch_add( 1, memory_order_relaxed );
+            return true;
+        }
+
+        auto& last = reading->second;
+        auto elapsed = now - last.time;
+        bool refresh = filter_.refresh.count() > 0 && elapsed >= filter_.refresh;
+        if ( !refresh && fabs( wanted - last.wanted ) < filter_.deadband && fabs( actual - last.actual ) < filter_.deadband ) {
+            suppressedDeadband_.fetch_add( 1, memory_order_relaxed );
+            return false;
+        }
+        if ( elapsed < filter_.interval ) {
+            suppressedRate_.fetch_add( 1, memory_order_relaxed );
+            return false;
+        }
+
+        last = { wanted, actual, now };
+        delivered_.fetch_add( 1, memory_order_relaxed );
+        return true;
+    }
+
+private:
+    Service::TemperatureFilter filter_ {};
+    unordered_map< string, unordered_map< int, Reading > > readings_;
+    atomic< size_t > received_ {};
+    atomic< size_t > delivered_ {};
+    atomic< size_t > suppressedDeadband_ {};
+    atomic< size_t > suppressedRate_ {};
+};
 
 } // namespace detail
 
@@ -70,20 +152,65 @@ struct Service::Action
 {
     Action( json&& request, CallbackHandler&& handler )
             : request( move( request ) )
-            , handler( move( handler ) ) {}
+            , handler( move( handler ) )
+            , queued( chrono::steady_clock::now() ) {}
 
     json request;
     CallbackHandler handler;
+    chrono::steady_clock::time_point queued;
 };
     
 class Service::ServiceImpl
+        : public enable_shared_from_this< Service::ServiceImpl >
 {
+    using Clock = chrono::steady_clock;
+
 public:
     ServiceImpl( boost::asio::io_context& context, Endpoint&& endpoint )
             : context_( context )
+            , strand_( context_.get_executor() )
             , endpoint_( move( endpoint ) )
+            , retryTimer_( context_ )
+            , watchdogTimer_( context_ )
+            , watchdog_( defaultWatchdog() )
+            , reconnect_( defaultReconnect() )
+            , random_( random_device()() )
+            , metrics_( make_shared< Metrics >() ) {}
+
+    void start()
+    {
+        asio::dispatch( strand_, [self = shared_from_this()] {
+            AllocationScope scope( AllocationTag::service );
+            self->connect();
+            self->schedule_watchdog();
+        } );
+    }
+
+    void shutdown()
     {
-        connect();
+        if ( stopped_.exchange( true ) ) {
+            return;
+        }
+
+        on_reconnect_.disconnect_all_slots();
+        on_disconnect_.disconnect_all_slots();
+        on_temperature_.disconnect_all_slots();
+        on_printers_.disconnect_all_slots();
+        on_config_.disconnect_all_slots();
+        on_groups_.disconnect_all_slots();
+        on_models_.disconnect_all_slots();
+
+        asio::dispatch( strand_, [self = shared_from_this()] {
+            self->client_ = nullptr;
+            self->release_connect();
+            self->retryTimer_.cancel();
+            self->watchdogTimer_.cancel();
+            self->queued_.clear();
+            self->pending_ = false;
+            self->connected_ = false;
+            self->metrics_->queueDepth.store( 0, memory_order_relaxed );
+            self->metrics_->connected.store( false, memory_order_relaxed );
+        } );
     }
 
     bool connected() const { return connected_; }
@@ -186,10 +313,100 @@ public:
         } );
     }
 
+    void temperature_filter( TemperatureFilter&& filter )
+    {
+        asio::dispatch( strand_, [self = shared_from_this(), filter] { self->temperatureGate_.configure( filter ); } );
+    }
+
+    TemperatureFilterStats temperature_filter_stats() const
+    {
+        return temperatureGate_.stats();
+    }
+
+    void watchdog( Watchdog&& watchdog )
+    {
+        asio::dispatch( strand_, [self = shared_from_this(), watchdog] {
+            if ( self->stopped_ ) {
+                return;
+            }
+            self->watchdog_ = watchdog;
+            if ( self->client_ ) {
+                self->client_->slow_handlers( watchdog.threshold );
+            }
+            self->schedule_watchdog();
+        } );
+    }
+
+    void reconnect( Reconnect&& reconnect )
+    {
+        asio::dispatch( strand_, [self = shared_from_this(), reconnect = move( reconnect )]() mutable {
+            self->reconnect_ = move( reconnect );
+        } );
+    }
+
+    void resolver( shared_ptr< ResolverCache >&& resolver )
+    {
+        asio::dispatch( strand_, [self = shared_from_this(), resolver = move( resolver )]() mutable {
+            self->resolver_ = move( resolver );
+        } );
+    }
+
+    void timeouts( Timeouts&& timeouts )
+    {
+        asio::dispatch( strand_, [self = shared_from_this(), timeouts = move( timeouts )]() mutable {
+            if ( self->stopped_ ) {
+                return;
+            }
+            self->timeouts_ = timeouts;
+            if ( self->client_ ) {
+                self->client_->timeouts( move( timeouts ) );
+            }
+        } );
+    }
+
+    void tracing( Tracing&& tracing )
+    {
+        asio::dispatch( strand_, [self = shared_from_this(), tracing = move( tracing )]() mutable {
+            if ( self->stopped_ ) {
+                return;
+            }
+            self->tracing_ = tracing;
+            if ( self->client_ ) {
+                self->client_->tracing( move( tracing ) );
+            }
+        } );
+    }
+
+    void capture( shared_ptr< CaptureWriter >&& writer )
+    {
+        asio::dispatch( strand_, [self = shared_from_this(), writer = move( writer )]() mutable {
+            if ( self->stopped_ ) {
+                return;
+            }
+            self->capture_ = writer;
+            if ( self->client_ ) {
+                self->client_->capture( move( writer ) );
+            }
+        } );
+    }
+
+    Metrics::Snapshot metrics() const
+    {
+        return metrics_->snapshot();
+    }
+
+    shared_ptr< Metrics const > metrics_source() const
+    {
+        return metrics_;
+    }
+
     void upload( model_ident&& ident, filesystem::path&& path, UploadHandler&& handler )
     {
-        uploadModel( context_, endpoint_, move( ident ), move( path ), [this, handler = move( handler )]( auto ec ) {
-            handler( ec );
+        // the resolver is only accessed on the strand
+        asio::dispatch( strand_, [self = shared_from_this(), ident = move( ident ), path = move( path ),
+                                  handler = move( handler )]() mutable {
+            uploadModel( self->context_, self->endpoint_, move( ident ), move( path ), move( handler ), self->metrics_,
+                         self->resolver_ );
         } );
     }
 
@@ -232,39 +449,87 @@ public:
 private:
     void connect()
     {
+        if ( reconnect_.limit && !connectSlot_ ) {
+            reconnect_.limit->acquire( [self = shared_from_this(), limit = reconnect_.limit] {
+                asio::post( self->strand_, [self, limit] {
+                    self->connectSlot_ = limit;
+                    if ( self->stopped_ ) {
+                        self->release_connect();
+                        return;
+                    }
+                    AllocationScope scope( AllocationTag::service );
+                    self->connect();
+                } );
+            } );
+            return;
+        }
+
         logger.info( "initiating connection to server" );
 
-        client_ = make_unique< Client >( context_, [this]( auto ec ) { this->handle_error( ec ); } );
-        client_->subscribe( "temp", [this]( auto slug, auto data ) { on_temperature_( move( slug ), move( data ) ); } );
-        client_->subscribe( "printerListChanged", [this]( auto, auto data ) { on_printers_( move( data ) ); } );
-        client_->subscribe( "config", [this]( auto slug, auto data ) { on_config_( move( slug ), move( data ) ); } );
-        client_->subscribe( "modelGroupListChanged", [this]( auto slug, auto ) { this->request_groups( move( slug ) ); } );
-        client_->subscribe( "jobsChanged", [this]( auto slug, auto ) { this->request_models( move( slug ) ); } );
-        client_->subscribe( "jobFinished", [this]( auto slug, auto ) { this->request_printers(); } );
-        client_->connect( endpoint_, [this] { this->handle_connected(); } );
+        client_ = make_unique< Client >( strand_, detail::tagged( [this]( auto ec ) { this->handle_error( ec ); } ) );
+        client_->resolver( resolver_ );
+        client_->metrics( metrics_ );
+        client_->slow_handlers( watchdog_.threshold );
+        client_->timeouts( timeouts_ );
+        client_->tracing( tracing_ );
+        client_->capture( capture_ );
+        client_->subscribe( "temp", detail::tagged( [this]( auto slug, auto const& data ) { this->handle_temperature( move( slug ), data ); } ) );
+        client_->subscribe( "printerListChanged", detail::tagged( [this]( auto, auto data ) { on_printers_( move( data ) ); } ) );
+        client_->subscribe( "config", detail::tagged( [this]( auto slug, auto data ) { on_config_( move( slug ), move( data ) ); } ) );
+        client_->subscribe( "modelGroupListChanged", detail::tagged( [this]( auto slug, auto ) { this->request_groups( move( slug ) ); } ) );
+        client_->subscribe( "jobsChanged", detail::tagged( [this]( auto slug, auto ) { this->request_models( move( slug ) ); } ) );
+        client_->subscribe( "jobFinished", detail::tagged( [this]( auto slug, auto ) { this->request_printers(); } ) );
+        client_->connect( endpoint_, detail::tagged( [this] { this->handle_connected(); } ) );
     }
 
+
     void send( json&& request, CallbackHandler handler, bool priority = false )
     {
-        queued_.emplace( priority ? queued_.begin() : queued_.end(), move( request ), move( handler ) );
-        send_next( priority );
+        AllocationScope scope( AllocationTag::service );
+        asio::dispatch( strand_, [self = shared_from_this(), request = move( request ), handler = move( handler ),
+                                  priority]() mutable {
+            if ( self->stopped_ ) {
+                return;
+            }
+            AllocationScope scope( AllocationTag::service );
+            auto allocations = threadAllocations();
+            auto& queued = self->queued_;
+            auto action = queued.emplace( priority ? queued.begin() : queued.end(), move( request ), move( handler ) );
+            if ( allocationTracking ) {
+                self->metricsAction( action->request.at( "action" ) ).allocations.fetch_add(
+                        threadAllocations() - allocations, memory_order_relaxed );
+            }
+            self->metrics_->queueDepth.store( queued.size(), memory_order_relaxed );
+            self->send_next( priority );
+        } );
     }
 
     void send_next( bool force = false )
     {
         if ( ( connected_ || force ) && !pending_ && !queued_.empty() ) {
             auto& action = queued_.front();
-            client_->send( action.request, [this, &action]( auto const& data ) {
+            auto& metrics = metricsAction( action.request.at( "action" ) );
+            metrics.queueWait.record( chrono::steady_clock::now() - action.queued );
+            client_->send( action.request, detail::tagged( [this, &action]( auto const& data ) {
                 action.handler( data );
                 this->handle_sent();
-            } );
+            } ) );
             pending_ = true;
         }
     }
 
+    Metrics::Action& metricsAction( string const& name )
+    {
+        auto it = actions_.find( name );
+        if ( it == actions_.end() ) {
+            it = actions_.emplace( name, &metrics_->action( name ) ).first;
+        }
+        return *it->second;
+    }
+
     void handle_connected()
     {
-        logger.debug( "sending login request" );
+        PRNET_LOG_DEBUG( logger, "sending login request" );
 
         auto request = detail::makeRequest( "login" );
         request[ "data" ].emplace( "apikey", endpoint_.apikey() );
@@ -279,40 +544,137 @@ private:
         logger.info( "successfully connected and logged in" );
 
         connected_ = true;
+        metrics_->connected.store( true, memory_order_relaxed );
         retry_ = 0;
+        release_connect();
+        if ( disconnected_ != Clock::time_point() ) {
+            // the session is resumed until the requests of the slots below have been answered
+            resumed_ = Clock::now();
+            resumeBytes_ = metrics_->resumeBytes.load( memory_order_relaxed );
+            metrics_->reconnectTime.record( resumed_ - disconnected_ );
+            metrics_->resuming.store( true, memory_order_relaxed );
+            disconnected_ = {};
+        }
         on_reconnect_();
     }
 
+    void release_connect()
+    {
+        if ( connectSlot_ ) {
+            connectSlot_->release();
+            connectSlot_ = nullptr;
+        }
+    }
+
     void handle_sent()
     {
         queued_.pop_front();
+        metrics_->queueDepth.store( queued_.size(), memory_order_relaxed );
         pending_ = false;
+        if ( queued_.empty() && metrics_->resuming.load( memory_order_relaxed ) ) {
+            auto elapsed = Clock::now() - resumed_;
+            metrics_->resumeTime.record( elapsed );
+            metrics_->resuming.store( false, memory_order_relaxed );
+            logger.info( "session resumed in ", chrono::duration_cast< chrono::milliseconds >( elapsed ).count(),
+                         "ms, refetched ", metrics_->resumeBytes.load( memory_order_relaxed ) - resumeBytes_, " bytes" );
+        }
         send_next();
     }
 
+    void handle_temperature( string&& slug, json const& data )
+    {
+        if ( on_temperature_.empty() || !temperatureGate_.pass( slug, data ) ) {
+            return;
+        }
+        on_temperature_( move( slug ), data );
+    }
+
+    void schedule_watchdog()
+    {
+        if ( watchdog_.interval.count() <= 0 ) {
+            watchdogTimer_.cancel();
+            return;
+        }
+
+        watchdogTimer_.expires_after( watchdog_.interval );
+        watchdogTimer_.async_wait( asio::bind_executor( strand_, [self = shared_from_this()]( error_code ec ) {
+            if ( ec == make_error_code( asio::error::operation_aborted ) || self->stopped_ ) {
+                return;
+            }
+
+            // the lag is measured on the io_context itself, beyond the strand that may be busy with this service
+            asio::post( self->context_, [self, expiry = self->watchdogTimer_.expiry(),
+                                         threshold = self->watchdog_.threshold] {
+                auto lag = chrono::steady_clock::now() - expiry;
+                self->metrics_->loopLag.record( lag );
+                if ( threshold.count() > 0 && lag > threshold ) {
+                    logger.warning( "event loop lagging behind by ",
+                                    chrono::duration_cast< chrono::milliseconds >( lag ).count(), "ms" );
+                }
+            } );
+            self->schedule_watchdog();
+        } ) );
+    }
+
     void handle_error( error_code ec )
     {
+        // reconnect time counts from the first of several failed attempts
+        if ( disconnected_ == Clock::time_point() ) {
+            disconnected_ = Clock::now();
+        }
         connected_ = false;
+        metrics_->connected.store( false, memory_order_relaxed );
+        metrics_->resuming.store( false, memory_order_relaxed );
         client_ = nullptr;
         pending_ = false;
+        release_connect();
+
+        // the next connection logs in anew
+        queued_.remove_if( []( auto const& action ) { return action.request.at( "action" ) == "login"; } );
+        metrics_->queueDepth.store( queued_.size(), memory_order_relaxed );
 
         on_disconnect_( ec );
 
-        long timeout = detail::retryTimeout( retry_++ );
+        auto timeout = detail::retryTimeout( retry_++, reconnect_.backoff, reconnect_.cap, random_ );
 
-        logger.error( "error in server communication, reconnecting in ", timeout, " seconds: ", ec.message() );
+        logger.error( "error in server communication, reconnecting in ", timeout.count(), "ms: ", ec.message() );
 
-        auto timer = make_shared< asio::steady_timer >( context_, chrono::seconds( timeout ) );
-        timer->async_wait( [this, timer]( auto ) { this->connect(); } );
+        retryTimer_.expires_after( timeout );
+        retryTimer_.async_wait( asio::bind_executor( strand_, [self = shared_from_this()]( error_code ec ) {
+            AllocationScope scope( AllocationTag::service );
+            // the timer is cancelled when the service is destroyed
+            if ( ec != make_error_code( asio::error::operation_aborted ) && !self->stopped_ ) {
+                self->metrics_->reconnects.fetch_add( 1, memory_order_relaxed );
+                self->connect();
+            }
+        } ) );
     }
 
     asio::io_context& context_;
+    Client::Strand strand_;
     Endpoint endpoint_;
     unique_ptr< Client > client_;
-    bool connected_ {};
+    asio::steady_timer retryTimer_;
+    asio::steady_timer watchdogTimer_;
+    Watchdog watchdog_;
+    Reconnect reconnect_;
+    shared_ptr< ConnectLimit > connectSlot_;
+    Timeouts timeouts_ { Client::defaultTimeouts() };
+    shared_ptr< ResolverCache > resolver_ { make_shared< ResolverCache >() };
+    minstd_rand random_;
+    Tracing tracing_ {};
+    shared_ptr< CaptureWriter > capture_;
+    atomic< bool > connected_ {};
+    atomic< bool > stopped_ {};
     bool pending_ {};
     size_t retry_ {};
+    Clock::time_point disconnected_;
+    Clock::time_point resumed_;
+    uint64_t resumeBytes_ {};
     list< Action > queued_;
+    detail::TemperatureGate temperatureGate_;
+    shared_ptr< Metrics > metrics_;
+    unordered_map< string, Metrics::Action* > actions_;
 
     ReconnectEvent on_reconnect_;
     DisconnectEvent on_disconnect_;
@@ -323,10 +685,31 @@ private:
     ModelsEvent on_models_;
 };
 
+Service::Watchdog Service::defaultWatchdog()
+{
+    return {};
+}
+
+Service::Reconnect Service::defaultReconnect()
+{
+    return {};
+}
+
 Service::Service( asio::io_context &context, Endpoint endpoint )
-        : impl_( make_unique< ServiceImpl >( context, move( endpoint ) ) ) {}
+        : impl_( make_shared< ServiceImpl >( context, move( endpoint ) ) )
+{
+    impl_->start();
+}
+
+Service::~Service()
+{
+    impl_->shutdown();
+}
 
-Service::~Service() = default;
+void Service::shutdown()
+{
+    impl_->shutdown();
+}
 
 bool Service::connected() const { return impl_->connected(); }
 
@@ -380,6 +763,56 @@ void Service::sendCommand( string slug, string command, Handler handler )
     impl_->sendCommand( move( slug ), move( command ), move( handler ) );
 }
 
+void Service::temperature_filter( TemperatureFilter filter )
+{
+    impl_->temperature_filter( move( filter ) );
+}
+
+Service::TemperatureFilterStats Service::temperature_filter_stats() const
+{
+    return impl_->temperature_filter_stats();
+}
+
+void Service::watchdog( Watchdog watchdog )
+{
+    impl_->watchdog( move( watchdog ) );
+}
+
+void Service::reconnect( Reconnect reconnect )
+{
+    impl_->reconnect( move( reconnect ) );
+}
+
+void Service::resolver( shared_ptr< ResolverCache > resolver )
+{
+    impl_->resolver( move( resolver ) );
+}
+
+void Service::timeouts( Timeouts timeouts )
+{
+    impl_->timeouts( move( timeouts ) );
+}
+
+void Service::tracing( Tracing tracing )
+{
+    impl_->tracing( move( tracing ) );
+}
+
+void Service::capture( shared_ptr< CaptureWriter > writer )
+{
+    impl_->capture( move( writer ) );
+}
+
+Metrics::Snapshot Service::metrics() const
+{
+    return impl_->metrics();
+}
+
+shared_ptr< Metrics const > Service::metrics_source() const
+{
+    return impl_->metrics_source();
+}
+
 void Service::on_reconnect( ReconnectEvent::slot_type const& handler )
 {
     impl_->on_reconnect( handler );
@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#if defined( __linux__ )
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/resolver_cache.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "3dprnet/repetier/service_pool.hpp"
+#include "3dprnet/repetier/types.hpp"
+
+using namespace std;
+
+namespace asio = boost::asio;
+
+namespace prnet {
+namespace rep {
+
+static Logger logger( "rep::ServicePool" );
+
+namespace detail {
+
+inline string serverId( Endpoint const& endpoint )
+{
+    return endpoint.host() + ":" + endpoint.port();
+}
+
+inline void pinThread( thread& thread, size_t cpu )
+{
+#if defined( __linux__ )
+    cpu_set_t cpus;
+    CPU_ZERO( &cpus );
+    CPU_SET( cpu, &cpus );
+    if ( pthread_setaffinity_np( thread.native_handle(), sizeof( cpus ), &cpus ) != 0 ) {
+        logger.warning( "unable to pin shard thread to cpu ", cpu );
+    }
+#else
+    logger.warning( "pinning shard threads is not supported on this platform" );
+#endif
+}
+
+} // namespace detail
+
+
+/**
+ * class ServicePool
+ */
+
+struct ServicePool::Shard
+{
+    Shard()
+            : work( asio::make_work_guard( context ) ) {}
+
+    asio::io_context context;
+    asio::executor_work_guard< asio::io_context::executor_type > work;
+    thread runner;
+
+    // only accessed from the shard thread
+    unordered_map< string, unique_ptr< Service > > services;
+    // the one service measuring the lag of the shard, see Service::Watchdog
+    string watchdog;
+
+    atomic< size_t > events {};
+    size_t lastEvents {};
+};
+
+class ServicePool::Impl
+{
+    using Lock = lock_guard< mutex >;
+
+    struct Server
+    {
+        Endpoint endpoint;
+        size_t shard;
+        shared_ptr< atomic< size_t > > events;
+        size_t lastEvents;
+    };
+
+public:
+    explicit Impl( Options&& options )
+            : options_( move( options ) )
+    {
+        auto count = options_.shards > 0 ? options_.shards : max< size_t >( thread::hardware_concurrency(), 1 );
+        for ( size_t i = 0 ; i < count ; ++i ) {
+            shards_.push_back( make_unique< Shard >() );
+        }
+
+        for ( size_t i = 0 ; i < count ; ++i ) {
+            auto& shard = *shards_[ i ];
+            shard.runner = thread( [&shard] { shard.context.run(); } );
+            if ( options_.pinThreads ) {
+                detail::pinThread( shard.runner, i % max< size_t >( thread::hardware_concurrency(), 1 ) );
+            }
+        }
+
+        if ( options_.rebalanceInterval.count() > 0 ) {
+            rebalanceTimer_ = make_unique< asio::steady_timer >( shards_.front()->context );
+            scheduleRebalance();
+        }
+
+        logger.info( "started service pool with ", count, " shards" );
+    }
+
+    ~Impl()
+    {
+        if ( rebalanceTimer_ ) {
+            // a rebalance already due would start services on the shards shut down below
+            promise< void > cancelled;
+            asio::post( shards_.front()->context, [this, &cancelled] {
+                stopping_ = true;
+                rebalanceTimer_->cancel();
+                cancelled.set_value();
+            } );
+            cancelled.get_future().wait();
+        }
+        for ( auto& shard : shards_ ) {
+            asio::post( shard->context, [&shard = *shard] {
+                shard.services.clear();
+                shard.work.reset();
+            } );
+        }
+        for ( auto& shard : shards_ ) {
+            shard->runner.join();
+        }
+    }
+
+    string add( Endpoint&& endpoint )
+    {
+        auto server = detail::serverId( endpoint );
+
+        Lock lock( mutex_ );
+
+        if ( servers_.find( server ) != servers_.end() ) {
+            throw invalid_argument( "server " + server + " is already part of the pool" );
+        }
+
+        auto shard = leastLoaded();
+        auto events = make_shared< atomic< size_t > >( 0 );
+        servers_.emplace( server, Server { endpoint, shard, events, 0 } );
+        start( shard, server, move( endpoint ), move( events ) );
+        return server;
+    }
+
+    void remove( string const& server )
+    {
+        Lock lock( mutex_ );
+
+        auto it = servers_.find( server );
+        if ( it == servers_.end() ) {
+            return;
+        }
+        stop( it->second.shard, server );
+        servers_.erase( it );
+    }
+
+    void dispatch( string const& server, ServiceHandler&& handler )
+    {
+        Lock lock( mutex_ );
+
+        auto it = servers_.find( server );
+        if ( it == servers_.end() ) {
+            throw invalid_argument( "server " + server + " is not part of the pool" );
+        }
+
+        auto& shard = *shards_[ it->second.shard ];
+        asio::post( shard.context, [&shard, server, handler = move( handler )] {
+            auto service = shard.services.find( server );
+            if ( service != shard.services.end() ) {
+                handler( *service->second );
+            }
+        } );
+    }
+
+    vector< ShardStats > stats() const
+    {
+        Lock lock( mutex_ );
+
+        vector< ShardStats > result( shards_.size(), ShardStats {} );
+        for ( auto const& server : servers_ ) {
+            ++result[ server.second.shard ].servers;
+        }
+        for ( size_t i = 0 ; i < shards_.size() ; ++i ) {
+            result[ i ].events = shards_[ i ]->events.load( memory_order_relaxed );
+        }
+        return result;
+    }
+
+    void rebalance()
+    {
+        Lock lock( mutex_ );
+
+        vector< size_t > rates( shards_.size() );
+        size_t total = 0;
+        for ( size_t i = 0 ; i < shards_.size() ; ++i ) {
+            auto events = shards_[ i ]->events.load( memory_order_relaxed );
+            rates[ i ] = events - shards_[ i ]->lastEvents;
+            shards_[ i ]->lastEvents = events;
+            total += rates[ i ];
+        }
+
+        Server* busiest = nullptr;
+        string busiestId;
+        size_t busiestRate = 0;
+        auto hot = static_cast< size_t >( max_element( rates.begin(), rates.end() ) - rates.begin() );
+        auto cold = static_cast< size_t >( min_element( rates.begin(), rates.end() ) - rates.begin() );
+        size_t hotServers = 0;
+        for ( auto& server : servers_ ) {
+            auto events = server.second.events->load( memory_order_relaxed );
+            auto rate = events - server.second.lastEvents;
+            server.second.lastEvents = events;
+            if ( server.second.shard == hot ) {
+                ++hotServers;
+                if ( busiest == nullptr || rate > busiestRate ) {
+                    busiest = &server.second;
+                    busiestId = server.first;
+                    busiestRate = rate;
+                }
+            }
+        }
+
+        double average = static_cast< double >( total ) / shards_.size();
+        if ( hot == cold || busiest == nullptr || hotServers < 2 || rates[ hot ] <= options_.imbalance * average
+             || rates[ cold ] + busiestRate >= rates[ hot ] ) {
+            return;
+        }
+
+        logger.info( "moving server ", busiestId, " from shard ", hot, " to shard ", cold );
+
+        // the service cannot be handed over between the io_contexts, so the new one starts from scratch
+        stop( hot, busiestId );
+        busiest->shard = cold;
+        start( cold, busiestId, Endpoint( busiest->endpoint ), shared_ptr< atomic< size_t > >( busiest->events ) );
+    }
+
+    void on_reconnect( ReconnectEvent::slot_type const& handler ) { on_reconnect_.connect( handler ); }
+    void on_disconnect( DisconnectEvent::slot_type const& handler ) { on_disconnect_.connect( handler ); }
+    void on_temperature( TemperatureEvent::slot_type const& handler ) { on_temperature_.connect( handler ); }
+    void on_printers( PrintersEvent::slot_type const& handler ) { on_printers_.connect( handler ); }
+    void on_config( ConfigEvent::slot_type const& handler ) { on_config_.connect( handler ); }
+    void on_groups( GroupsEvent::slot_type const& handler ) { on_groups_.connect( handler ); }
+    void on_models( ModelsEvent::slot_type const& handler ) { on_models_.connect( handler ); }
+
+private:
+    size_t leastLoaded() const
+    {
+        vector< size_t > servers( shards_.size() );
+        for ( auto const& server : servers_ ) {
+            ++servers[ server.second.shard ];
+        }
+        return static_cast< size_t >( min_element( servers.begin(), servers.end() ) - servers.begin() );
+    }
+
+    void start( size_t index, string const& server, Endpoint&& endpoint, shared_ptr< atomic< size_t > >&& events )
+    {
+        auto& shard = *shards_[ index ];
+        asio::post( shard.context, [this, &shard, server, endpoint = move( endpoint ), events = move( events )] {
+            auto counted = [&shard, events] {
+                events->fetch_add( 1, memory_order_relaxed );
+                shard.events.fetch_add( 1, memory_order_relaxed );
+            };
+
+            auto service = make_unique< Service >( shard.context, endpoint );
+            auto& ref = *service;
+            // servers on the same host, or moved between shards, share their lookups
+            service->resolver( resolver_ );
+            // every login refetches the printers, which may have changed while disconnected
+            service->on_reconnect( [this, server, &ref] {
+                ref.request_printers();
+                on_reconnect_( server );
+            } );
+            service->on_disconnect( [this, server]( auto ec ) { on_disconnect_( server, ec ); } );
+            service->on_temperature( [this, server, counted]( auto slug, auto temp ) {
+                counted();
+                on_temperature_( server, move( slug ), move( temp ) );
+            } );
+            service->on_printers( [this, server, counted]( auto printers ) {
+                counted();
+                on_printers_( server, move( printers ) );
+            } );
+            service->on_config( [this, server, counted]( auto slug, auto config ) {
+                counted();
+                on_config_( server, move( slug ), move( config ) );
+            } );
+            service->on_groups( [this, server, counted]( auto slug, auto groups ) {
+                counted();
+                on_groups_( server, move( slug ), move( groups ) );
+            } );
+            service->on_models( [this, server, counted]( auto slug, auto models ) {
+                counted();
+                on_models_( server, move( slug ), move( models ) );
+            } );
+            shard.services[ server ] = move( service );
+            if ( shard.watchdog.empty() ) {
+                watch( shard, server );
+            }
+        } );
+    }
+
+    void stop( size_t index, string const& server )
+    {
+        auto& shard = *shards_[ index ];
+        asio::post( shard.context, [&shard, server] {
+            shard.services.erase( server );
+            if ( shard.watchdog == server ) {
+                shard.watchdog.clear();
+                if ( !shard.services.empty() ) {
+                    watch( shard, shard.services.begin()->first );
+                }
+            }
+        } );
+    }
+
+    static void watch( Shard& shard, string const& server )
+    {
+        auto watchdog = Service::defaultWatchdog();
+        watchdog.interval = chrono::seconds( 1 );
+        shard.services.at( server )->watchdog( watchdog );
+        shard.watchdog = server;
+    }
+
+    void scheduleRebalance()
+    {
+        rebalanceTimer_->expires_after( options_.rebalanceInterval );
+        rebalanceTimer_->async_wait( [this]( error_code ec ) {
+            if ( ec != make_error_code( asio::error::operation_aborted ) && !stopping_ ) {
+                this->rebalance();
+                this->scheduleRebalance();
+            }
+        } );
+    }
+
+    Options options_;
+    vector< unique_ptr< Shard > > shards_;
+    unordered_map< string, Server > servers_;
+    unique_ptr< asio::steady_timer > rebalanceTimer_;
+    bool stopping_ {}; // on the thread of the first shard, like the timer
+    shared_ptr< ResolverCache > resolver_ { make_shared< ResolverCache >() };
+    mutable mutex mutex_;
+
+    ReconnectEvent on_reconnect_;
+    DisconnectEvent on_disconnect_;
+    TemperatureEvent on_temperature_;
+    PrintersEvent on_printers_;
+    ConfigEvent on_config_;
+    GroupsEvent on_groups_;
+    ModelsEvent on_models_;
+};
+
+ServicePool::Options ServicePool::defaultOptions()
+{
+    return { 0, false, chrono::seconds( 30 ), 1.5 };
+}
+
+ServicePool::ServicePool()
+        : ServicePool( defaultOptions() ) {}
+
+ServicePool::ServicePool( Options options )
+        : impl_( make_unique< Impl >( move( options ) ) ) {}
+
+ServicePool::~ServicePool() = default;
+
+string ServicePool::add( Endpoint endpoint )
+{
+    return impl_->add( move( endpoint ) );
+}
+
+void ServicePool::remove( string const& server )
+{
+    impl_->remove( server );
+}
+
+void ServicePool::dispatch( string const& server, ServiceHandler handler )
+{
+    impl_->dispatch( server, move( handler ) );
+}
+
+vector< ServicePool::ShardStats > ServicePool::stats() const
+{
+    return impl_->stats();
+}
+
+void ServicePool::rebalance()
+{
+    impl_->rebalance();
+}
+
+void ServicePool::on_reconnect( ReconnectEvent::slot_type const& handler )
+{
+    impl_->on_reconnect( handler );
+}
+
+void ServicePool::on_disconnect( DisconnectEvent::slot_type const& handler )
+{
+    impl_->on_disconnect( handler );
+}
+
+void ServicePool::on_temperature( TemperatureEvent::slot_type const& handler )
+{
+    impl_->on_temperature( handler );
+}
+
+void ServicePool::on_printers( PrintersEvent::slot_type const& handler )
+{
+    impl_->on_printers( handler );
+}
+
+void ServicePool::on_config( ConfigEvent::slot_type const& handler )
+{
+    impl_->on_config( handler );
+}
+
+void ServicePool::on_groups( GroupsEvent::slot_type const& handler )
+{
+    impl_->on_groups( handler );
+}
+
+void ServicePool::on_models( ModelsEvent::slot_type const& handler )
+{
+    impl_->on_models( handler );
+}
+
+} // namespace rep
+} // namespace prnet
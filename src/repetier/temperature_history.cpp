@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "3dprnet/repetier/service.hpp"
+#include "3dprnet/repetier/temperature_history.hpp"
+#include "3dprnet/repetier/types.hpp"
+
+using namespace std;
+
+namespace prnet {
+namespace rep {
+
+namespace detail {
+
+/**
+ * class RingBuffer
+ */
+
+template< typename T >
+class RingBuffer
+{
+public:
+    explicit RingBuffer( size_t capacity )
+            : values_( capacity ) {}
+
+    size_t size() const { return size_; }
+
+    T const& operator[]( size_t index ) const
+    {
+        return values_[ ( head_ + index ) % values_.size() ];
+    }
+
+    void push( T const& value )
+    {
+        if ( values_.empty() ) {
+            return;
+        }
+
+        values_[ ( head_ + size_ ) % values_.size() ] = value;
+        if ( size_ < values_.size() ) {
+            ++size_;
+        } else {
+            head_ = ( head_ + 1 ) % values_.size();
+        }
+    }
+
+    void clear()
+    {
+        head_ = size_ = 0;
+    }
+
+    /**
+     * Copies all elements with from <= time <= to, relying on elements being pushed in chronological order.
+     */
+    template< typename Time, typename Out, typename Convert >
+    size_t copy( Time from, Time to, Out* out, size_t count, Convert&& convert ) const
+    {
+        size_t first = 0;
+        size_t last = size_;
+        while ( first < last ) {
+            auto middle = first + ( last - first ) / 2;
+            if ( ( *this )[ middle ].time < from ) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+
+        size_t copied = 0;
+        for ( auto index = first ; index < size_ && copied < count && ( *this )[ index ].time <= to ; ++index ) {
+            out[ copied++ ] = convert( ( *this )[ index ] );
+        }
+        return copied;
+    }
+
+private:
+    vector< T > values_;
+    size_t head_ {};
+    size_t size_ {};
+};
+
+
+/**
+ * class Downsampler
+ */
+
+class Downsampler
+{
+    using Clock = TemperatureHistory::Clock;
+    using Aggregate = TemperatureHistory::Aggregate;
+
+public:
+    Downsampler( Clock::duration interval, size_t capacity )
+            : interval_( interval )
+            , buckets_( capacity ) {}
+
+    RingBuffer< Aggregate > const& buckets() const { return buckets_; }
+
+    void add( Clock::time_point time, double wanted, double actual )
+    {
+        auto bucket = time - ( time.time_since_epoch() % interval_ );
+        if ( current_.count > 0 && bucket != current_.time ) {
+            flush();
+        }
+        if ( current_.count == 0 ) {
+            current_ = { bucket, 0.0, numeric_limits< double >::max(), numeric_limits< double >::lowest(), 0.0, 0 };
+        }
+
+        current_.wanted += wanted;
+        current_.minimum = min( current_.minimum, actual );
+        current_.maximum = max( current_.maximum, actual );
+        current_.average += actual;
+        ++current_.count;
+    }
+
+    void clear()
+    {
+        buckets_.clear();
+        current_.count = 0;
+    }
+
+private:
+    void flush()
+    {
+        current_.wanted /= current_.count;
+        current_.average /= current_.count;
+        buckets_.push( current_ );
+        current_.count = 0;
+    }
+
+    Clock::duration interval_;
+    RingBuffer< Aggregate > buckets_;
+    Aggregate current_ {};
+};
+
+
+/**
+ * struct ControllerHistory
+ */
+
+struct ControllerHistory
+{
+    explicit ControllerHistory( TemperatureHistory::Capacity const& capacity )
+            : samples( capacity.raw )
+            , tenSeconds( chrono::seconds( 10 ), capacity.tenSeconds )
+            , oneMinute( chrono::minutes( 1 ), capacity.oneMinute ) {}
+
+    RingBuffer< TemperatureHistory::Sample > samples;
+    Downsampler tenSeconds;
+    Downsampler oneMinute;
+    TemperatureHistory::Clock::time_point latest { TemperatureHistory::Clock::time_point::min() };
+};
+
+} // namespace detail
+
+
+/**
+ * class TemperatureHistory
+ */
+
+class TemperatureHistory::Impl
+{
+    using Lock = lock_guard< mutex >;
+    using Controllers = unordered_map< string, unique_ptr< detail::ControllerHistory > >;
+
+public:
+    explicit Impl( Capacity&& capacity )
+            : capacity_( move( capacity ) ) {}
+
+    void append( string const& slug, Temperature const& temp, Clock::time_point time )
+    {
+        // the controller name fits into the small string buffer, so this does not allocate
+        auto controller = temp.controller_name();
+
+        Lock lock( mutex_ );
+
+        auto& controllers = printers_[ slug ];
+        auto& history = controllers[ controller ];
+        if ( !history ) {
+            history = make_unique< detail::ControllerHistory >( capacity_ );
+        }
+
+        // the system clock may be set back, but the ring buffers are searched by time
+        time = max( time, history->latest );
+        history->latest = time;
+
+        history->samples.push( { time, temp.wanted(), temp.actual() } );
+        history->tenSeconds.add( time, temp.wanted(), temp.actual() );
+        history->oneMinute.add( time, temp.wanted(), temp.actual() );
+    }
+
+    size_t samples( string const& slug, string const& controller, Clock::time_point from, Clock::time_point to,
+                    Sample* out, size_t count ) const
+    {
+        Lock lock( mutex_ );
+
+        auto history = find( slug, controller );
+        if ( history == nullptr ) {
+            return 0;
+        }
+        return history->samples.copy( from, to, out, count, []( Sample const& sample ) { return sample; } );
+    }
+
+    size_t aggregates( string const& slug, string const& controller, Resolution resolution, Clock::time_point from,
+                       Clock::time_point to, Aggregate* out, size_t count ) const
+    {
+        Lock lock( mutex_ );
+
+        auto history = find( slug, controller );
+        if ( history == nullptr ) {
+            return 0;
+        }
+
+        auto identity = []( Aggregate const& aggregate ) { return aggregate; };
+        switch ( resolution ) {
+            case TemperatureHistory::raw:
+                return history->samples.copy( from, to, out, count, []( Sample const& sample ) {
+                    return Aggregate { sample.time, sample.wanted, sample.actual, sample.actual, sample.actual, 1 };
+                } );
+            case TemperatureHistory::tenSeconds:
+                return history->tenSeconds.buckets().copy( from, to, out, count, identity );
+            case TemperatureHistory::oneMinute:
+                return history->oneMinute.buckets().copy( from, to, out, count, identity );
+        }
+        return 0;
+    }
+
+    void clear()
+    {
+        Lock lock( mutex_ );
+
+        for ( auto& printer : printers_ ) {
+            for ( auto& controller : printer.second ) {
+                controller.second->samples.clear();
+                controller.second->tenSeconds.clear();
+                controller.second->oneMinute.clear();
+                controller.second->latest = Clock::time_point::min();
+            }
+        }
+    }
+
+private:
+    detail::ControllerHistory const* find( string const& slug, string const& controller ) const
+    {
+        auto printer = printers_.find( slug );
+        if ( printer == printers_.end() ) {
+            return nullptr;
+        }
+        auto history = printer->second.find( controller );
+        return history != printer->second.end() ? history->second.get() : nullptr;
+    }
+
+    Capacity capacity_;
+    unordered_map< string, Controllers > printers_;
+    mutable mutex mutex_;
+};
+
+size_t TemperatureHistory::budget( Capacity const& capacity )
+{
+    return sizeof( detail::ControllerHistory )
+           + capacity.raw * sizeof( Sample )
+           + ( capacity.tenSeconds + capacity.oneMinute ) * sizeof( Aggregate );
+}
+
+TemperatureHistory::TemperatureHistory()
+        : TemperatureHistory( Capacity() ) {}
+
+TemperatureHistory::TemperatureHistory( Capacity capacity )
+        : impl_( make_shared< Impl >( move( capacity ) ) ) {}
+
+TemperatureHistory::~TemperatureHistory() = default;
+
+void TemperatureHistory::attach( Service& service )
+{
+    // the slot is tracked so that it is disconnected with the history, and a reading that is being appended on
+    // another thread meanwhile keeps the object alive until it is done
+    weak_ptr< Impl > self( impl_ );
+    service.on_temperature( Service::TemperatureEvent::slot_type(
+            [impl = impl_.get()]( auto slug, auto temp ) { impl->append( slug, temp, Clock::now() ); } )
+                    .track_foreign( self ) );
+}
+
+void TemperatureHistory::append( string const& slug, Temperature const& temp, Clock::time_point time )
+{
+    impl_->append( slug, temp, time );
+}
+
+size_t TemperatureHistory::samples( string const& slug, string const& controller, Clock::time_point from,
+                                    Clock::time_point to, Sample* out, size_t count ) const
+{
+    return impl_->samples( slug, controller, from, to, out, count );
+}
+
+size_t TemperatureHistory::aggregates( string const& slug, string const& controller, Resolution resolution,
+                                       Clock::time_point from, Clock::time_point to, Aggregate* out,
+                                       size_t count ) const
+{
+    return impl_->aggregates( slug, controller, resolution, from, to, out, count );
+}
+
+void TemperatureHistory::clear()
+{
+    impl_->clear();
+}
+
+} // namespace rep
+} // namespace prnet
@@ -0,0 +1,773 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "3dprnet/repetier/temperature_log.hpp"
+#include "3dprnet/repetier/types.hpp"
+
+using namespace std;
+
+namespace prnet {
+namespace rep {
+
+static Logger logger( "rep::TempLog" );
+
+namespace detail {
+
+static char const fileMagic[ 8 ] = { 'P', 'R', 'N', 'E', 'T', 'T', 'L', '1' };
+static uint32_t const blockMagic = 0x424c4b31; // "BLK1"
+
+inline int64_t toMillis( TemperatureLogWriter::Clock::time_point time )
+{
+    return chrono::duration_cast< chrono::milliseconds >( time.time_since_epoch() ).count();
+}
+
+inline TemperatureLogReader::Clock::time_point fromMillis( int64_t millis )
+{
+    return TemperatureLogReader::Clock::time_point( chrono::duration_cast< TemperatureLogReader::Clock::duration >(
+            chrono::milliseconds( millis ) ) );
+}
+
+inline uint64_t toBits( double value )
+{
+    uint64_t result;
+    memcpy( &result, &value, sizeof( result ) );
+    return result;
+}
+
+inline double fromBits( uint64_t bits )
+{
+    double result;
+    memcpy( &result, &bits, sizeof( result ) );
+    return result;
+}
+
+inline unsigned leadingZeros( uint64_t value )
+{
+    return value == 0 ? 64 : static_cast< unsigned >( __builtin_clzll( value ) );
+}
+
+inline unsigned trailingZeros( uint64_t value )
+{
+    return value == 0 ? 64 : static_cast< unsigned >( __builtin_ctzll( value ) );
+}
+
+
+/**
+ * class BitWriter
+ */
+
+class BitWriter
+{
+public:
+    vector< uint8_t > const& bytes() const { return bytes_; }
+
+    void write( uint64_t value, unsigned bits )
+    {
+        while ( bits > 0 ) {
+            if ( free_ == 0 ) {
+                bytes_.push_back( 0 );
+                free_ = 8;
+            }
+            auto chunk = min( bits, free_ );
+            auto part = static_cast< uint8_t >( ( value >> ( bits - chunk ) ) & ( ( 1u << chunk ) - 1 ) );
+            bytes_.back() |= static_cast< uint8_t >( part << ( free_ - chunk ) );
+            free_ -= chunk;
+            bits -= chunk;
+        }
+    }
+
+    void clear()
+    {
+        bytes_.clear();
+        free_ = 0;
+    }
+
+private:
+    vector< uint8_t > bytes_;
+    unsigned free_ {};
+};
+
+
+/**
+ * class BitReader
+ */
+
+class BitReader
+{
+public:
+    BitReader( uint8_t const* data, size_t size )
+            : data_( data )
+            , size_( size ) {}
+
+    uint64_t read( unsigned bits )
+    {
+        uint64_t result = 0;
+        while ( bits > 0 ) {
+            if ( position_ / 8 >= size_ ) {
+                throw runtime_error( "truncated temperature log block" );
+            }
+            auto available = static_cast< unsigned >( 8 - position_ % 8 );
+            auto chunk = min( bits, available );
+            auto byte = data_[ position_ / 8 ];
+            auto part = ( byte >> ( available - chunk ) ) & ( ( 1u << chunk ) - 1 );
+            result = ( result << chunk ) | part;
+            position_ += chunk;
+            bits -= chunk;
+        }
+        return result;
+    }
+
+    bool bit() { return read( 1 ) != 0; }
+
+private:
+    uint8_t const* data_;
+    size_t size_;
+    size_t position_ {};
+};
+
+
+/**
+ * class TimestampEncoder
+ */
+
+class TimestampEncoder
+{
+public:
+    BitWriter const& stream() const { return stream_; }
+
+    void add( int64_t time )
+    {
+        if ( count_++ == 0 ) {
+            stream_.write( static_cast< uint64_t >( time ), 64 );
+        } else {
+            auto delta = time - last_;
+            auto dod = delta - lastDelta_;
+            if ( dod == 0 ) {
+                stream_.write( 0, 1 );
+            } else if ( dod >= -64 && dod <= 63 ) {
+                stream_.write( 0x2, 2 );
+                stream_.write( static_cast< uint64_t >( dod ), 7 );
+            } else if ( dod >= -256 && dod <= 255 ) {
+                stream_.write( 0x6, 3 );
+                stream_.write( static_cast< uint64_t >( dod ), 9 );
+            } else if ( dod >= -2048 && dod <= 2047 ) {
+                stream_.write( 0xe, 4 );
+                stream_.write( static_cast< uint64_t >( dod ), 12 );
+            } else {
+                stream_.write( 0xf, 4 );
+                stream_.write( static_cast< uint64_t >( dod ), 64 );
+            }
+            lastDelta_ = delta;
+        }
+        last_ = time;
+    }
+
+private:
+    BitWriter stream_;
+    size_t count_ {};
+    int64_t last_ {};
+    int64_t lastDelta_ {};
+};
+
+
+/**
+ * class TimestampDecoder
+ */
+
+class TimestampDecoder
+{
+public:
+    TimestampDecoder( uint8_t const* data, size_t size )
+            : stream_( data, size ) {}
+
+    int64_t next()
+    {
+        if ( count_++ == 0 ) {
+            return last_ = static_cast< int64_t >( stream_.read( 64 ) );
+        }
+
+        int64_t dod = 0;
+        if ( !stream_.bit() ) {
+            dod = 0;
+        } else if ( !stream_.bit() ) {
+            dod = signExtend( stream_.read( 7 ), 7 );
+        } else if ( !stream_.bit() ) {
+            dod = signExtend( stream_.read( 9 ), 9 );
+        } else if ( !stream_.bit() ) {
+            dod = signExtend( stream_.read( 12 ), 12 );
+        } else {
+            dod = static_cast< int64_t >( stream_.read( 64 ) );
+        }
+        lastDelta_ += dod;
+        return last_ += lastDelta_;
+    }
+
+private:
+    static int64_t signExtend( uint64_t value, unsigned bits )
+    {
+        auto sign = uint64_t( 1 ) << ( bits - 1 );
+        return static_cast< int64_t >( ( value ^ sign ) - sign );
+    }
+
+    BitReader stream_;
+    size_t count_ {};
+    int64_t last_ {};
+    int64_t lastDelta_ {};
+};
+
+
+/**
+ * class ValueEncoder
+ */
+
+class ValueEncoder
+{
+public:
+    BitWriter const& stream() const { return stream_; }
+
+    void add( double value )
+    {
+        auto bits = toBits( value );
+        if ( count_++ == 0 ) {
+            stream_.write( bits, 64 );
+        } else {
+            auto xored = bits ^ last_;
+            if ( xored == 0 ) {
+                stream_.write( 0, 1 );
+            } else {
+                auto leading = min( leadingZeros( xored ), 31u );
+                auto trailing = trailingZeros( xored );
+                if ( count_ > 2 && leading >= leading_ && trailing >= trailing_ ) {
+                    stream_.write( 0x2, 2 );
+                    stream_.write( xored >> trailing_, 64 - leading_ - trailing_ );
+                } else {
+                    auto meaningful = 64 - leading - trailing;
+                    stream_.write( 0x3, 2 );
+                    stream_.write( leading, 5 );
+                    stream_.write( meaningful & 0x3f, 6 ); // 64 is stored as 0
+                    stream_.write( xored >> trailing, meaningful );
+                    leading_ = leading;
+                    trailing_ = trailing;
+                }
+            }
+        }
+        last_ = bits;
+    }
+
+private:
+    BitWriter stream_;
+    size_t count_ {};
+    uint64_t last_ {};
+    unsigned leading_ {};
+    unsigned trailing_ {};
+};
+
+
+/**
+ * class ValueDecoder
+ */
+
+class ValueDecoder
+{
+public:
+    ValueDecoder( uint8_t const* data, size_t size )
+            : stream_( data, size ) {}
+
+    double next()
+    {
+        if ( count_++ == 0 ) {
+            last_ = stream_.read( 64 );
+        } else if ( stream_.bit() ) {
+            if ( stream_.bit() ) {
+                leading_ = static_cast< unsigned >( stream_.read( 5 ) );
+                auto meaningful = static_cast< unsigned >( stream_.read( 6 ) );
+                trailing_ = 64 - leading_ - ( meaningful == 0 ? 64 : meaningful );
+            }
+            last_ ^= stream_.read( 64 - leading_ - trailing_ ) << trailing_;
+        }
+        return fromBits( last_ );
+    }
+
+private:
+    BitReader stream_;
+    size_t count_ {};
+    uint64_t last_ {};
+    unsigned leading_ {};
+    unsigned trailing_ {};
+};
+
+
+/**
+ * struct Block
+ */
+
+struct Block
+{
+    string slug;
+    string controller;
+    chrono::steady_clock::time_point opened;
+    int64_t first {};
+    int64_t last {};
+    uint32_t count {};
+    TimestampEncoder times;
+    ValueEncoder wanted;
+    ValueEncoder actual;
+};
+
+template< typename T >
+void writeValue( ostream& os, T value )
+{
+    uint8_t bytes[ sizeof( T ) ];
+    for ( size_t i = 0 ; i < sizeof( T ) ; ++i ) {
+        bytes[ i ] = static_cast< uint8_t >( static_cast< uint64_t >( value ) >> ( 8 * i ) );
+    }
+    os.write( reinterpret_cast< char const* >( bytes ), sizeof( T ) );
+}
+
+template< typename T >
+bool readValue( istream& is, T& value )
+{
+    uint8_t bytes[ sizeof( T ) ];
+    if ( !is.read( reinterpret_cast< char* >( bytes ), sizeof( T ) ) ) {
+        return false;
+    }
+    uint64_t result = 0;
+    for ( size_t i = 0 ; i < sizeof( T ) ; ++i ) {
+        result |= static_cast< uint64_t >( bytes[ i ] ) << ( 8 * i );
+    }
+    value = static_cast< T >( result );
+    return true;
+}
+
+inline void writeString( ostream& os, string const& value )
+{
+    writeValue< uint16_t >( os, static_cast< uint16_t >( value.size() ) );
+    os.write( value.data(), value.size() );
+}
+
+inline bool readString( istream& is, string& value )
+{
+    uint16_t size;
+    if ( !readValue( is, size ) ) {
+        return false;
+    }
+    value.resize( size );
+    return size == 0 || is.read( &value[ 0 ], size );
+}
+
+inline void writeStream( ostream& os, BitWriter const& stream )
+{
+    os.write( reinterpret_cast< char const* >( stream.bytes().data() ), stream.bytes().size() );
+}
+
+/**
+ * Block layout: magic, slug, controller, first and last timestamp in ms, number of readings, the sizes of the three
+ * columns and the columns themselves. All integers are little endian.
+ */
+inline void writeBlock( ostream& os, Block const& block )
+{
+    writeValue< uint32_t >( os, blockMagic );
+    writeString( os, block.slug );
+    writeString( os, block.controller );
+    writeValue< int64_t >( os, block.first );
+    writeValue< int64_t >( os, block.last );
+    writeValue< uint32_t >( os, block.count );
+    writeValue< uint32_t >( os, static_cast< uint32_t >( block.times.stream().bytes().size() ) );
+    writeValue< uint32_t >( os, static_cast< uint32_t >( block.wanted.stream().bytes().size() ) );
+    writeValue< uint32_t >( os, static_cast< uint32_t >( block.actual.stream().bytes().size() ) );
+    writeStream( os, block.times.stream() );
+    writeStream( os, block.wanted.stream() );
+    writeStream( os, block.actual.stream() );
+}
+
+struct BlockHeader
+{
+    string slug;
+    string controller;
+    int64_t first {};
+    int64_t last {};
+    uint32_t count {};
+    uint32_t timesSize {};
+    uint32_t wantedSize {};
+    uint32_t actualSize {};
+
+    size_t columns() const { return size_t( timesSize ) + wantedSize + actualSize; }
+};
+
+/**
+ * Reads the header of the block at the position of is. Returns false if the block does not end before end, which is
+ * what a crash while writing leaves behind, and throws if there is no block at all.
+ */
+inline bool readHeader( istream& is, uint64_t end, BlockHeader& header )
+{
+    uint32_t magic;
+    if ( !readValue( is, magic ) ) {
+        return false;
+    }
+    if ( magic != blockMagic ) {
+        throw runtime_error( "corrupt temperature log" );
+    }
+    if ( !readString( is, header.slug ) || !readString( is, header.controller ) || !readValue( is, header.first )
+         || !readValue( is, header.last ) || !readValue( is, header.count ) || !readValue( is, header.timesSize )
+         || !readValue( is, header.wantedSize ) || !readValue( is, header.actualSize ) ) {
+        return false;
+    }
+    return static_cast< uint64_t >( is.tellg() ) + header.columns() <= end;
+}
+
+/**
+ * Returns the size of the log up to the end of its last complete block, throws if it is not a temperature log.
+ */
+inline uint64_t completeSize( string const& localPath, uint64_t size )
+{
+    ifstream input( localPath.c_str(), ios::in | ios::binary );
+    char magic[ sizeof( fileMagic ) ];
+    if ( !input.read( magic, sizeof( magic ) ) || memcmp( magic, fileMagic, sizeof( magic ) ) != 0 ) {
+        throw system_error( make_error_code( errc::invalid_argument ), "not a temperature log: " + localPath );
+    }
+
+    uint64_t result = sizeof( fileMagic );
+    BlockHeader header;
+    try {
+        while ( result < size && readHeader( input, size, header ) ) {
+            input.seekg( header.columns(), ios::cur );
+            result = static_cast< uint64_t >( input.tellg() );
+        }
+    } catch ( runtime_error const& ) {
+        // no block starts where the last one ended, nothing behind it can be found anymore
+    }
+    return result;
+}
+
+} // namespace detail
+
+
+/**
+ * class TemperatureLogWriter
+ */
+
+class TemperatureLogWriter::Impl
+{
+    using Lock = unique_lock< mutex >;
+    using Steady = chrono::steady_clock;
+    using Controllers = map< pair< Temperature::Controller, size_t >, unique_ptr< detail::Block > >;
+
+public:
+    Impl( filesystem::path const& path, size_t blockSize, chrono::seconds maxBlockAge )
+            : path_( path )
+            , localPath_( filesystem::native_path( path ) )
+            , blockSize_( blockSize )
+            , maxBlockAge_( maxBlockAge )
+    {
+        auto size = filesystem::exists( path ) ? filesystem::file_size( path ) : 0;
+        if ( size > 0 ) {
+            // appending blocks to anything else would corrupt it, and behind a block torn by a crash they could not
+            // be found
+            size_ = detail::completeSize( localPath_, size );
+            if ( size_ < size ) {
+                logger.warning( "cutting off ", size - size_, " bytes of an incomplete block at the end of ",
+                                localPath_ );
+                filesystem::resize_file( path, size_ );
+            }
+        }
+        output_.open( localPath_.c_str(), ios::out | ios::app | ios::binary );
+        if ( !output_ ) {
+            throw system_error( make_error_code( errc::io_error ), "unable to open temperature log " + localPath_ );
+        }
+        if ( size_ == 0 ) {
+            output_.write( detail::fileMagic, sizeof( detail::fileMagic ) );
+            output_.flush();
+            size_ = sizeof( detail::fileMagic );
+        }
+
+        thread_ = thread( [this] { this->run(); } );
+    }
+
+    ~Impl()
+    {
+        flush();
+        {
+            Lock lock( mutex_ );
+            stopped_ = true;
+        }
+        wakeup_.notify_all();
+        thread_.join();
+    }
+
+    void append( string const& slug, Temperature const& temp, Clock::time_point time )
+    {
+        auto millis = detail::toMillis( time );
+
+        Lock lock( mutex_ );
+
+        // only the first reading of a printer or a block allocates
+        auto& block = open_[ slug ][ { temp.controller(), temp.controller_index() } ];
+        if ( !block ) {
+            block = make_unique< detail::Block >();
+            block->slug = slug;
+            block->controller = temp.controller_name();
+            block->opened = Steady::now();
+            block->first = millis;
+            if ( maxBlockAge_.count() > 0 ) {
+                wakeup_.notify_all();
+            }
+        }
+
+        block->times.add( millis );
+        block->wanted.add( temp.wanted() );
+        block->actual.add( temp.actual() );
+        block->last = millis;
+        if ( ++block->count >= blockSize_ ) {
+            queued_.push_back( move( block ) );
+            wakeup_.notify_all();
+        }
+    }
+
+    void flush()
+    {
+        Lock lock( mutex_ );
+
+        for ( auto& controllers : open_ ) {
+            for ( auto& block : controllers.second ) {
+                if ( block.second ) {
+                    queued_.push_back( move( block.second ) );
+                }
+            }
+            controllers.second.clear();
+        }
+        wakeup_.notify_all();
+        drained_.wait( lock, [this] { return queued_.empty() && !writing_; } );
+    }
+
+private:
+    /**
+     * Queues the blocks that have been open for maxBlockAge and returns when the next one will have been.
+     */
+    Steady::time_point seal_expired()
+    {
+        auto next = Steady::time_point::max();
+        if ( maxBlockAge_.count() == 0 ) {
+            return next;
+        }
+
+        auto now = Steady::now();
+        for ( auto& controllers : open_ ) {
+            for ( auto& block : controllers.second ) {
+                if ( !block.second ) {
+                    continue;
+                }
+                auto expires = block.second->opened + maxBlockAge_;
+                if ( expires <= now ) {
+                    queued_.push_back( move( block.second ) );
+                } else {
+                    next = min( next, expires );
+                }
+            }
+        }
+        return next;
+    }
+
+    void run()
+    {
+        Lock lock( mutex_ );
+        while ( true ) {
+            auto next = seal_expired();
+            if ( queued_.empty() ) {
+                if ( stopped_ ) {
+                    return;
+                }
+                // woken up for full blocks, new blocks that may expire earlier and stopping
+                if ( next == Steady::time_point::max() ) {
+                    wakeup_.wait( lock );
+                } else {
+                    wakeup_.wait_until( lock, next );
+                }
+                continue;
+            }
+
+            auto blocks = move( queued_ );
+            queued_.clear();
+            writing_ = true;
+            lock.unlock();
+
+            ostringstream buffer;
+            for ( auto const& block : blocks ) {
+                detail::writeBlock( buffer, *block );
+            }
+            auto data = buffer.str();
+            if ( output_.write( data.data(), data.size() ) && output_.flush() ) {
+                size_ += data.size();
+            } else {
+                logger.error( "error writing temperature log, ", blocks.size(), " blocks lost" );
+                discard();
+            }
+
+            lock.lock();
+            writing_ = false;
+            drained_.notify_all();
+        }
+    }
+
+    /**
+     * Cuts off what a failed write left of its blocks, so that the blocks written later can still be found.
+     */
+    void discard()
+    {
+        output_.close();
+        try {
+            filesystem::resize_file( path_, size_ );
+        } catch ( exception const& e ) {
+            logger.error( "unable to cut off incomplete blocks of ", localPath_, ": ", e.what() );
+        }
+        output_.clear();
+        output_.open( localPath_.c_str(), ios::out | ios::app | ios::binary );
+    }
+
+    filesystem::path path_;
+    string localPath_;
+    size_t blockSize_;
+    chrono::seconds maxBlockAge_;
+    ofstream output_;
+    uint64_t size_ {}; // of the complete blocks written so far
+    unordered_map< string, Controllers > open_;
+    deque< unique_ptr< detail::Block > > queued_;
+    bool writing_ {};
+    bool stopped_ {};
+    mutex mutex_;
+    condition_variable wakeup_;
+    condition_variable drained_;
+    thread thread_;
+};
+
+TemperatureLogWriter::TemperatureLogWriter( filesystem::path const& path, size_t blockSize,
+                                            chrono::seconds maxBlockAge )
+        : impl_( make_shared< Impl >( path, blockSize, maxBlockAge ) ) {}
+
+TemperatureLogWriter::~TemperatureLogWriter() = default;
+
+void TemperatureLogWriter::attach( Service& service )
+{
+    // tracked like the slot of TemperatureHistory::attach()
+    weak_ptr< Impl > self( impl_ );
+    service.on_temperature( Service::TemperatureEvent::slot_type(
+            [impl = impl_.get()]( auto slug, auto temp ) { impl->append( slug, temp, Clock::now() ); } )
+                    .track_foreign( self ) );
+}
+
+void TemperatureLogWriter::append( string const& slug, Temperature const& temp, Clock::time_point time )
+{
+    impl_->append( slug, temp, time );
+}
+
+void TemperatureLogWriter::flush()
+{
+    impl_->flush();
+}
+
+
+/**
+ * class TemperatureLogReader
+ */
+
+class TemperatureLogReader::Impl
+{
+public:
+    explicit Impl( filesystem::path const& path )
+    {
+        auto localPath = filesystem::native_path( path );
+        input_.open( localPath.c_str(), ios::in | ios::binary );
+
+        char magic[ sizeof( detail::fileMagic ) ];
+        if ( !input_ || !input_.read( magic, sizeof( magic ) ) || memcmp( magic, detail::fileMagic, sizeof( magic ) ) != 0 ) {
+            throw system_error( make_error_code( errc::io_error ), "unable to open temperature log " + localPath );
+        }
+    }
+
+    void scan( string const* slug, string const* controller, Clock::time_point from, Clock::time_point to,
+               Handler const& handler )
+    {
+        auto first = detail::toMillis( from );
+        auto last = detail::toMillis( to );
+
+        // blocks appended while scanning are left for the next scan
+        input_.clear();
+        input_.seekg( 0, ios::end );
+        auto end = static_cast< uint64_t >( input_.tellg() );
+        input_.seekg( sizeof( detail::fileMagic ) );
+
+        detail::BlockHeader header;
+        vector< uint8_t > columns;
+        while ( static_cast< uint64_t >( input_.tellg() ) < end ) {
+            if ( !detail::readHeader( input_, end, header ) ) {
+                // torn by a crash while writing, or still being written
+                logger.warning( "ignoring an incomplete block at the end of the temperature log" );
+                return;
+            }
+            auto size = header.columns();
+
+            if ( header.last < first || header.first > last
+                 || ( slug != nullptr && *slug != header.slug )
+                 || ( controller != nullptr && *controller != header.controller ) ) {
+                input_.seekg( size, ios::cur );
+                continue;
+            }
+
+            columns.resize( size );
+            if ( !input_.read( reinterpret_cast< char* >( columns.data() ), size ) ) {
+                throw runtime_error( "truncated temperature log" );
+            }
+
+            detail::TimestampDecoder times( columns.data(), header.timesSize );
+            detail::ValueDecoder wanted( columns.data() + header.timesSize, header.wantedSize );
+            detail::ValueDecoder actual( columns.data() + header.timesSize + header.wantedSize, header.actualSize );
+            for ( uint32_t i = 0 ; i < header.count ; ++i ) {
+                auto time = times.next();
+                Point point { detail::fromMillis( time ), wanted.next(), actual.next() };
+                if ( time > last ) {
+                    break;
+                }
+                if ( time >= first ) {
+                    handler( header.slug, header.controller, point );
+                }
+            }
+        }
+    }
+
+private:
+    ifstream input_;
+};
+
+TemperatureLogReader::TemperatureLogReader( filesystem::path const& path )
+        : impl_( make_unique< Impl >( path ) ) {}
+
+TemperatureLogReader::~TemperatureLogReader() = default;
+
+void TemperatureLogReader::scan( Clock::time_point from, Clock::time_point to, Handler const& handler )
+{
+    impl_->scan( nullptr, nullptr, from, to, handler );
+}
+
+void TemperatureLogReader::scan( string const& slug, string const& controller, Clock::time_point from,
+                                 Clock::time_point to, Handler const& handler )
+{
+    impl_->scan( &slug, &controller, from, to, handler );
+}
+
+} // namespace rep
+} // namespace prnet
@@ -1,36 +1,30 @@
-#include <ostream>
-#include <unordered_map>
 #include <utility>
 
-#include <boost/asio/connect.hpp>
 #include <boost/asio/spawn.hpp>
-#include <boost/asio/streambuf.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/core/buffers_to_string.hpp>
 #include <boost/beast/core/error.hpp>
-#include <boost/beast/core/file.hpp>
 #include <boost/beast/core/multi_buffer.hpp>
 #include <boost/beast/http/dynamic_body.hpp>
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/read.hpp>
 #include <boost/beast/http/write.hpp>
 #include <boost/beast/version.hpp>
-#include <boost/uuid/uuid.hpp>
-#include <boost/uuid/uuid_generators.hpp>
-#include <boost/uuid/uuid_io.hpp>
 
-#include "3dprnet/core/encoding.hpp"
+#include "3dprnet/core/allocations.hpp"
 #include "3dprnet/core/error.hpp"
 #include "3dprnet/core/logging.hpp"
-#include "3dprnet/core/string_view.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/resolver_cache.hpp"
 #include "3dprnet/repetier/types.hpp"
 #include "3dprnet/repetier/upload.hpp"
+#include "repetier/happy_eyeballs.hpp"
+#include "repetier/upload_body.hpp"
 
 using namespace std;
 
 namespace asio = boost::asio;
 namespace http = boost::beast::http;
-namespace uuids = boost::uuids;
 
 using tcp = asio::ip::tcp;
 
@@ -39,149 +33,6 @@ namespace rep {
 
 static Logger logger( "rep::Upload" );
 
-namespace detail {
-
-/**
- * struct upload_body
- */
-
-struct upload_body
-{
-    class value_type;
-    class writer;
-};
-
-
-/**
- * class upload_body::value_type
- */
-
-class upload_body::value_type
-{
-    friend class writer;
-
-public:
-    using fields_type = unordered_map< string_view, string_view >;
-
-    void set( string_view name, string_view value )
-    {
-        fields_.emplace( name, value );
-    }
-
-    void set( filesystem::path const& path )
-    {
-        path_ = &path;
-    }
-
-private:
-    fields_type fields_;
-    filesystem::path const* path_ {};
-};
-
-
-/**
- * class upload_body::writer
- */
-
-class upload_body::writer
-{
-    static constexpr size_t blockSize { 8192 };
-
-public:
-    using const_buffers_type = asio::streambuf::const_buffers_type;
-
-    template< bool isRequest, typename Fields >
-    writer( http::message< isRequest, upload_body, Fields >& request )
-            : body_ { request.body() }
-    {
-        request.set( http::field::content_type, "multipart/form-data; boundary=" + uuids::to_string( boundary_ ) );
-    }
-
-    void init( boost::beast::error_code& ec )
-    {
-        ec.assign( 0, ec.category() );
-
-        field_ = body_.fields_.cbegin();
-        if ( body_.path_ ) {
-            auto localPath = filesystem::native_path( *body_.path_ );
-            file_.open( localPath.c_str(), boost::beast::file_mode::read, ec );
-        }
-    }
-
-    boost::optional< pair< const_buffers_type, bool > > get( boost::beast::error_code& ec )
-    {
-        buffer_.consume( buffer_.size() );
-
-        bool more { true };
-        switch ( state_ ) {
-            case 0: {
-                if ( field_ != body_.fields_.cend() ) {
-                    ostream os { &buffer_ };
-                    os << "--" << boundary_ << "\r\n"
-                       << "Content-Disposition: form-data; name=\"" << field_->first << "\"\r\n"
-                       << "Content-Type: text/plain; charset=utf-8\r\n\r\n" << enc::ToUtf8( field_->second ) << "\r\n";
-                    ++field_;
-                    break;
-                }
-                ++state_;
-                // fall through
-            }
-
-            case 1: {
-                ++state_;
-                if ( file_.is_open() ) {
-                    ostream os { &buffer_ };
-                    os << "--" << boundary_ << "\r\n"
-                       << "Content-Disposition: form-data; name=\"filename\"; filename=\"" << body_.path_->filename().string() << "\"\r\n"
-                       << "Content-Type: application/octet-stream\r\n\r\n";
-                    break;
-                }
-                // fall through
-            }
-
-            case 2: {
-                if ( file_.is_open() ) {
-                    auto buf { buffer_.prepare( blockSize ) };
-                    size_t read {};
-                    for ( auto it { buf.begin() } ; it != buf.end() ; ++it ) {
-                        size_t r { file_.read( it->data(), it->size(), ec ) };
-                        if ( r == 0 || ec ) {
-                            break;
-                        }
-                        read += r;
-                    }
-                    if ( read > 0 ) {
-                        buffer_.commit( read );
-                        break;
-                    }
-                }
-                ++state_;
-                // fall through
-            }
-
-            case 3: {
-                ostream os { &buffer_ };
-                os << "\r\n"
-                   << "--" << boundary_ << "--\r\n";
-                more = false;
-            }
-        }
-
-        return {{ buffer_.data(), more }};
-    }
-
-private:
-    value_type& body_;
-    asio::streambuf buffer_;
-    size_t state_ {};
-    value_type::fields_type::const_iterator field_;
-    boost::beast::file file_;
-    uuids::uuid boundary_ { uuids::random_generator()() };
-};
-
-} // namespace detail
-
-
 /**
  * function uploadModel
  */
@@ -189,23 +40,36 @@ private:
 void uploadModel( boost::asio::io_context& context, Endpoint const& settings, model_ident ident,
                   filesystem::path path, UploadHandler handler )
 {
-    asio::spawn( context, [&context, &settings, ident = move( ident ), path = move( path ), handler = move( handler )]( auto yield ) {
+    uploadModel( context, settings, move( ident ), move( path ), move( handler ), nullptr );
+}
+
+namespace detail {
+
+static void sendModel( asio::io_context& context, Endpoint const& settings, model_ident&& ident,
+                       filesystem::path&& path, UploadHandler&& handler, shared_ptr< Metrics >&& metrics,
+                       shared_ptr< tcp::socket >&& connected )
+{
+    asio::spawn( context, [&settings, ident = move( ident ), path = move( path ), handler = move( handler ),
+                           metrics = move( metrics ), connected = move( connected )]( auto yield ) {
         error_code ec;
         try {
-            tcp::resolver resolver { context };
-            auto resolved { resolver.async_resolve( settings.host(), settings.port(), yield ) };
-
-            tcp::socket socket { context };
-            asio::async_connect( socket, resolved, yield );
+            auto& socket = *connected;
 
             http::request< detail::upload_body > request { http::verb::post, "/printer/model/" + ident.printer(), 11 };
-            request.set( http::field::host, settings.host() );
-            request.set( http::field::user_agent, BOOST_BEAST_VERSION_STRING );
-            request.set( "x-api-key", settings.apikey() );
-            request.body().set( "a", "upload" );
-            request.body().set( "name", ident.name() );
-            request.body().set( "group", ident.group() );
-            request.body().set( path );
+            {
+                // scopes must not span a yield, other work runs on this thread while the coroutine is suspended
+                AllocationScope scope( AllocationTag::upload );
+                request.set( http::field::host, settings.host() );
+                request.set( http::field::user_agent, BOOST_BEAST_VERSION_STRING );
+                request.set( "x-api-key", settings.apikey() );
+                request.body().set( "a", "upload" );
+                request.body().set( "name", ident.name() );
+                request.body().set( "group", ident.group() );
+                request.body().set( path );
+                request.body().set( metrics.get() );
+                // without a length, the server takes the end of the header for the end of the request
+                request.prepare_payload();
+            }
 
             http::async_write( socket, request, yield );
 
@@ -222,9 +86,48 @@ void uploadModel( boost::asio::io_context& context, Endpoint const& settings, mo
             logger.error( "error: ", e.code().message() );
             ec = e.code();
         }
+        AllocationScope scope( AllocationTag::upload );
         handler( ec );
     } );
 }
 
+} // namespace detail
+
+void uploadModel( boost::asio::io_context& context, Endpoint const& settings, model_ident ident,
+                  filesystem::path path, UploadHandler handler, shared_ptr< Metrics > metrics,
+                  shared_ptr< ResolverCache > resolver )
+{
+    AllocationScope scope( AllocationTag::upload );
+    if ( !resolver ) {
+        resolver = make_shared< ResolverCache >();
+    }
+
+    resolver->resolve( context, settings.host(), settings.port(), [&context, &settings, ident = move( ident ),
+            path = move( path ), handler = move( handler ), metrics = move( metrics ), resolver](
+                    error_code ec, ResolverCache::Endpoints const& endpoints ) mutable {
+        AllocationScope scope( AllocationTag::upload );
+        if ( ec ) {
+            logger.error( "error: ", ec.message() );
+            handler( ec );
+            return;
+        }
+
+        detail::HappyEyeballs::connect( context, endpoints, resolver->attemptDelay(), [&context, &settings,
+                ident = move( ident ), path = move( path ), handler = move( handler ), metrics = move( metrics ),
+                resolver]( error_code ec, tcp::socket socket ) mutable {
+            AllocationScope scope( AllocationTag::upload );
+            if ( ec ) {
+                // the cached endpoints may be stale
+                resolver->invalidate( settings.host(), settings.port() );
+                logger.error( "error: ", ec.message() );
+                handler( ec );
+                return;
+            }
+            detail::sendModel( context, settings, move( ident ), move( path ), move( handler ), move( metrics ),
+                               make_shared< tcp::socket >( move( socket ) ) );
+        } );
+    } );
+}
+
 } // namespace rep
 } // namespace prnet
@@ -0,0 +1,224 @@
+#ifndef LIB3DPRNET_REPETIER_UPLOAD_BODY_HPP
+#define LIB3DPRNET_REPETIER_UPLOAD_BODY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/asio/streambuf.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include "3dprnet/core/encoding.hpp"
+#include "3dprnet/core/filesystem.hpp"
+#include "3dprnet/core/string_view.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+
+namespace prnet {
+namespace rep {
+namespace detail {
+
+/**
+ * struct upload_body
+ */
+
+struct upload_body
+{
+    class value_type;
+    class writer;
+
+    /**
+     * The size of the multipart body, for the Content-Length header set by prepare_payload(). Throws the
+     * filesystem_error of a file that cannot be sized.
+     */
+    static std::uint64_t size( value_type const& body );
+};
+
+
+/**
+ * class upload_body::value_type
+ */
+
+class upload_body::value_type
+{
+    friend struct upload_body;
+    friend class writer;
+
+public:
+    using fields_type = std::unordered_map< string_view, string_view >;
+
+    void set( string_view name, string_view value )
+    {
+        fields_.emplace( name, value );
+    }
+
+    void set( filesystem::path const& path )
+    {
+        path_ = &path;
+    }
+
+    void set( Metrics* metrics )
+    {
+        metrics_ = metrics;
+    }
+
+private:
+    void write_field( std::ostream& os, fields_type::value_type const& field ) const
+    {
+        os << "--" << boundary_ << "\r\n"
+           << "Content-Disposition: form-data; name=\"" << field.first << "\"\r\n"
+           << "Content-Type: text/plain; charset=utf-8\r\n\r\n" << enc::ToUtf8( field.second ) << "\r\n";
+    }
+
+    void write_file_header( std::ostream& os ) const
+    {
+        os << "--" << boundary_ << "\r\n"
+           << "Content-Disposition: form-data; name=\"filename\"; filename=\"" << path_->filename().string() << "\"\r\n"
+           << "Content-Type: application/octet-stream\r\n\r\n";
+    }
+
+    void write_trailer( std::ostream& os ) const
+    {
+        os << "\r\n"
+           << "--" << boundary_ << "--\r\n";
+    }
+
+    fields_type fields_;
+    filesystem::path const* path_ {};
+    Metrics* metrics_ {};
+    boost::uuids::uuid boundary_ { boost::uuids::random_generator()() };
+};
+
+
+/**
+ * class upload_body::writer
+ */
+
+class upload_body::writer
+{
+    static constexpr std::size_t blockSize { 8192 };
+
+public:
+    using const_buffers_type = boost::asio::streambuf::const_buffers_type;
+
+    template< bool isRequest, typename Fields >
+    writer( boost::beast::http::header< isRequest, Fields >& header, value_type& body )
+            : body_ { body }
+    {
+        header.set( boost::beast::http::field::content_type,
+                    "multipart/form-data; boundary=" + boost::uuids::to_string( body_.boundary_ ) );
+    }
+
+    void init( boost::beast::error_code& ec )
+    {
+        ec.assign( 0, ec.category() );
+
+        field_ = body_.fields_.cbegin();
+        if ( body_.path_ ) {
+            auto localPath = filesystem::native_path( *body_.path_ );
+            file_.open( localPath.c_str(), boost::beast::file_mode::read, ec );
+        }
+    }
+
+    boost::optional< std::pair< const_buffers_type, bool > > get( boost::beast::error_code& ec )
+    {
+        buffer_.consume( buffer_.size() );
+
+        bool more { true };
+        switch ( state_ ) {
+            case 0: {
+                if ( field_ != body_.fields_.cend() ) {
+                    std::ostream os { &buffer_ };
+                    body_.write_field( os, *field_ );
+                    ++field_;
+                    break;
+                }
+                ++state_;
+                // fall through
+            }
+
+            case 1: {
+                ++state_;
+                if ( file_.is_open() ) {
+                    std::ostream os { &buffer_ };
+                    body_.write_file_header( os );
+                    break;
+                }
+                // fall through
+            }
+
+            case 2: {
+                if ( file_.is_open() ) {
+                    auto buf { buffer_.prepare( blockSize ) };
+                    std::size_t read {};
+                    for ( auto it { buf.begin() } ; it != buf.end() ; ++it ) {
+                        std::size_t r { file_.read( it->data(), it->size(), ec ) };
+                        if ( r == 0 || ec ) {
+                            break;
+                        }
+                        read += r;
+                    }
+                    if ( read > 0 ) {
+                        buffer_.commit( read );
+                        break;
+                    }
+                }
+                ++state_;
+                // fall through
+            }
+
+            case 3: {
+                std::ostream os { &buffer_ };
+                body_.write_trailer( os );
+                more = false;
+            }
+        }
+
+        if ( body_.metrics_ ) {
+            body_.metrics_->uploadBytes.fetch_add( buffer_.size(), std::memory_order_relaxed );
+        }
+        return {{ buffer_.data(), more }};
+    }
+
+private:
+    value_type& body_;
+    boost::asio::streambuf buffer_;
+    std::size_t state_ {};
+    value_type::fields_type::const_iterator field_;
+    boost::beast::file file_;
+};
+
+
+/**
+ * struct upload_body
+ */
+
+inline std::uint64_t upload_body::size( value_type const& body )
+{
+    std::ostringstream os;
+    std::uint64_t fileSize {};
+    for ( auto const& field : body.fields_ ) {
+        body.write_field( os, field );
+    }
+    if ( body.path_ ) {
+        body.write_file_header( os );
+        fileSize = filesystem::file_size( *body.path_ );
+    }
+    body.write_trailer( os );
+    return static_cast< std::uint64_t >( os.tellp() ) + fileSize;
+}
+
+} // namespace detail
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_REPETIER_UPLOAD_BODY_HPP
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "3dprnet/core/async_subscriber.hpp"
+#include "3dprnet/core/logging.hpp"
+
+using namespace std;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+using Subscriber = AsyncSubscriber< void ( string key, int value ) >;
+
+static bool check( bool condition, char const* what )
+{
+    cout << ( condition ? "ok: " : "FAILED: " ) << what << endl;
+    return condition;
+}
+
+/**
+ * Fills the queue of a subscriber with three events for two keys beyond its capacity of two before it drains, which
+ * happens on an io_context that runs only after the events were emitted.
+ */
+static vector< int > run( QueuePolicy policy, SubscriberStats& stats, int failing = 0 )
+{
+    asio::io_context context;
+    vector< int > received;
+    auto subscriber = Subscriber::create( context.get_executor(), policy, 2, [&]( auto, auto value ) {
+        received.push_back( value );
+        if ( value == failing ) {
+            throw runtime_error( "handler failed" );
+        }
+    }, []( auto const& key, auto ) { return key; } );
+
+    auto slot = subscriber->slot();
+    slot( "a", 1 );
+    slot( "b", 2 );
+    slot( "a", 3 );
+    context.run();
+
+    stats = subscriber->stats();
+    return received;
+}
+
+/**
+ * Checks what each QueuePolicy delivers when the queue is full and that a throwing handler does not stop the
+ * delivery.
+ */
+int main()
+{
+    Logger::threshold( Logger::Level::error );
+
+    bool result = true;
+    SubscriberStats stats {};
+
+    auto received = run( QueuePolicy::keepAll, stats );
+    result &= check( received == vector< int > { 1, 2 } && stats.overflows == 1 && stats.dropped == 0,
+                     "keepAll rejects events while the queue is full" );
+    result &= check( stats.depth == 0 && stats.highWater == 2 && stats.delivered == 2, "keepAll stays bounded" );
+
+    received = run( QueuePolicy::dropOldest, stats );
+    result &= check( received == vector< int > { 2, 3 } && stats.dropped == 1 && stats.overflows == 0,
+                     "dropOldest drops the oldest event" );
+
+    received = run( QueuePolicy::latestPerKey, stats );
+    result &= check( received == vector< int > { 3, 2 } && stats.coalesced == 1 && stats.dropped == 0,
+                     "latestPerKey replaces the queued event of a key" );
+
+    received = run( QueuePolicy::dropOldest, stats, 2 );
+    result &= check( received == vector< int > { 2, 3 } && stats.delivered == 2 && stats.failed == 1,
+                     "a throwing handler does not stop the delivery" );
+
+    asio::io_context context;
+    size_t calls {};
+    auto subscriber = Subscriber::create( context.get_executor(), QueuePolicy::keepAll, 2,
+                                          [&calls]( auto, auto ) { ++calls; } );
+    auto slot = subscriber->slot();
+    subscriber.reset();
+    slot( "a", 1 );
+    context.run();
+    result &= check( calls == 0, "events after the subscriber is gone are discarded" );
+
+    bool thrown = false;
+    try {
+        Subscriber::create( context.get_executor(), QueuePolicy::latestPerKey, 2, []( auto, auto ) {} );
+    } catch ( invalid_argument const& ) {
+        thrown = true;
+    }
+    result &= check( thrown, "latestPerKey requires a key function" );
+
+    return result ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/client.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+static bool check( bool condition, char const* what )
+{
+    cout << ( condition ? "ok: " : "FAILED: " ) << what << endl;
+    return condition;
+}
+
+/**
+ * Replays events of a subscribed type and of more types nobody subscribed to than are counted one by one into a client
+ * that is never connected, and checks the event counts in its metrics.
+ */
+int main()
+{
+    Logger::threshold( Logger::Level::warning );
+
+    bool result = true;
+
+    asio::io_context context;
+    rep::Client client( context, []( auto ) {} );
+    auto metrics = make_shared< rep::Metrics >();
+    client.metrics( metrics );
+    size_t received = 0;
+    client.subscribe( "temp", [&received]( auto, auto const& ) { ++received; } );
+
+    auto events = json::array();
+    for ( int i = 0 ; i < 300 ; ++i ) {
+        events.push_back( { { "event", "unknown" + to_string( i ) }, { "printer", "printer" },
+                            { "data", json::object() } } );
+        events.push_back( { { "event", "temp" }, { "printer", "printer" }, { "data", json::object() } } );
+    }
+    json frame { { "callback_id", -1 }, { "eventList", true }, { "data", events } };
+    client.replay( frame.dump() );
+    client.replay( frame.dump() );
+
+    auto snapshot = metrics->snapshot();
+    size_t types = 0;
+    uint64_t other = 0;
+    uint64_t temp = 0;
+    bool counted = true;
+    for ( auto const& event : snapshot.events ) {
+        if ( event.first == "other" ) {
+            other = event.second;
+        } else if ( event.first == "temp" ) {
+            temp = event.second;
+        } else {
+            ++types;
+            counted &= event.second == 2;
+        }
+    }
+    result &= check( received == 600 && temp == 600, "subscribed events are delivered and counted" );
+    result &= check( types == 256 && counted, "the first unsubscribed types are counted one by one" );
+    result &= check( other == 2 * 44, "further unsubscribed types are counted together" );
+
+    return result ? 0 : 1;
+}
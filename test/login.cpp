@@ -1,48 +1,81 @@
+#include <chrono>
 #include <iostream>
+#include <memory>
 
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <nlohmann/json.hpp>
 
-#include <core/filesystem.hpp>
-#include <core/logging.hpp>
-#include <repetier/request.hpp>
-#include <repetier/client.hpp>
-#include <repetier/types.hpp>
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/client.hpp"
+#include "3dprnet/repetier/types.hpp"
+#include "test/mock_server.hpp"
 
 using namespace std;
+using namespace nlohmann;
 using namespace prnet;
 
 namespace asio = boost::asio;
 
+/**
+ * Logs in and pings the server. Without arguments, a MockServer is started in-process.
+ */
 int main( int argc, char const* const argv[] )
 {
-    logger::threshold( logger::Debug );
+    Logger::threshold( Logger::Level::debug );
 
-    if ( argc != 4 ) {
-        cerr << "Usage: " << argv[ 0 ] << " <host> <port> <apikey>";
+    if ( argc != 1 && argc != 4 ) {
+        cerr << "Usage: " << argv[ 0 ] << " [<host> <port> <apikey>]";
         return 1;
     }
 
     asio::io_context context;
 
-    rep::settings settings { argv[ 1 ], argv[ 2 ], argv[ 3 ] };
+    unique_ptr< rep::MockServer > mock;
+    rep::Endpoint endpoint;
+    if ( argc == 1 ) {
+        mock = make_unique< rep::MockServer >( context );
+        endpoint = mock->endpoint();
+    } else {
+        endpoint = { argv[ 1 ], argv[ 2 ], argv[ 3 ] };
+    }
+
+    cout << "Connecting to " << endpoint.host() << ":" << endpoint.port() << endl;
 
-    cout << "Connecting to " << settings.host() << ":" << settings.port() << endl;
+    int result = 1;
+    asio::steady_timer deadline( context, chrono::seconds( 10 ) );
+    deadline.async_wait( [&]( auto ec ) {
+        if ( !ec ) {
+            cout << "Timeout" << endl;
+            context.stop();
+        }
+    } );
 
-    rep::client socket( context, []( auto ec ) {
+    rep::Client client( context, [&]( auto ec ) {
         cout << "Connect or login failed: " << ec.message() << endl;
+        context.stop();
     } );
 
-    socket.connect( settings, [&] {
-        cout << "Successfully logged in" << endl;
+    json request;
+    client.connect( endpoint, [&] {
+        request = { { "action", "login" }, { "data", { { "apikey", endpoint.apikey() } } } };
+        client.send( request, [&]( auto const& data ) {
+            if ( !data.value( "ok", false ) ) {
+                cout << "Login rejected" << endl;
+                context.stop();
+                return;
+            }
+            cout << "Successfully logged in" << endl;
 
-        rep::request request { "ping" };
-        request.add_handler( [&]( auto ) {
-            cout << "Received pong" << endl;
-            socket.close();
+            request = { { "action", "ping" }, { "data", json::object() } };
+            client.send( request, [&]( auto const& ) {
+                cout << "Received pong" << endl;
+                result = 0;
+                context.stop();
+            } );
         } );
-        socket.send( move( request ) );
     } );
 
     context.run();
+    return result;
 }
-
@@ -0,0 +1,107 @@
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/write.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/metrics_exporter.hpp"
+
+using namespace std;
+using namespace prnet;
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using tcp = asio::ip::tcp;
+
+static bool check( bool condition, char const* what )
+{
+    cout << ( condition ? "ok: " : "FAILED: " ) << what << endl;
+    return condition;
+}
+
+// the value of the sample whose name and labels start with prefix, NaN if there is none
+static double sample( string const& exposition, string const& prefix )
+{
+    istringstream in( exposition );
+    string line;
+    while ( getline( in, line ) ) {
+        if ( line.compare( 0, prefix.size(), prefix ) == 0 ) {
+            return strtod( line.c_str() + line.rfind( ' ' ), nullptr );
+        }
+    }
+    return strtod( "nan", nullptr );
+}
+
+/**
+ * Checks the exposition of a histogram and the labels rendered by a MetricsExporter, scrapes it over a connection
+ * that is kept alive and checks that destroying the exporter lets the io_context run out of work.
+ */
+int main()
+{
+    Logger::threshold( Logger::Level::warning );
+
+    bool result = true;
+
+    auto metrics = make_shared< rep::Metrics >();
+    metrics->reconnectTime.record( chrono::milliseconds( 500 ) );
+    metrics->reconnectTime.record( chrono::nanoseconds( 1234067800000 ) );
+    metrics->reconnects.store( 3 );
+
+    asio::io_context context;
+    auto exporter = make_unique< rep::MetricsExporter >( context, 0 );
+    exporter->add( "printer\"1\":3344", metrics );
+
+    auto exposition = exporter->render();
+    string labels = "{server=\"printer\\\"1\\\":3344\"";
+    auto sum = sample( exposition, "prnet_reconnect_seconds_sum" + labels );
+    result &= check( sum == static_cast< double >( 1234567800000 ) / 1e9, "the sum of a histogram is not rounded" );
+    auto count = sample( exposition, "prnet_reconnect_seconds_count" + labels );
+    auto infinity = sample( exposition, "prnet_reconnect_seconds_bucket" + labels + ",le=\"+Inf\"" );
+    auto second = sample( exposition, "prnet_reconnect_seconds_bucket" + labels + ",le=\"1\"" );
+    result &= check( count == 2 && infinity == count && second == 1, "the buckets add up to the count" );
+    result &= check( exposition.find( "le=\"0.00025\"" ) != string::npos, "bucket bounds keep their short form" );
+    result &= check( sample( exposition, "prnet_reconnects_total" + labels ) == 3, "counters are exported" );
+
+    promise< void > finished;
+    thread runner( [&context, &finished] {
+        context.run();
+        finished.set_value();
+    } );
+
+    asio::io_context clientContext;
+    tcp::socket socket( clientContext );
+    socket.connect( { asio::ip::make_address( "127.0.0.1" ), exporter->port() } );
+    http::request< http::string_body > request { http::verb::get, "/metrics", 11 };
+    request.keep_alive( true );
+    http::write( socket, request );
+    boost::beast::flat_buffer buffer;
+    http::response< http::string_body > response;
+    http::read( socket, buffer, response );
+    result &= check( response.result() == http::status::ok && response.keep_alive()
+                     && response.body().find( "prnet_reconnect_seconds_sum" ) != string::npos,
+                     "a scrape returns the exposition" );
+
+    exporter.reset();
+    auto stopped = finished.get_future().wait_for( chrono::seconds( 5 ) ) == future_status::ready;
+    result &= check( stopped, "destroying the exporter closes connections kept alive" );
+    if ( !stopped ) {
+        context.stop();
+    }
+    runner.join();
+
+    return result ? 0 : 1;
+}
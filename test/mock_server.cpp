@@ -0,0 +1,556 @@
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core/buffers_to_string.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/multi_buffer.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/parser.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/write.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/beast/websocket/rfc6455.hpp>
+#include <boost/beast/websocket/stream.hpp>
+#include <nlohmann/json.hpp>
+
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace nlohmann;
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+namespace websocket = boost::beast::websocket;
+
+using tcp = asio::ip::tcp;
+
+namespace prnet {
+namespace rep {
+
+namespace detail {
+
+/**
+ * struct MockState
+ */
+
+struct MockState
+{
+    explicit MockState( MockServer::Options&& options )
+            : options( move( options ) ) {}
+
+    MockServer::Options const options;
+    atomic< size_t > connections {};
+    atomic< size_t > active {};
+    atomic< size_t > requests {};
+    atomic< size_t > events {};
+    atomic< size_t > uploads {};
+    atomic< uint64_t > uploadBytes {};
+};
+
+inline string mockSlug( size_t printer )
+{
+    return "printer" + std::to_string( printer );
+}
+
+json mockPrinters( MockServer::Options const& options )
+{
+    auto result = json::array();
+    for ( size_t i = 0 ; i < options.printers ; ++i ) {
+        result.push_back( {
+                { "active", true },
+                { "name", "Mock Printer " + std::to_string( i ) },
+                { "slug", mockSlug( i ) },
+                { "online", 1 },
+                { "job", i % 2 == 0 ? "none" : "model0.gcode" } } );
+    }
+    return result;
+}
+
+json mockConfig( string const& slug )
+{
+    return {
+            { "general", {
+                    { "active", true },
+                    { "slug", slug },
+                    { "name", "Mock Printer " + slug },
+                    { "firmwareName", "Repetier-Firmware" },
+                    { "heatedBed", true } } },
+            { "extruders", { { { "maxTemp", 270 } } } },
+            { "heatedBed", { { "installed", true }, { "maxTemp", 120 } } } };
+}
+
+json mockGroups( MockServer::Options const& options )
+{
+    auto groups = json::array( { "#" } );
+    for ( size_t i = 0 ; i < options.groups ; ++i ) {
+        groups.push_back( "group" + std::to_string( i ) );
+    }
+    return { { "ok", true }, { "groupNames", move( groups ) } };
+}
+
+json mockModels( MockServer::Options const& options )
+{
+    auto models = json::array();
+    for ( size_t i = 0 ; i < options.models ; ++i ) {
+        models.push_back( {
+                { "id", i },
+                { "name", "model" + std::to_string( i ) + ".gcode" },
+                { "group", options.groups > 0 ? "group" + std::to_string( i % options.groups ) : "#" },
+                { "created", 1500000000000 + i * 1000 },
+                { "length", 1024 * ( i + 1 ) },
+                { "layer", 100 + i },
+                { "lines", 10000 + i },
+                { "printTime", 600.5 + i } } );
+    }
+    return { { "data", move( models ) } };
+}
+
+} // namespace detail
+
+
+/**
+ * class MockServer::Session
+ */
+
+class MockServer::Session
+        : public enable_shared_from_this< MockServer::Session >
+{
+    using Strand = asio::strand< asio::io_context::executor_type >;
+
+    static constexpr size_t maxOutbox = 1024;
+    static constexpr uint64_t maxUpload = 256 * 1024 * 1024;
+
+public:
+    Session( asio::io_context& context, shared_ptr< detail::MockState > state, tcp::socket&& socket, unsigned seed )
+            : context_( context )
+            , strand_( context.get_executor() )
+            , state_( move( state ) )
+            , stream_( move( socket ) )
+            , wake_( context, chrono::steady_clock::time_point::max() )
+            , ticker_( context )
+            , random_( seed ) {}
+
+    void start()
+    {
+        asio::spawn( strand_, [self = shared_from_this()]( auto yield ) {
+            boost::beast::error_code ec;
+            boost::beast::flat_buffer buffer;
+            while ( true ) {
+                http::request_parser< http::string_body > parser;
+                parser.body_limit( maxUpload );
+                http::async_read( self->stream_.next_layer(), buffer, parser, yield[ ec ] );
+                if ( ec ) {
+                    return;
+                }
+
+                auto request = parser.release();
+                if ( websocket::is_upgrade( request ) && request.target() == "/socket" ) {
+                    self->stream_.async_accept( request, yield[ ec ] );
+                    if ( !ec ) {
+                        self->serve_socket( yield );
+                    }
+                    return;
+                }
+                if ( !self->serve_http( request, yield ) ) {
+                    return;
+                }
+            }
+        } );
+    }
+
+    void close()
+    {
+        asio::post( strand_, [self = shared_from_this()] { self->close_now(); } );
+    }
+
+private:
+    template< typename Yield >
+    void serve_socket( Yield yield )
+    {
+        state_->active.fetch_add( 1, memory_order_relaxed );
+        stream_.text( true );
+
+        asio::spawn( strand_, [self = shared_from_this()]( auto yield ) { self->write( yield ); } );
+
+        boost::beast::error_code ec;
+        while ( !closed_ ) {
+            boost::beast::multi_buffer buffer;
+            stream_.async_read( buffer, yield[ ec ] );
+            if ( ec ) {
+                break;
+            }
+            handle_request( boost::beast::buffers_to_string( buffer.data() ) );
+        }
+
+        close_now();
+        state_->active.fetch_sub( 1, memory_order_relaxed );
+    }
+
+    template< typename Yield >
+    bool serve_http( http::request< http::string_body >& request, Yield yield )
+    {
+        auto const& options = state_->options;
+        string prefix = "/printer/model/";
+
+        http::response< http::string_body > response;
+        response.version( request.version() );
+        response.keep_alive( request.keep_alive() );
+        response.set( http::field::server, BOOST_BEAST_VERSION_STRING );
+        if ( request.method() != http::verb::post || request.target().compare( 0, prefix.size(), prefix ) != 0 ) {
+            response.result( http::status::not_found );
+        } else if ( request[ "x-api-key" ] != options.apikey ) {
+            response.result( http::status::unauthorized );
+        } else {
+            state_->uploads.fetch_add( 1, memory_order_relaxed );
+            state_->uploadBytes.fetch_add( request.body().size(), memory_order_relaxed );
+            response.result( http::status::ok );
+            response.set( http::field::content_type, "application/json" );
+            response.body() = "{}";
+        }
+        response.prepare_payload();
+
+        boost::beast::error_code ec;
+        http::async_write( stream_.next_layer(), response, yield[ ec ] );
+        return !ec && response.keep_alive();
+    }
+
+    template< typename Yield >
+    void write( Yield yield )
+    {
+        boost::beast::error_code ec;
+        while ( !closed_ ) {
+            if ( outbox_.empty() ) {
+                wake_.async_wait( yield[ ec ] );
+                continue;
+            }
+
+            auto message = move( outbox_.front() );
+            outbox_.pop_front();
+            stream_.async_write( asio::buffer( message ), yield[ ec ] );
+            if ( ec ) {
+                close_now();
+            }
+        }
+    }
+
+    template< typename Yield >
+    void tick( Yield yield )
+    {
+        auto const& options = state_->options;
+        auto interval = chrono::duration_cast< chrono::steady_clock::duration >(
+                chrono::duration< double >( options.eventBatch / options.eventRate ) );
+
+        boost::beast::error_code ec;
+        ticker_.expires_after( interval );
+        while ( !closed_ ) {
+            ticker_.async_wait( yield[ ec ] );
+            if ( closed_ ) {
+                return;
+            }
+            // a fixed schedule keeps the rate even if the io_context falls behind
+            ticker_.expires_at( ticker_.expiry() + interval );
+            if ( outbox_.size() < maxOutbox ) {
+                push( events() );
+            }
+        }
+    }
+
+    void handle_request( string const& message )
+    {
+        auto const& options = state_->options;
+        state_->requests.fetch_add( 1, memory_order_relaxed );
+
+        json request;
+        try {
+            request = json::parse( message );
+        } catch ( json::exception const& ) {
+            return;
+        }
+
+        auto fault = uniform_real_distribution< double >( 0.0, 1.0 )( random_ );
+        if ( ( fault -= options.dropResponse ) < 0.0 ) {
+            return;
+        }
+        if ( ( fault -= options.disconnect ) < 0.0 ) {
+            close_now();
+            return;
+        }
+
+        string response;
+        if ( ( fault -= options.malformed ) < 0.0 ) {
+            response = "{\"callback_id\":";
+        } else {
+            response = json {
+                    { "callback_id", request.value( "callback_id", -1L ) },
+                    { "session", "mock" },
+                    { "data", respond( request ) } }.dump();
+        }
+
+        if ( options.latency.count() <= 0 ) {
+            push( move( response ) );
+            return;
+        }
+        auto timer = make_shared< asio::steady_timer >( context_, options.latency );
+        timer->async_wait( asio::bind_executor( strand_, [self = shared_from_this(), timer,
+                                                          response = move( response )]( auto ec ) mutable {
+            if ( !ec && !self->closed_ ) {
+                self->push( move( response ) );
+            }
+        } ) );
+    }
+
+    json respond( json const& request )
+    {
+        auto const& options = state_->options;
+        string action = request.value( "action", "" );
+        string slug = request.value( "printer", "" );
+
+        if ( action == "login" ) {
+            bool ok = request.at( "data" ).value( "apikey", "" ) == options.apikey;
+            if ( ok && !loggedIn_ && options.eventRate > 0.0 && options.eventBatch > 0 ) {
+                asio::spawn( strand_, [self = shared_from_this()]( auto yield ) { self->tick( yield ); } );
+            }
+            loggedIn_ = loggedIn_ || ok;
+            return { { "ok", ok } };
+        }
+        if ( action == "listPrinter" ) {
+            return detail::mockPrinters( options );
+        }
+        if ( action == "getPrinterConfig" ) {
+            return detail::mockConfig( slug );
+        }
+        if ( action == "listModelGroups" ) {
+            return detail::mockGroups( options );
+        }
+        if ( action == "listModels" ) {
+            return detail::mockModels( options );
+        }
+        if ( action == "addModelGroup" || action == "delModelGroup" || action == "moveModelFileToGroup" ) {
+            return { { "ok", true } };
+        }
+        return json::object();
+    }
+
+    string events()
+    {
+        auto const& options = state_->options;
+        normal_distribution< double > noise( 0.0, 0.5 );
+
+        auto data = json::array();
+        for ( size_t i = 0 ; i < options.eventBatch ; ++i, ++sequence_ ) {
+            auto printer = options.printers > 0 ? sequence_ % options.printers : 0;
+            int controller = ( sequence_ / max< size_t >( options.printers, 1 ) ) % 2 == 0 ? 0 : -1;
+            double wanted = controller < 0 ? 60.0 : 210.0;
+            data.push_back( {
+                    { "event", "temp" },
+                    { "printer", detail::mockSlug( printer ) },
+                    { "data", { { "id", controller }, { "S", wanted }, { "T", wanted + noise( random_ ) } } } } );
+        }
+        state_->events.fetch_add( options.eventBatch, memory_order_relaxed );
+        return json { { "callback_id", -1 }, { "eventList", true }, { "data", move( data ) } }.dump();
+    }
+
+    void push( string&& message )
+    {
+        if ( closed_ ) {
+            return;
+        }
+        outbox_.push_back( move( message ) );
+        wake_.cancel();
+    }
+
+    void close_now()
+    {
+        if ( closed_ ) {
+            return;
+        }
+        closed_ = true;
+        wake_.cancel();
+        ticker_.cancel();
+
+        boost::system::error_code ec;
+        stream_.next_layer().shutdown( tcp::socket::shutdown_both, ec );
+        stream_.next_layer().close( ec );
+    }
+
+    asio::io_context& context_;
+    Strand strand_;
+    shared_ptr< detail::MockState > state_;
+    websocket::stream< tcp::socket > stream_;
+    asio::steady_timer wake_;
+    asio::steady_timer ticker_;
+    deque< string > outbox_;
+    mt19937 random_;
+    size_t sequence_ {};
+    bool loggedIn_ {};
+    bool closed_ {};
+};
+
+constexpr size_t MockServer::Session::maxOutbox;
+constexpr uint64_t MockServer::Session::maxUpload;
+
+
+/**
+ * class MockServer::Impl
+ */
+
+class MockServer::Impl
+        : public enable_shared_from_this< MockServer::Impl >
+{
+    using Lock = lock_guard< mutex >;
+    using Strand = asio::strand< asio::io_context::executor_type >;
+
+public:
+    Impl( asio::io_context& context, Options&& options )
+            : context_( context )
+            , strand_( context.get_executor() )
+            , state_( make_shared< detail::MockState >( move( options ) ) )
+            , acceptor_( context, tcp::endpoint( asio::ip::make_address( state_->options.address ),
+                                                 state_->options.port ) )
+            , port_( acceptor_.local_endpoint().port() ) {}
+
+    void start()
+    {
+        asio::spawn( strand_, [self = shared_from_this()]( auto yield ) {
+            while ( true ) {
+                boost::beast::error_code ec;
+                tcp::socket socket( self->context_ );
+                self->acceptor_.async_accept( socket, yield[ ec ] );
+                if ( ec == asio::error::operation_aborted || !self->acceptor_.is_open() ) {
+                    return;
+                }
+                if ( ec ) {
+                    continue;
+                }
+
+                socket.set_option( tcp::no_delay( true ), ec );
+                auto index = self->state_->connections.fetch_add( 1, memory_order_relaxed );
+                auto session = make_shared< Session >(
+                        self->context_, self->state_, move( socket ),
+                        self->state_->options.seed + static_cast< unsigned >( index ) );
+                self->add( session );
+                session->start();
+            }
+        } );
+    }
+
+    void stop()
+    {
+        asio::post( strand_, [self = shared_from_this()] {
+            boost::system::error_code ec;
+            self->acceptor_.close( ec );
+        } );
+        disconnect_all();
+    }
+
+    unsigned short port() const
+    {
+        return port_;
+    }
+
+    Endpoint endpoint() const
+    {
+        return { state_->options.address, std::to_string( port_ ), state_->options.apikey };
+    }
+
+    Stats stats() const
+    {
+        return {
+                state_->connections.load( memory_order_relaxed ),
+                state_->active.load( memory_order_relaxed ),
+                state_->requests.load( memory_order_relaxed ),
+                state_->events.load( memory_order_relaxed ),
+                state_->uploads.load( memory_order_relaxed ),
+                state_->uploadBytes.load( memory_order_relaxed ) };
+    }
+
+    void disconnect_all()
+    {
+        Lock lock( mutex_ );
+        for ( auto const& weak : sessions_ ) {
+            if ( auto session = weak.lock() ) {
+                session->close();
+            }
+        }
+        sessions_.clear();
+    }
+
+private:
+    void add( shared_ptr< Session > const& session )
+    {
+        Lock lock( mutex_ );
+        sessions_.erase( remove_if( sessions_.begin(), sessions_.end(), []( auto const& weak ) {
+            return weak.expired();
+        } ), sessions_.end() );
+        sessions_.push_back( session );
+    }
+
+    asio::io_context& context_;
+    Strand strand_;
+    shared_ptr< detail::MockState > state_;
+    tcp::acceptor acceptor_;
+    unsigned short port_;
+
+    mutex mutex_;
+    vector< weak_ptr< Session > > sessions_;
+};
+
+
+/**
+ * class MockServer
+ */
+
+MockServer::Options MockServer::defaultOptions()
+{
+    return { "127.0.0.1", 0, "mock", 2, 10, 2, 10.0, 1, chrono::milliseconds( 0 ), 0.0, 0.0, 0.0, 1 };
+}
+
+MockServer::MockServer( asio::io_context& context )
+        : MockServer( context, defaultOptions() ) {}
+
+MockServer::MockServer( asio::io_context& context, Options options )
+        : impl_( make_shared< Impl >( context, move( options ) ) )
+{
+    impl_->start();
+}
+
+MockServer::~MockServer()
+{
+    impl_->stop();
+}
+
+unsigned short MockServer::port() const
+{
+    return impl_->port();
+}
+
+Endpoint MockServer::endpoint() const
+{
+    return impl_->endpoint();
+}
+
+MockServer::Stats MockServer::stats() const
+{
+    return impl_->stats();
+}
+
+void MockServer::disconnect_all()
+{
+    impl_->disconnect_all();
+}
+
+} // namespace rep
+} // namespace prnet
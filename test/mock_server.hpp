@@ -0,0 +1,100 @@
+#ifndef LIB3DPRNET_TEST_MOCK_SERVER_HPP
+#define LIB3DPRNET_TEST_MOCK_SERVER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+
+#include "3dprnet/repetier/types.hpp"
+
+namespace prnet {
+namespace rep {
+
+/**
+ * class MockServer
+ *
+ * Simulation of a Repetier server on the given io_context for the tests and benchmarks: a websocket endpoint at
+ * /socket speaking the login, listPrinter, getPrinterConfig, listModelGroups, listModels, send etc. protocol with
+ * callback_id, temperature events as eventList frames, and model uploads via HTTP POST to /printer/model/<slug>.
+ * Unknown actions are answered with empty data.
+ *
+ * All members may be called from any thread.
+ */
+
+class MockServer
+{
+public:
+    /**
+     * port of zero picks a free one. eventRate is the number of temp events per second and connection, sent in frames
+     * of eventBatch events. Every response is delayed by latency. The faults are probabilities per request: dropResponse
+     * never answers, disconnect closes the connection instead of answering and malformed answers with invalid JSON.
+     */
+    struct Options
+    {
+        std::string address;
+        unsigned short port;
+        std::string apikey;
+        std::size_t printers;
+        std::size_t models;
+        std::size_t groups;
+        double eventRate;
+        std::size_t eventBatch;
+        std::chrono::milliseconds latency;
+        double dropResponse;
+        double disconnect;
+        double malformed;
+        unsigned seed;
+    };
+
+    struct Stats
+    {
+        std::size_t connections;
+        std::size_t active;
+        std::size_t requests;
+        std::size_t events;
+        std::size_t uploads;
+        std::uint64_t uploadBytes;
+    };
+
+private:
+    class Session;
+    class Impl;
+
+public:
+    static Options defaultOptions();
+
+    explicit MockServer( boost::asio::io_context& context );
+    MockServer( boost::asio::io_context& context, Options options );
+    MockServer( MockServer const& ) = delete;
+
+    /**
+     * Stops accepting and closes all connections.
+     */
+    ~MockServer();
+
+    unsigned short port() const;
+
+    /**
+     * Endpoint for connecting to the server, including the apikey it expects.
+     */
+    Endpoint endpoint() const;
+
+    Stats stats() const;
+
+    /**
+     * Closes all open connections, the server keeps accepting new ones.
+     */
+    void disconnect_all();
+
+private:
+    std::shared_ptr< Impl > impl_;
+};
+
+} // namespace rep
+} // namespace prnet
+
+#endif // LIB3DPRNET_TEST_MOCK_SERVER_HPP
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/repetier/model_table.hpp"
+#include "3dprnet/repetier/types.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+static bool check( bool condition, char const* what )
+{
+    cout << ( condition ? "ok: " : "FAILED: " ) << what << endl;
+    return condition;
+}
+
+static json makeModel( size_t id, string const& name, string const& group, size_t layers = 120 )
+{
+    return {
+            { "id", id },
+            { "name", name },
+            { "group", group },
+            { "created", 1514764800000 + id * 1000 },
+            { "length", 1024 * id },
+            { "layer", layers },
+            { "lines", 20000 + id },
+            { "printTime", 3600.5 + id } };
+}
+
+static bool equal( rep::ModelRef const& ref, rep::Model const& model )
+{
+    return ref.id() == model.id() && ref.name() == model.name() && ref.modelGroup() == model.modelGroup()
+           && ref.created() == model.created() && ref.length() == model.length() && ref.layers() == model.layers()
+           && ref.lines() == model.lines() && ref.printTime() == model.printTime();
+}
+
+/**
+ * Checks that a ModelTable returns what it was filled with, both from json and from models, that group names are
+ * interned, and that a model that does not fit into the columns is rejected without leaving the table inconsistent.
+ */
+int main()
+{
+    bool result = true;
+
+    json src = json::array();
+    vector< string > groups { "#", "Customer Project with a name beyond the small string optimization", "Spares" };
+    for ( size_t i = 0 ; i < 30 ; ++i ) {
+        src.push_back( makeModel( i + 1, "model_" + to_string( i ), groups[ i % groups.size() ] ) );
+    }
+    auto models = src.get< vector< rep::Model > >();
+
+    rep::ModelTable table = src;
+    bool same = table.size() == models.size();
+    for ( size_t i = 0 ; same && i < models.size() ; ++i ) {
+        same = equal( table[ i ], models[ i ] );
+    }
+    result &= check( same, "a table read from json holds every model" );
+    result &= check( table.groups() == groups, "group names are interned in the order they appear" );
+
+    rep::ModelTable pushed( models );
+    same = pushed.size() == models.size();
+    for ( size_t i = 0 ; same && i < models.size() ; ++i ) {
+        same = equal( pushed[ i ], models[ i ] );
+    }
+    result &= check( same, "a table built from models holds every model" );
+
+    auto copy = table;
+    copy.push_back( models[ 1 ] );
+    result &= check( copy.groups().size() == groups.size() && copy[ models.size() ].modelGroup() == groups[ 1 ],
+                     "a copied table finds the groups it interned" );
+
+    auto tooLarge = makeModel( 100, "too_large", "New Group", 1ull << 40 ).get< rep::Model >();
+    bool thrown = false;
+    try {
+        table.push_back( tooLarge );
+    } catch ( out_of_range const& ) {
+        thrown = true;
+    }
+    result &= check( thrown, "a model beyond the range of a column throws" );
+    result &= check( table.size() == models.size() && equal( table[ table.size() - 1 ], models.back() )
+                     && table.groups() == groups,
+                     "a rejected model leaves the table as it was" );
+
+    auto next = makeModel( 101, "next", "#" ).get< rep::Model >();
+    table.push_back( next );
+    result &= check( table.size() == models.size() + 1 && equal( table[ models.size() ], next ),
+                     "the table takes models after a rejected one" );
+
+    table.clear();
+    result &= check( table.empty() && table.groups().empty() && table.begin() == table.end(),
+                     "a cleared table is empty" );
+    table.push_back( next );
+    result &= check( table.size() == 1 && equal( table[ 0 ], next ) && table.groups().size() == 1,
+                     "a cleared table interns groups anew" );
+
+    return result ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "3dprnet/repetier/service_pool.hpp"
+#include "3dprnet/repetier/types.hpp"
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+static bool check( bool condition, char const* what )
+{
+    cout << ( condition ? "ok: " : "FAILED: " ) << what << endl;
+    return condition;
+}
+
+static bool waitFor( function< bool () > const& condition )
+{
+    auto deadline = chrono::steady_clock::now() + chrono::seconds( 10 );
+    while ( !condition() ) {
+        if ( chrono::steady_clock::now() > deadline ) {
+            return false;
+        }
+        this_thread::sleep_for( chrono::milliseconds( 10 ) );
+    }
+    return true;
+}
+
+/**
+ * Runs three MockServers through a ServicePool of two shards: two busy servers that end up on the first shard and a
+ * quiet one on the second. Checks adding, dispatching to the services on their shards, the watchdog of each shard,
+ * refetching the printers after a reconnect, moving a busy server to the quiet shard with rebalance() and removing
+ * servers.
+ */
+int main()
+{
+    Logger::threshold( Logger::Level::warning );
+
+    asio::io_context serverContext;
+    auto serverWork = asio::make_work_guard( serverContext );
+    auto busyOptions = rep::MockServer::defaultOptions();
+    busyOptions.eventRate = 200;
+    auto quietOptions = rep::MockServer::defaultOptions();
+    quietOptions.eventRate = 0;
+    rep::MockServer busy1( serverContext, busyOptions );
+    rep::MockServer quiet( serverContext, quietOptions );
+    rep::MockServer busy2( serverContext, busyOptions );
+    thread serverRunner( [&serverContext] { serverContext.run(); } );
+
+    bool result = true;
+    {
+        auto options = rep::ServicePool::defaultOptions();
+        options.shards = 2;
+        options.rebalanceInterval = chrono::seconds( 0 );
+        rep::ServicePool pool( options );
+
+        mutex mutex;
+        map< string, size_t > events;
+        map< string, size_t > logins;
+        map< string, size_t > printers;
+        pool.on_temperature( [&]( auto server, auto, auto ) {
+            lock_guard< std::mutex > lock( mutex );
+            ++events[ server ];
+        } );
+        pool.on_reconnect( [&]( auto server ) {
+            lock_guard< std::mutex > lock( mutex );
+            ++logins[ server ];
+        } );
+        pool.on_printers( [&]( auto server, auto ) {
+            lock_guard< std::mutex > lock( mutex );
+            ++printers[ server ];
+        } );
+        auto count = [&]( map< string, size_t > const& counts, string const& server ) {
+            lock_guard< std::mutex > lock( mutex );
+            auto it = counts.find( server );
+            return it != counts.end() ? it->second : 0;
+        };
+
+        auto server1 = pool.add( busy1.endpoint() );
+        auto server2 = pool.add( quiet.endpoint() );
+        auto server3 = pool.add( busy2.endpoint() );
+        auto stats = pool.stats();
+        result &= check( stats.size() == 2 && stats[ 0 ].servers == 2 && stats[ 1 ].servers == 1,
+                         "servers are spread over the shards" );
+
+        bool duplicate = false;
+        try {
+            pool.add( busy1.endpoint() );
+        } catch ( invalid_argument const& ) {
+            duplicate = true;
+        }
+        result &= check( duplicate, "adding a server twice throws" );
+
+        result &= check( waitFor( [&] { return count( events, server1 ) > 50 && count( events, server3 ) > 50; } ),
+                         "events of the busy servers arrive" );
+
+        promise< bool > connected;
+        pool.dispatch( server2, [&connected]( rep::Service& service ) { connected.set_value( service.connected() ); } );
+        auto dispatched = connected.get_future();
+        result &= check( dispatched.wait_for( chrono::seconds( 10 ) ) == future_status::ready && dispatched.get(),
+                         "dispatch reaches the service on its shard" );
+
+        auto lagSamples = [&pool]( string const& server ) {
+            promise< uint64_t > samples;
+            pool.dispatch( server, [&samples]( rep::Service& service ) {
+                samples.set_value( service.metrics().loopLag.count );
+            } );
+            return samples.get_future().get();
+        };
+        result &= check( waitFor( [&] { return lagSamples( server1 ) > 0 && lagSamples( server2 ) > 0; } )
+                         && lagSamples( server3 ) == 0, "one watchdog per shard measures the lag" );
+
+        result &= check( waitFor( [&] { return count( printers, server2 ) > 0; } ), "the printers are fetched" );
+        auto fetched = count( printers, server2 );
+        quiet.disconnect_all();
+        result &= check( waitFor( [&] { return count( logins, server2 ) == 2 && count( printers, server2 ) > fetched; } ),
+                         "the printers are fetched again after a reconnect" );
+
+        pool.rebalance();
+        stats = pool.stats();
+        result &= check( stats[ 0 ].servers == 1 && stats[ 1 ].servers == 2, "rebalance moves a busy server" );
+        result &= check( waitFor( [&] { return count( logins, server1 ) + count( logins, server3 ) == 3; } ),
+                         "the moved server logs in again on its new shard" );
+
+        pool.rebalance();
+        stats = pool.stats();
+        result &= check( stats[ 0 ].servers == 1 && stats[ 1 ].servers == 2, "a balanced pool stays as it is" );
+
+        pool.remove( server1 );
+        pool.remove( server3 );
+        pool.remove( server3 );
+        stats = pool.stats();
+        result &= check( stats[ 0 ].servers + stats[ 1 ].servers == 1, "removed servers are gone" );
+        result &= check( waitFor( [&] { return busy1.stats().active == 0 && busy2.stats().active == 0; } ),
+                         "removed servers are disconnected" );
+
+        bool unknown = false;
+        try {
+            pool.dispatch( server1, []( auto& ) {} );
+        } catch ( invalid_argument const& ) {
+            unknown = true;
+        }
+        result &= check( unknown, "dispatching to a removed server throws" );
+    }
+
+    serverWork.reset();
+    serverContext.stop();
+    serverRunner.join();
+    return result ? 0 : 1;
+}
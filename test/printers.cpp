@@ -1,42 +1,86 @@
+#include <chrono>
 #include <iostream>
+#include <memory>
 
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
 
-#include <core/logging.hpp>
-#include <repetier/service.hpp>
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "3dprnet/repetier/types.hpp"
+#include "test/mock_server.hpp"
 
 using namespace std;
 using namespace prnet;
 
 namespace asio = boost::asio;
 
+/**
+ * Lists the printers of the server and the models of every printer. Without arguments, a MockServer is started
+ * in-process and the listings are checked against its options.
+ */
 int main( int argc, char const* const argv[] )
 {
-    logger::threshold( logger::Debug );
+    Logger::threshold( Logger::Level::info );
 
-    if ( argc != 4 ) {
-        cerr << "Usage: " << argv[ 0 ] << " <host> <port> <apikey>";
+    if ( argc != 1 && argc != 4 ) {
+        cerr << "Usage: " << argv[ 0 ] << " [<host> <port> <apikey>]";
         return 1;
     }
 
     asio::io_context context;
 
-    rep::Endpoint settings { argv[ 1 ], argv[ 2 ], argv[ 3 ] };
+    unique_ptr< rep::MockServer > mock;
+    rep::Endpoint endpoint;
+    if ( argc == 1 ) {
+        mock = make_unique< rep::MockServer >( context );
+        endpoint = mock->endpoint();
+    } else {
+        endpoint = { argv[ 1 ], argv[ 2 ], argv[ 3 ] };
+    }
+
+    cout << "Connecting to " << endpoint.host() << ":" << endpoint.port() << endl;
+
+    int result = 1;
+    asio::steady_timer deadline( context, chrono::seconds( 10 ) );
+    deadline.async_wait( [&]( auto ec ) {
+        if ( !ec ) {
+            cout << "Timeout" << endl;
+            context.stop();
+        }
+    } );
 
-    cout << "Connecting to " << settings.host() << ":" << settings.port() << endl;
+    auto options = rep::MockServer::defaultOptions();
+    size_t printers = 0;
+    size_t received = 0;
 
-    rep::Service service { context, settings };
-/*    Service.list_printers( [&]( auto printers ) {
-        for ( auto const& Printer : printers ) {
-            cout << "PRINTER: " << Printer.name() << " " << Printer.slug() << endl;
-            Service.list_groups( Printer.slug(), [=]( auto groups ) {
-                for ( auto const& ModelGroup : groups ) {
-                    cout << "GROUP FOR PRINTER: " << Printer.name() << " - " << ModelGroup.name() << endl;
-                }
-            } );
+    rep::Service service( context, endpoint );
+    service.on_reconnect( [&] { service.request_printers(); } );
+    service.on_printers( [&]( auto const& list ) {
+        printers = list.size();
+        for ( auto const& printer : list ) {
+            cout << "PRINTER: " << printer.name() << " (" << printer.slug() << "): " << to_string( printer.state() )
+                 << endl;
+            service.request_models( printer.slug() );
         }
-    } );*/
+        if ( mock && printers != options.printers ) {
+            cout << "Expected " << options.printers << " printers" << endl;
+            context.stop();
+        }
+    } );
+    service.on_models( [&]( auto slug, auto const& models ) {
+        for ( auto const& model : models ) {
+            cout << "MODEL FOR PRINTER " << slug << ": " << model.name() << " in " << model.modelGroup() << endl;
+        }
+        if ( mock && models.size() != options.models ) {
+            cout << "Expected " << options.models << " models" << endl;
+            context.stop();
+        } else if ( ++received == printers ) {
+            result = 0;
+            context.stop();
+        }
+    } );
 
     context.run();
+    return result;
 }
-
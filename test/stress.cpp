@@ -0,0 +1,140 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/frontend.hpp"
+#include "3dprnet/repetier/metrics.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "3dprnet/repetier/types.hpp"
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+static bool check( bool condition, char const* what )
+{
+    cout << ( condition ? "ok: " : "FAILED: " ) << what << endl;
+    return condition;
+}
+
+/**
+ * Hammers the public API of Service and Frontend from several threads while the io_context is run by several other
+ * threads. Without a server, a MockServer is started on the same io_context, and every request must be answered once
+ * the callers stop. A server that cannot be reached must be reported by disconnects. Data races are only found in a
+ * build with PRNET_SANITIZE_THREAD, which needs Boost 1.80 or later.
+ */
+int main( int argc, char const* const argv[] )
+{
+    if ( argc != 1 && argc < 4 ) {
+        cerr << "Usage: " << argv[ 0 ] << " [<host> <port> <apikey> [<threads>] [<seconds>]]";
+        return 1;
+    }
+
+    size_t threads = argc > 4 ? strtoul( argv[ 4 ], nullptr, 10 ) : 4;
+    auto duration = chrono::seconds( argc > 5 ? strtoul( argv[ 5 ], nullptr, 10 ) : 5 );
+
+    Logger::threshold( Logger::Level::error );
+
+    asio::io_context context;
+    auto work = asio::make_work_guard( context );
+    unique_ptr< rep::MockServer > mock;
+    rep::Endpoint endpoint;
+    if ( argc == 1 ) {
+        mock = make_unique< rep::MockServer >( context );
+        endpoint = mock->endpoint();
+    } else {
+        endpoint = { argv[ 1 ], argv[ 2 ], argv[ 3 ] };
+    }
+
+    vector< thread > runners;
+    for ( size_t i = 0 ; i < threads ; ++i ) {
+        runners.emplace_back( [&context] { context.run(); } );
+    }
+
+    atomic< size_t > temperatures {};
+    atomic< size_t > printers {};
+    atomic< size_t > models {};
+    atomic< size_t > disconnects {};
+    atomic< size_t > events {};
+    auto service = make_unique< rep::Service >( context, endpoint );
+    service->on_temperature( [&]( auto, auto ) { ++temperatures; } );
+    service->on_printers( [&]( auto ) { ++printers; } );
+    service->on_models( [&]( auto, auto ) { ++models; } );
+    service->on_disconnect( [&]( auto ) { ++disconnects; } );
+
+    atomic< bool > stop {};
+    atomic< size_t > requested {};
+    vector< thread > workers;
+    for ( size_t i = 0 ; i < threads ; ++i ) {
+        workers.emplace_back( [&, i] {
+            size_t calls = 0;
+            bool full = false;
+            while ( !stop ) {
+                // the requests are answered one at a time, callers outpacing them would grow a queue that never drains
+                if ( calls % 64 == 0 ) {
+                    full = service->metrics().queueDepth > 1000;
+                }
+                if ( !full ) {
+                    ++requested;
+                    service->sendCommand( "printer", "M105" );
+                    service->request_printers();
+                    service->request_models( "printer" );
+                }
+                service->temperature_filter( { 0.5 * ( calls % 3 ), chrono::milliseconds( calls % 100 ), {} } );
+                service->temperature_filter_stats();
+                service->connected();
+
+                // construction and destruction while the io_context threads are busy
+                if ( ++calls % 50 == i ) {
+                    rep::Frontend frontend( context, endpoint );
+                    frontend.on_printers( [&]( auto ) { ++events; } );
+                    frontend.requestPrinters();
+                    frontend.sendCommand( "printer", "M105" );
+                }
+            }
+        } );
+    }
+
+    this_thread::sleep_for( duration );
+    stop = true;
+    for ( auto& worker : workers ) {
+        worker.join();
+    }
+
+    bool result = true;
+    if ( mock ) {
+        // every request that was queued is answered, and nothing else is left in the queue then
+        auto deadline = chrono::steady_clock::now() + chrono::seconds( 30 );
+        while ( ( printers < requested || models < requested || service->metrics().queueDepth > 0 )
+                && chrono::steady_clock::now() < deadline ) {
+            this_thread::sleep_for( chrono::milliseconds( 10 ) );
+        }
+        result &= check( temperatures > 0, "temperature events are delivered" );
+        result &= check( printers >= requested && models >= requested, "every request is answered" );
+        result &= check( service->metrics().queueDepth == 0, "the queue drains" );
+    } else {
+        result &= check( printers > 0 || disconnects > 0, "the server answers or the failed connection is reported" );
+    }
+
+    service = nullptr;
+    mock = nullptr;
+    work.reset();
+    context.stop();
+    for ( auto& runner : runners ) {
+        runner.join();
+    }
+
+    cout << "stress test finished after " << requested << " rounds of requests, " << temperatures
+         << " temperature events, " << events << " frontend events" << endl;
+    return result ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/service.hpp"
+#include "3dprnet/repetier/temperature_history.hpp"
+#include "3dprnet/repetier/types.hpp"
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+using History = rep::TemperatureHistory;
+
+static bool check( bool condition, char const* what )
+{
+    cout << ( condition ? "ok: " : "FAILED: " ) << what << endl;
+    return condition;
+}
+
+static rep::Temperature makeTemperature( int id, double actual )
+{
+    return json { { "id", id }, { "S", 210.0 }, { "T", actual } }.get< rep::Temperature >();
+}
+
+/**
+ * Checks the queries of a TemperatureHistory, also after the clock went backwards, and that a history attached to a
+ * Service connected to a MockServer records its events and can be destroyed before the service.
+ */
+int main()
+{
+    Logger::threshold( Logger::Level::warning );
+
+    bool result = true;
+
+    auto start = History::Clock::time_point( chrono::hours( 24 * 365 * 50 ) );
+    History history;
+    for ( int i = 0 ; i < 25 ; ++i ) {
+        history.append( "printer", makeTemperature( 0, 200.0 + i ), start + chrono::seconds( i ) );
+    }
+
+    History::Aggregate aggregates[ 8 ];
+    auto count = history.aggregates( "printer", "extruder0", History::tenSeconds, start, start + chrono::minutes( 1 ),
+                                     aggregates, 8 );
+    result &= check( count == 2 && aggregates[ 0 ].count == 10 && aggregates[ 0 ].minimum == 200.0
+                     && aggregates[ 0 ].maximum == 209.0 && aggregates[ 0 ].average == 204.5
+                     && aggregates[ 1 ].time == start + chrono::seconds( 10 ), "completed buckets are aggregated" );
+
+    // the system clock is set back by a minute
+    history.append( "printer", makeTemperature( 0, 300.0 ), start - chrono::seconds( 35 ) );
+    history.append( "printer", makeTemperature( 0, 301.0 ), start + chrono::seconds( 25 ) );
+
+    History::Sample samples[ 8 ];
+    auto from = start + chrono::seconds( 22 );
+    count = history.samples( "printer", "extruder0", from, start + chrono::minutes( 1 ), samples, 8 );
+    bool ordered = count == 5;
+    for ( size_t i = 0 ; ordered && i < count ; ++i ) {
+        ordered = samples[ i ].time >= from && ( i == 0 || samples[ i ].time >= samples[ i - 1 ].time );
+    }
+    result &= check( ordered && samples[ 3 ].actual == 300.0 && samples[ 3 ].time == start + chrono::seconds( 24 ),
+                     "a reading from before the last one is recorded at its time" );
+
+    count = history.aggregates( "printer", "extruder0", History::tenSeconds, start, start + chrono::minutes( 1 ),
+                                aggregates, 8 );
+    result &= check( count == 2 && aggregates[ 1 ].time == start + chrono::seconds( 10 ),
+                     "the buckets stay in order" );
+
+    asio::io_context context;
+    rep::MockServer mock( context );
+    rep::Service service( context, mock.endpoint() );
+    size_t events = 0;
+    service.on_temperature( [&events]( auto, auto ) { ++events; } );
+
+    auto attached = make_unique< History >();
+    attached->attach( service );
+
+    size_t recorded = 0;
+    size_t after = 0;
+    asio::steady_timer timer( context );
+    function< void () > poll = [&] {
+        timer.expires_after( chrono::milliseconds( 10 ) );
+        timer.async_wait( [&]( auto ec ) {
+            if ( ec ) {
+                return;
+            }
+            if ( attached ) {
+                recorded = attached->samples( "printer0", "extruder0", History::Clock::time_point(),
+                                              History::Clock::now(), samples, 8 );
+                if ( recorded > 0 ) {
+                    // the service goes on emitting to a slot that must be gone with the history
+                    attached = nullptr;
+                    after = events;
+                }
+            } else if ( events > after + 10 ) {
+                context.stop();
+                return;
+            }
+            poll();
+        } );
+    };
+    poll();
+
+    asio::steady_timer deadline( context, chrono::seconds( 10 ) );
+    deadline.async_wait( [&]( auto ) { context.stop(); } );
+    context.run();
+
+    result &= check( recorded > 0, "an attached history records the events of the service" );
+    result &= check( !attached && events > after + 10, "the service goes on after the history is destroyed" );
+
+    return result ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "3dprnet/core/filesystem.hpp"
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/temperature_log.hpp"
+#include "3dprnet/repetier/types.hpp"
+
+using namespace std;
+using namespace nlohmann;
+using namespace prnet;
+
+using Clock = rep::TemperatureLogWriter::Clock;
+using Reading = tuple< string, string, int64_t, double, double >;
+
+static bool check( bool condition, char const* what )
+{
+    cout << ( condition ? "ok: " : "FAILED: " ) << what << endl;
+    return condition;
+}
+
+static Clock::time_point at( int64_t millis )
+{
+    return Clock::time_point( chrono::milliseconds( millis ) );
+}
+
+static void append( rep::TemperatureLogWriter& writer, vector< Reading >& written, string const& slug, int id,
+                    int64_t millis, double wanted, double actual )
+{
+    auto temp = json { { "id", id }, { "S", wanted }, { "T", actual } }.get< rep::Temperature >();
+    writer.append( slug, temp, at( millis ) );
+    written.emplace_back( slug, temp.controller_name(), millis, wanted, actual );
+}
+
+static vector< Reading > readAll( filesystem::path const& path, int64_t from = 0, int64_t to = 4102444800000 )
+{
+    vector< Reading > result;
+    rep::TemperatureLogReader reader( path );
+    reader.scan( at( from ), at( to ), [&result]( auto const& slug, auto const& controller, auto const& point ) {
+        auto millis = chrono::duration_cast< chrono::milliseconds >( point.time.time_since_epoch() ).count();
+        result.emplace_back( slug, controller, millis, point.wanted, point.actual );
+    } );
+    return result;
+}
+
+/**
+ * Writes readings that take every path of the delta-of-delta and XOR encodings and checks that they are read back
+ * exactly. Then tears the last block of the log as a crash would and checks that the reader stops before it and that
+ * the writer cuts it off before appending.
+ */
+int main()
+{
+    Logger::threshold( Logger::Level::error );
+
+    bool result = true;
+
+    auto path = filesystem::temp_directory_path() / "prnet-test-temperature.log";
+    filesystem::remove( path );
+
+    // the timestamps step by none, 7, 9, 12 and 64 bit deltas of deltas, also backwards, the values change by
+    // nothing, a few bits, in the same bits as before and in all of them
+    int64_t const steps[] { 1000, 1000, 1000, 1030, 990, 1200, 800, 2500, 1000, 3600000, 1000, -5000, 1000, 1000 };
+    double const values[] { 20.0, 20.0, 20.5, 20.25, 215.375, 215.375, -3.5, 1e300, 0.0, 4.9e-324, 200.0, 200.125 };
+    vector< Reading > written;
+    {
+        rep::TemperatureLogWriter writer( path, 16, chrono::seconds( 0 ) );
+        int64_t millis = 1514764800000;
+        for ( size_t i = 0 ; i < 40 ; ++i ) {
+            millis += steps[ i % ( sizeof( steps ) / sizeof( steps[ 0 ] ) ) ];
+            auto value = values[ i % ( sizeof( values ) / sizeof( values[ 0 ] ) ) ];
+            append( writer, written, "printer", 0, millis, 210.0, value );
+            append( writer, written, "printer", -1, millis + 1, value, -value );
+        }
+    }
+
+    auto read = readAll( path );
+    stable_sort( written.begin(), written.end(), []( auto const& a, auto const& b ) {
+        return tie( get< 1 >( a ), get< 2 >( a ) ) < tie( get< 1 >( b ), get< 2 >( b ) );
+    } );
+    stable_sort( read.begin(), read.end(), []( auto const& a, auto const& b ) {
+        return tie( get< 1 >( a ), get< 2 >( a ) ) < tie( get< 1 >( b ), get< 2 >( b ) );
+    } );
+    result &= check( read == written, "every reading is read back exactly" );
+
+    auto complete = filesystem::file_size( path );
+    vector< Reading > lost;
+    {
+        rep::TemperatureLogWriter writer( path );
+        append( writer, lost, "printer", 0, 1600000000000, 210.0, 205.5 );
+    }
+    filesystem::resize_file( path, filesystem::file_size( path ) - 3 );
+
+    bool thrown = false;
+    try {
+        read = readAll( path );
+    } catch ( exception const& ) {
+        thrown = true;
+    }
+    result &= check( !thrown && read.size() == written.size(), "the reader stops before a torn block" );
+
+    vector< Reading > appended;
+    {
+        rep::TemperatureLogWriter writer( path );
+        result &= check( filesystem::file_size( path ) == complete, "the writer cuts off a torn block" );
+        append( writer, appended, "other", 1, 1700000000000, 60.0, 59.5 );
+    }
+    read = readAll( path, 1650000000000 );
+    result &= check( read == appended, "blocks appended after a torn one are read" );
+
+    filesystem::remove( path );
+    return result ? 0 : 1;
+}
@@ -1,37 +1,68 @@
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
 
 #include <boost/asio/io_context.hpp>
 
-#include <core/filesystem.hpp>
-#include <core/logging.hpp>
-#include <repetier/types.hpp>
-#include <repetier/upload.hpp>
+#include "3dprnet/core/filesystem.hpp"
+#include "3dprnet/core/logging.hpp"
+#include "3dprnet/repetier/types.hpp"
+#include "3dprnet/repetier/upload.hpp"
+#include "test/mock_server.hpp"
 
 using namespace std;
 using namespace prnet;
 
 namespace asio = boost::asio;
 
+/**
+ * Uploads a model to a printer. Without arguments, a generated file is uploaded to a MockServer started in-process.
+ */
 int main( int argc, char const* const argv[] )
 {
-    logger::threshold( logger::Debug );
+    Logger::threshold( Logger::Level::debug );
 
-    if ( argc != 7 ) {
-        std::cerr << "Usage: " << argv[ 0 ] << " <host> <port> <apikey> <printer> <model> <filename>";
+    if ( argc != 1 && argc != 7 ) {
+        cerr << "Usage: " << argv[ 0 ] << " [<host> <port> <apikey> <printer> <model> <filename>]";
         return 1;
     }
 
     asio::io_context context;
 
-    rep::settings settings { argv[ 1 ], argv[ 2 ], argv[ 3 ] };
-    rep::model_ident model { argv[ 4 ], "", argv[ 5 ] };
-    filesystem::path path { argv[ 6 ] };
+    unique_ptr< rep::MockServer > mock;
+    rep::Endpoint endpoint;
+    rep::model_ident model = argc == 1 ? rep::model_ident( "printer0", "#", "upload" )
+                                       : rep::model_ident( argv[ 4 ], "", argv[ 5 ] );
+    filesystem::path path;
+    if ( argc == 1 ) {
+        mock = make_unique< rep::MockServer >( context );
+        endpoint = mock->endpoint();
+        path = filesystem::temp_directory_path() / "prnet-test-upload.gcode";
 
-    std::cout << "Uploading " << path << " to " << settings.host() << ":" << settings.port() << std::endl;
+        ofstream out( path.string() );
+        for ( size_t i = 0 ; i < 10000 ; ++i ) {
+            out << "G1 X" << i % 200 << " Y" << i % 150 << " E" << i << "\n";
+        }
+    } else {
+        endpoint = { argv[ 1 ], argv[ 2 ], argv[ 3 ] };
+        path = argv[ 6 ];
+    }
+
+    cout << "Uploading " << path << " to " << endpoint.host() << ":" << endpoint.port() << endl;
 
-    rep::upload_model( context, settings, model, path, []( auto ec ) {
-        std::cout << "Result: " << ec.message() << std::endl;
+    int result = 1;
+    rep::uploadModel( context, endpoint, model, path, [&]( auto ec ) {
+        cout << "Result: " << ec.message() << endl;
+        // the mock reads the body by its Content-Length, which must cover the whole file
+        if ( !ec && ( !mock || ( mock->stats().uploads == 1
+                                 && mock->stats().uploadBytes > filesystem::file_size( path ) ) ) ) {
+            result = 0;
+        }
+        context.stop();
     } );
 
     context.run();
-}
\ No newline at end of file
+    return result;
+}
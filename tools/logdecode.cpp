@@ -0,0 +1,39 @@
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+#include "3dprnet/core/binary_log.hpp"
+
+using namespace std;
+using namespace prnet;
+
+/**
+ * Renders binary logs written by Logger::binary() in the text format of the Logger, to stdout.
+ */
+int main( int argc, char const* const argv[] )
+{
+    if ( argc < 2 ) {
+        cerr << "Usage: " << argv[ 0 ] << " <binary log>...\n";
+        return 1;
+    }
+
+    ios::sync_with_stdio( false );
+
+    for ( int i = 1 ; i < argc ; ++i ) {
+        ifstream in( argv[ i ], ios::in | ios::binary );
+        if ( !in ) {
+            cerr << argv[ 0 ] << ": unable to open " << argv[ i ] << "\n";
+            return 1;
+        }
+
+        try {
+            BinaryLogReader reader( in );
+            while ( reader.next( cout ) ) {
+            }
+        } catch ( exception const& e ) {
+            cout.flush();
+            cerr << argv[ 0 ] << ": " << argv[ i ] << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+}
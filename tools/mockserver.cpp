@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "3dprnet/core/logging.hpp"
+#include "test/mock_server.hpp"
+
+using namespace std;
+using namespace prnet;
+
+namespace asio = boost::asio;
+
+/**
+ * Runs a MockServer until interrupted, printing its statistics every --stats seconds.
+ */
+int main( int argc, char const* const argv[] )
+{
+    auto options = rep::MockServer::defaultOptions();
+    size_t threads = 1;
+    long statsInterval = 0;
+
+    for ( int i = 1 ; i < argc ; ++i ) {
+        auto arg = argv[ i ];
+        auto value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr ) {
+            cerr << argv[ 0 ] << ": missing value for " << arg << "\n";
+            return 1;
+        }
+        ++i;
+
+        if ( strcmp( arg, "--address" ) == 0 ) {
+            options.address = value;
+        } else if ( strcmp( arg, "--port" ) == 0 ) {
+            options.port = static_cast< unsigned short >( strtoul( value, nullptr, 10 ) );
+        } else if ( strcmp( arg, "--apikey" ) == 0 ) {
+            options.apikey = value;
+        } else if ( strcmp( arg, "--printers" ) == 0 ) {
+            options.printers = strtoul( value, nullptr, 10 );
+        } else if ( strcmp( arg, "--models" ) == 0 ) {
+            options.models = strtoul( value, nullptr, 10 );
+        } else if ( strcmp( arg, "--groups" ) == 0 ) {
+            options.groups = strtoul( value, nullptr, 10 );
+        } else if ( strcmp( arg, "--rate" ) == 0 ) {
+            options.eventRate = strtod( value, nullptr );
+        } else if ( strcmp( arg, "--batch" ) == 0 ) {
+            options.eventBatch = strtoul( value, nullptr, 10 );
+        } else if ( strcmp( arg, "--latency" ) == 0 ) {
+            options.latency = chrono::milliseconds( strtoul( value, nullptr, 10 ) );
+        } else if ( strcmp( arg, "--drop" ) == 0 ) {
+            options.dropResponse = strtod( value, nullptr );
+        } else if ( strcmp( arg, "--disconnect" ) == 0 ) {
+            options.disconnect = strtod( value, nullptr );
+        } else if ( strcmp( arg, "--malformed" ) == 0 ) {
+            options.malformed = strtod( value, nullptr );
+        } else if ( strcmp( arg, "--seed" ) == 0 ) {
+            options.seed = static_cast< unsigned >( strtoul( value, nullptr, 10 ) );
+        } else if ( strcmp( arg, "--threads" ) == 0 ) {
+            threads = max< size_t >( strtoul( value, nullptr, 10 ), 1 );
+        } else if ( strcmp( arg, "--stats" ) == 0 ) {
+            statsInterval = strtol( value, nullptr, 10 );
+        } else {
+            cerr << "Usage: " << argv[ 0 ] << " [--address <address>] [--port <port>] [--apikey <apikey>]"
+                 << " [--printers <n>] [--models <n>] [--groups <n>] [--rate <events/s>] [--batch <n>]"
+                 << " [--latency <ms>] [--drop <p>] [--disconnect <p>] [--malformed <p>] [--seed <n>]"
+                 << " [--threads <n>] [--stats <seconds>]\n";
+            return 1;
+        }
+    }
+
+    Logger::threshold( Logger::Level::info );
+
+    asio::io_context context;
+    rep::MockServer server( context, options );
+    cout << "mock server listening on " << options.address << ":" << server.port() << ", apikey "
+         << options.apikey << endl;
+
+    asio::signal_set signals( context, SIGINT, SIGTERM );
+    signals.async_wait( [&]( auto, auto ) { context.stop(); } );
+
+    asio::steady_timer timer( context );
+    function< void () > report = [&] {
+        timer.expires_after( chrono::seconds( statsInterval ) );
+        timer.async_wait( [&]( auto ec ) {
+            if ( ec ) {
+                return;
+            }
+            auto stats = server.stats();
+            cout << "connections " << stats.connections << ", active " << stats.active << ", requests "
+                 << stats.requests << ", events " << stats.events << ", uploads " << stats.uploads << " ("
+                 << stats.uploadBytes << " bytes)" << endl;
+            report();
+        } );
+    };
+    if ( statsInterval > 0 ) {
+        report();
+    }
+
+    vector< thread > runners;
+    for ( size_t i = 1 ; i < threads ; ++i ) {
+        runners.emplace_back( [&context] { context.run(); } );
+    }
+    context.run();
+    for ( auto& runner : runners ) {
+        runner.join();
+    }
+}